@@ -6,9 +6,11 @@
 #include "Parser.h"
 #include "QueryEvaluator.h"
 #include "QueryPreprocessor.h"
+#include "SourceBuffer.h"
 
 #include <fstream>
 #include <iterator>
+#include <memory>
 #include <sstream>
 #include <sys/stat.h>
 
@@ -37,10 +39,10 @@ void TestWrapper::parse(std::string filename) {
         if (SANITY && stat(filename.c_str(), &buffer) != 0) {
             throw std::runtime_error("File does not exist: " + filename);
         }
-        std::ifstream inputFileStream;
         SANITY&& std::cout << "Parsing SIMPLE source file: " + filename << std::endl;
-        inputFileStream.open(filename);
-        backend::TNode ast = backend::Parser(backend::lexer::tokenize(inputFileStream)).parse();
+        std::shared_ptr<const backend::lexer::SourceBuffer> source = backend::lexer::SourceBuffer::fromFile(filename);
+        backend::Parser parser(backend::lexer::tokenizeInParallel(source, false));
+        backend::TNode ast = parser.parseInParallel();
         pkb = backend::PKBImplementation(ast);
     } catch (const std::exception& e) {
         std::cerr << "Unable to parse SIMPLE source file: " << e.what() << std::endl;
@@ -53,9 +55,7 @@ void TestWrapper::parse(std::string filename) {
 void TestWrapper::evaluate(std::string query, std::list<std::string>& results) {
     try {
         SANITY && (std::cout << "Query string: " << query << std::endl);
-        std::stringstream stream(query);
-        std::vector<backend::lexer::Token> tokens = backend::lexer::tokenize(stream);
-        qpbackend::Query queryStruct = querypreprocessor::parseTokens(tokens);
+        qpbackend::Query queryStruct = queryCache.parse(query);
         SANITY && (std::cout << "Query struct: " << queryStruct.toString() << std::endl);
         qpbackend::queryevaluator::QueryEvaluator queryEvaluator(&pkb);
         std::vector<std::string> queryResults = queryEvaluator.evaluateQuery(queryStruct);
@@ -2,6 +2,7 @@
 #define TESTWRAPPER_H
 
 #include "PKBImplementation.h"
+#include "QueryPreprocessor.h"
 
 #include <list>
 
@@ -19,6 +20,9 @@ class TestWrapper : public AbstractWrapper {
     // PKB to store information of SIMPLE program
     backend::PKBImplementation pkb;
 
+    // Queries parsed so far, as the same query can be evaluated many times
+    querypreprocessor::ParsedQueryCache queryCache;
+
     // method for parsing the SIMPLE source
     virtual void parse(std::string filename);
 
@@ -1263,7 +1263,7 @@ TEST_CASE("Test semantically invalid pattern clause syn-while (UNDERSCORE, EXPRE
     std::stringstream queryString = std::stringstream("while w; Select w pattern w (_, \"a+b\")");
     qpbackend::Query expectedQuery = qpbackend::Query(
     { { "w", qpbackend::EntityType::WHILE } }, { "w" }, {},
-    { { qpbackend::INVALID_CLAUSE_TYPE, { qpbackend::INVALID_ARG, "w" }, { qpbackend::WILDCARD, "_" }, "a+b" } });
+    { { qpbackend::INVALID_CLAUSE_TYPE, { qpbackend::INVALID_ARG, "w" }, { qpbackend::WILDCARD, "_" }, "(a+b)" } });
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
     qpbackend::Query actualQuery = querypreprocessor::parseTokens(lexerTokens);
@@ -1346,7 +1346,7 @@ TEST_CASE("Test pattern clause expression") {
     std::stringstream("assign a; Select a pattern a (_, \"x+s+Follows*38\")");
     qpbackend::Query expectedQuery = qpbackend::Query(
     { { "a", qpbackend::EntityType::ASSIGN } }, { "a" }, {},
-    { { qpbackend::ASSIGN_PATTERN_EXACT, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" } });
+    { { qpbackend::ASSIGN_PATTERN_EXACT, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" } });
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
     qpbackend::Query actualQuery = querypreprocessor::parseTokens(lexerTokens);
@@ -1359,7 +1359,7 @@ TEST_CASE("Test pattern clause expression operator") {
     std::stringstream("assign a; Select a pattern a (_, \"x+s*g-3%9\")");
     qpbackend::Query expectedQuery = qpbackend::Query(
     { { "a", qpbackend::EntityType::ASSIGN } }, { "a" }, {},
-    { { qpbackend::ASSIGN_PATTERN_EXACT, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s*g-3%9" } });
+    { { qpbackend::ASSIGN_PATTERN_EXACT, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+(s*g))-(3%9))" } });
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
     qpbackend::Query actualQuery = querypreprocessor::parseTokens(lexerTokens);
@@ -1370,12 +1370,8 @@ TEST_CASE("Test pattern clause expression operator") {
 TEST_CASE("Test pattern clause expression white space handling") {
     std::stringstream queryString =
     std::stringstream("assign a; Select a pattern a (_, \"x\r\r\r+s+Follows*\n\r3 8\")");
-    qpbackend::Query expectedQuery =
-    qpbackend::Query({ { "a", qpbackend::EntityType::ASSIGN } }, { "a" }, {},
-                     { { qpbackend::ASSIGN_PATTERN_EXACT,
-                         { qpbackend::STMT_SYNONYM, "a" },
-                         { qpbackend::WILDCARD, "_" },
-                         "x +s+Follows* 3 8" } });
+    // "3 8" is two constants, so the expression is invalid.
+    qpbackend::Query expectedQuery = qpbackend::Query();
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
     qpbackend::Query actualQuery = querypreprocessor::parseTokens(lexerTokens);
@@ -1391,7 +1387,7 @@ TEST_CASE("Test pattern clause sub-expression") {
                      { { qpbackend::ASSIGN_PATTERN_SUB_EXPR,
                          { qpbackend::STMT_SYNONYM, "a" },
                          { qpbackend::WILDCARD, "_" },
-                         "x+s+Follows*38" } });
+                         "((x+s)+(Follows*38))" } });
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
     qpbackend::Query actualQuery = querypreprocessor::parseTokens(lexerTokens);
@@ -1408,7 +1404,7 @@ TEST_CASE("Test pattern clause sub-expression white space handling") {
                      { { qpbackend::ASSIGN_PATTERN_SUB_EXPR,
                          { qpbackend::STMT_SYNONYM, "a" },
                          { qpbackend::WILDCARD, "_" },
-                         "x+s + Follows * 38" } });
+                         "((x+s)+(Follows*38))" } });
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
     qpbackend::Query actualQuery = querypreprocessor::parseTokens(lexerTokens);
@@ -1424,9 +1420,9 @@ TEST_CASE("Test multiple pattern clause") {
                       "_\"x+s+Follows*38\"_)pattern a (_, _\"x+s+Follows*38\"_)    ");
     qpbackend::Query expectedQuery = qpbackend::Query(
     { { "a", qpbackend::EntityType::ASSIGN } }, { "a" }, {},
-    { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" },
-      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" },
-      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" } });
+    { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" },
+      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" },
+      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" } });
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
     qpbackend::Query actualQuery = querypreprocessor::parseTokens(lexerTokens);
@@ -1440,9 +1436,9 @@ TEST_CASE("Test multiple and-delimited assignment pattern clause") {
                       "_\"x+s+Follows*38\"_) pattern a (_, _\"x+s+Follows*38\"_)    ");
     qpbackend::Query expectedQuery = qpbackend::Query(
     { { "a", qpbackend::EntityType::ASSIGN } }, { "a" }, {},
-    { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" },
-      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" },
-      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" } });
+    { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" },
+      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" },
+      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" } });
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
     qpbackend::Query actualQuery = querypreprocessor::parseTokens(lexerTokens);
@@ -1460,11 +1456,11 @@ TEST_CASE("Test multiple and-delimited mixed pattern clause") {
     qpbackend::Query expectedQuery = qpbackend::Query(
     { { "a", qpbackend::EntityType::ASSIGN }, { "w", qpbackend::EntityType::WHILE }, { "ifs", qpbackend::EntityType::IF } },
     { "a" }, {},
-    { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" },
+    { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" },
       { qpbackend::WHILE_PATTERN, { qpbackend::STMT_SYNONYM, "w" }, { qpbackend::WILDCARD, "_" }, "_" },
-      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" },
+      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" },
       { qpbackend::IF_PATTERN, { qpbackend::STMT_SYNONYM, "ifs" }, { qpbackend::WILDCARD, "_" }, "_" },
-      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" } });
+      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" } });
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
     qpbackend::Query actualQuery = querypreprocessor::parseTokens(lexerTokens);
@@ -1490,11 +1486,11 @@ TEST_CASE("Test multiple and-delimited pattern treats 'and' as syntactic sugar")
     qpbackend::Query expectedQuery = qpbackend::Query(
     { { "a", qpbackend::EntityType::ASSIGN }, { "w", qpbackend::EntityType::WHILE }, { "ifs", qpbackend::EntityType::IF } },
     { "a" }, {},
-    { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" },
+    { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" },
       { qpbackend::WHILE_PATTERN, { qpbackend::STMT_SYNONYM, "w" }, { qpbackend::WILDCARD, "_" }, "_" },
-      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" },
+      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" },
       { qpbackend::IF_PATTERN, { qpbackend::STMT_SYNONYM, "ifs" }, { qpbackend::WILDCARD, "_" }, "_" },
-      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" } });
+      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" } });
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
     qpbackend::Query queryWithAnds = querypreprocessor::parseTokens(lexerTokens);
@@ -1516,11 +1512,11 @@ TEST_CASE("Test multiple pattern clause types") {
     qpbackend::Query expectedQuery = qpbackend::Query(
     { { "a", qpbackend::EntityType::ASSIGN }, { "w", qpbackend::EntityType::WHILE }, { "ifs", qpbackend::EntityType::IF } },
     { "a" }, {},
-    { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" },
+    { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" },
       { qpbackend::WHILE_PATTERN, { qpbackend::STMT_SYNONYM, "w" }, { qpbackend::WILDCARD, "_" }, "_" },
       { qpbackend::IF_PATTERN, { qpbackend::STMT_SYNONYM, "ifs" }, { qpbackend::WILDCARD, "_" }, "_" },
       { qpbackend::WHILE_PATTERN, { qpbackend::STMT_SYNONYM, "w" }, { qpbackend::WILDCARD, "_" }, "_" },
-      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" } });
+      { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" } });
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
     qpbackend::Query actualQuery = querypreprocessor::parseTokens(lexerTokens);
@@ -1538,7 +1534,7 @@ TEST_CASE("Test such-that and pattern clause") {
         { { "a", qpbackend::EntityType::ASSIGN } },
         { "a" },
         { { qpbackend::ClauseType::FOLLOWST, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::STMT_SYNONYM, "a" } } },
-        { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" } }
+        { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" } }
     };
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
@@ -1555,7 +1551,7 @@ TEST_CASE("Test pattern and such-that clause") {
         { { "a", qpbackend::EntityType::ASSIGN } },
         { "a" },
         { { qpbackend::ClauseType::FOLLOWST, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::STMT_SYNONYM, "a" } } },
-        { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" } }
+        { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" } }
     };
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
@@ -1574,8 +1570,8 @@ TEST_CASE("Test multiple pattern and such-that clause") {
         { "a" },
         { { qpbackend::ClauseType::FOLLOWST, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::STMT_SYNONYM, "a" } },
           { qpbackend::ClauseType::FOLLOWST, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::STMT_SYNONYM, "a" } } },
-        { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" },
-          { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "x+s+Follows*38" } }
+        { { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" },
+          { qpbackend::ASSIGN_PATTERN_SUB_EXPR, { qpbackend::STMT_SYNONYM, "a" }, { qpbackend::WILDCARD, "_" }, "((x+s)+(Follows*38))" } }
     };
 
     std::vector<lexer::Token> lexerTokens = backend::lexer::tokenizeWithWhitespace(queryString);
@@ -2092,4 +2088,26 @@ TEST_CASE("Test pattern invalid expression spec (sub expr), missing starting "
     "assign a; Select a such that pattern a (_, \"1+1\"_)");
 }
 
+TEST_CASE("Test parsed query cache reuses queries with the same tokens") {
+    querypreprocessor::ParsedQueryCache cache;
+    qpbackend::Query expectedQuery = qpbackend::Query(
+    { { "s", qpbackend::EntityType::STMT } }, { "s" },
+    { { qpbackend::ClauseType::FOLLOWS, { qpbackend::STMT_SYNONYM, "s" }, { qpbackend::STMT_SYNONYM, "s" } } }, {});
+
+    REQUIRE(cache.parse("stmt s; Select s such that Follows(s, s)") == expectedQuery);
+    REQUIRE(cache.parse("stmt s;\n  Select s such that Follows (s,s) ") == expectedQuery);
+    REQUIRE(cache.size() == 1);
+
+    REQUIRE_FALSE(cache.parse("stmt s; Select s such that Follows*(s, s)") == expectedQuery);
+    REQUIRE(cache.size() == 2);
+
+    // Invalid queries are cached too.
+    REQUIRE(cache.parse("stmt s; Select s such that") == qpbackend::Query());
+    REQUIRE(cache.parse("stmt s; Select s such that") == qpbackend::Query());
+    REQUIRE(cache.size() == 3);
+
+    REQUIRE_THROWS_AS(cache.parse("stmt s; Select s with s.stmt# = 01"), std::runtime_error);
+    REQUIRE(cache.size() == 3);
+}
+
 } // namespace backend
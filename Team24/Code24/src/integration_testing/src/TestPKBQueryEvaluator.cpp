@@ -0,0 +1,230 @@
+#include "Lexer.h"
+#include "PKBImplementation.h"
+#include "Parser.h"
+#include "QueryEvaluator.h"
+#include "QueryPreprocessor.h"
+#include "catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace qpbackend {
+
+// Helper functions
+
+backend::TNode parseProgram(const std::string& program) {
+    std::istringstream programStream(program);
+    return backend::Parser(backend::lexer::tokenize(programStream)).parse();
+}
+
+std::string generateLoopHeavyProgram(int loops) {
+    std::string program = "procedure p { x = 0; y = 0;";
+    for (int i = 0; i < loops; i++) {
+        program += "while (x < 10) { y = x + y; x = y * 2; if (y > x) then { x = 1; } else { y = x; } }";
+    }
+    return program + "print y; }";
+}
+
+std::vector<std::string> evaluate(const backend::PKB& pkb, const std::string& query) {
+    querypreprocessor::ParsedQueryCache queries;
+    std::vector<std::string> result = queryevaluator::QueryEvaluator(&pkb).evaluateQuery(queries.parse(query));
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+TEST_CASE("Test transitive clauses between synonyms on the PKB") {
+    const char program[] = "procedure p {"
+                           "x = 1;" // 1
+                           "while (x < 10) {" // 2
+                           "  y = x + 1;" // 3
+                           "  if (y > 2) then {" // 4
+                           "    x = y;" // 5
+                           "  } else {"
+                           "    print x;" // 6
+                           "  }"
+                           "}"
+                           "z = x + y;" // 7
+                           "}";
+    backend::TNode ast = parseProgram(program);
+    backend::PKBImplementation pkb(ast);
+
+    // The pairs that the PKB gives for one statement at a time.
+    std::vector<std::string> expectedNext;
+    std::vector<std::string> expectedAffects;
+    std::vector<std::string> expectedParent;
+    std::vector<std::string> expectedPrevious;
+    for (STATEMENT_NUMBER s1 = 1; s1 <= 7; ++s1) {
+        for (STATEMENT_NUMBER s2 = 1; s2 <= 7; ++s2) {
+            std::string pair = std::to_string(s1) + " " + std::to_string(s2);
+            if (pkb.getNextStatementOf(s1, true).count(s2)) {
+                expectedNext.push_back(pair);
+            }
+            if (pkb.getStatementsAffectedBy(s1, true).count(s2)) {
+                expectedAffects.push_back(pair);
+            }
+            if (pkb.getDescendants(s1).count(s2)) {
+                expectedParent.push_back(pair);
+            }
+            if (pkb.isIfElse(s1) && pkb.getPreviousStatementOf(s1, true).count(s2)) {
+                expectedPrevious.push_back(pair);
+            }
+        }
+    }
+    std::sort(expectedNext.begin(), expectedNext.end());
+    std::sort(expectedAffects.begin(), expectedAffects.end());
+    std::sort(expectedParent.begin(), expectedParent.end());
+    std::sort(expectedPrevious.begin(), expectedPrevious.end());
+
+    REQUIRE(evaluate(pkb, "stmt s1, s2; Select <s1, s2> such that Next*(s1, s2)") == expectedNext);
+    REQUIRE(evaluate(pkb, "assign a1, a2; Select <a1, a2> such that Affects*(a1, a2)") == expectedAffects);
+    REQUIRE(evaluate(pkb, "stmt s1, s2; Select <s1, s2> such that Parent*(s1, s2)") == expectedParent);
+    // The first synonym is the target of the relation.
+    REQUIRE(evaluate(pkb, "if i; stmt s; Select <i, s> such that Next*(s, i)") == expectedPrevious);
+    REQUIRE(evaluate(pkb, "stmt s; Select s such that Next*(s, s)") ==
+            std::vector<std::string>{ "2", "3", "4", "5", "6" });
+    REQUIRE(evaluate(pkb, "assign a; Select a such that Affects*(a, a)") == std::vector<std::string>{ "3", "5" });
+}
+
+TEST_CASE("Test Follows* and Parent* between two statements on the PKB") {
+    const char program[] = "procedure a {"
+                           "x = 1;" // 1
+                           "while (x < 2) {" // 2
+                           "  if (x == 1) then {" // 3
+                           "    x = 2;" // 4
+                           "  } else {"
+                           "    y = x;" // 5
+                           "  }"
+                           "}"
+                           "z = y;" // 6
+                           "}";
+    backend::TNode ast = parseProgram(program);
+    backend::PKBImplementation pkb(ast);
+    const std::vector<std::string> isTrue = { "TRUE" };
+    const std::vector<std::string> isFalse = { "FALSE" };
+
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Follows*(1, 6)") == isTrue);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Follows*(6, 1)") == isFalse);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Follows*(1, 4)") == isFalse);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Parent*(2, 5)") == isTrue);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Parent*(3, 2)") == isFalse);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Parent*(2, 6)") == isFalse);
+    REQUIRE(evaluate(pkb, "stmt s; Select s such that Follows*(s, 6)") == std::vector<std::string>{ "1", "2" });
+    REQUIRE(evaluate(pkb, "stmt s; Select s such that Parent*(2, s)") ==
+            std::vector<std::string>{ "3", "4", "5" });
+}
+
+TEST_CASE("Test Next* and Affects* between two statements on the PKB") {
+    const char program[] = "procedure a {"
+                           "x = 1;" // 1
+                           "while (x < 2) {" // 2
+                           "  if (x == 1) then {" // 3
+                           "    x = 2;" // 4
+                           "  } else {"
+                           "    y = x;" // 5
+                           "  }"
+                           "}"
+                           "z = y;" // 6
+                           "}";
+    backend::TNode ast = parseProgram(program);
+    backend::PKBImplementation pkb(ast);
+    const std::vector<std::string> isTrue = { "TRUE" };
+    const std::vector<std::string> isFalse = { "FALSE" };
+
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Next*(4, 3)") == isTrue);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Next*(5, 6)") == isTrue);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Next*(6, 1)") == isFalse);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Next*(1, 1)") == isFalse);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Affects*(4, 6)") == isTrue);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Affects*(1, 5)") == isTrue);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Affects*(5, 4)") == isFalse);
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Affects*(6, 6)") == isFalse);
+}
+
+TEST_CASE("Test statement clauses do not hold across procedures") {
+    const char program[] = "procedure a {"
+                           "while (x > 0) {" // 1
+                           "  x = x - 1;" // 2
+                           "}"
+                           "call b;" // 3
+                           "}"
+                           "procedure b {"
+                           "x = 1;" // 4
+                           "while (x > 0) {" // 5
+                           "  x = x + 1;" // 6
+                           "}"
+                           "}";
+    backend::TNode ast = parseProgram(program);
+    backend::PKBImplementation pkb(ast);
+
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Next*(2, 3)") == std::vector<std::string>{ "TRUE" });
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Next*(3, 4)") == std::vector<std::string>{ "FALSE" });
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Follows(3, 4)") == std::vector<std::string>{ "FALSE" });
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Affects*(2, 6)") == std::vector<std::string>{ "FALSE" });
+    REQUIRE(evaluate(pkb, "Select BOOLEAN such that Next*(1, 9000)") == std::vector<std::string>{ "FALSE" });
+
+    REQUIRE(evaluate(pkb, "stmt s1, s2; Select <s1, s2> such that Next*(s1, s2)") ==
+            std::vector<std::string>{ "1 1", "1 2", "1 3", "2 1", "2 2", "2 3", "4 5", "4 6", "5 5",
+                                      "5 6", "6 5", "6 6" });
+    REQUIRE(evaluate(pkb, "while w; assign a; Select <w, a> such that Next*(w, a)") ==
+            std::vector<std::string>{ "1 2", "5 6" });
+    REQUIRE(evaluate(pkb, "assign a1, a2; Select <a1, a2> such that Affects*(a1, a2)") ==
+            std::vector<std::string>{ "2 2", "4 6", "6 6" });
+    REQUIRE(evaluate(pkb, "assign a; stmt s; Select <a, s> such that Follows(s, a)") ==
+            std::vector<std::string>{});
+    // Answered one candidate at a time, pairing only candidates of the same procedure.
+    REQUIRE(evaluate(pkb, "stmt s1, s2; Select <s1, s2> such that Next(s1, s2)") ==
+            std::vector<std::string>{ "1 2", "1 3", "2 1", "4 5", "5 6", "6 5" });
+    REQUIRE(evaluate(pkb, "stmt s1, s2; Select <s1, s2> such that Follows(s1, s2)") ==
+            std::vector<std::string>{ "1 3", "4 5" });
+    REQUIRE(evaluate(pkb, "assign a1, a2; Select <a1, a2> such that Affects(a1, a2)") ==
+            std::vector<std::string>{ "2 2", "4 6", "6 6" });
+    REQUIRE(evaluate(pkb, "call c; assign a; Select <c, a> such that Next(c, a)") == std::vector<std::string>{});
+}
+
+TEST_CASE("Transitive clauses between synonyms", "[.benchmark]") {
+    backend::TNode ast = parseProgram(generateLoopHeavyProgram(150));
+    backend::PKBImplementation pkb(ast);
+    pkb.getAllStatementsThatAffect();
+
+    for (const char* query : { "stmt s1, s2; Select s1 such that Next*(s1, s2)",
+                               "assign a1, a2; Select a1 such that Affects*(a1, a2)",
+                               "stmt s1, s2; Select s1 such that Parent*(s1, s2)" }) {
+        auto start = std::chrono::steady_clock::now();
+        size_t resultCount = evaluate(pkb, query).size();
+        std::chrono::duration<double, std::milli> millis = std::chrono::steady_clock::now() - start;
+        std::cout << query << ": " << resultCount << " results, " << millis.count() << " ms\n";
+    }
+
+    std::vector<STATEMENT_NUMBER> statements(pkb.getAllStatements().begin(), pkb.getAllStatements().end());
+    auto start = std::chrono::steady_clock::now();
+    size_t pairCount = pkb.getTransitivePairs(backend::NextTransitive, statements, statements).size();
+    std::chrono::duration<double, std::milli> millis = std::chrono::steady_clock::now() - start;
+    std::cout << "getTransitivePairs(NextTransitive): " << pairCount << " pairs, " << millis.count() << " ms\n";
+}
+
+TEST_CASE("Transitive pairs between synonyms", "[.benchmark]") {
+    backend::TNode ast = parseProgram(generateLoopHeavyProgram(150));
+    backend::PKBImplementation pkb(ast);
+    pkb.getAllStatementsThatAffect();
+
+    // Both synonyms are selected, so every pair of the batched search ends up in the result.
+    const std::pair<const char*, backend::TransitiveStatementRelation> queries[] = {
+        { "stmt s1, s2; Select <s1, s2> such that Next*(s1, s2)", backend::NextTransitive },
+        { "assign a1, a2; Select <a1, a2> such that Affects*(a1, a2)", backend::AffectsTransitive }
+    };
+    std::vector<STATEMENT_NUMBER> statements(pkb.getAllStatements().begin(), pkb.getAllStatements().end());
+    for (const auto& query : queries) {
+        auto start = std::chrono::steady_clock::now();
+        size_t resultCount = evaluate(pkb, query.first).size();
+        std::chrono::duration<double, std::milli> millis = std::chrono::steady_clock::now() - start;
+        std::cout << query.first << ": " << resultCount << " results, " << millis.count() << " ms\n";
+        REQUIRE(resultCount == pkb.getTransitivePairs(query.second, statements, statements).size());
+    }
+}
+
+} // namespace qpbackend
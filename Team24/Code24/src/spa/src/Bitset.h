@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace backend {
+/**
+ * A set of integers in [0, size), one bit each. Union, difference and comparison work a 64-bit
+ * word at a time.
+ */
+class Bitset {
+  public:
+    Bitset() = default;
+    explicit Bitset(size_t size) : words((size + WORD_BITS - 1) / WORD_BITS, 0) {
+    }
+
+    void set(size_t i) {
+        words[i / WORD_BITS] |= uint64_t(1) << (i % WORD_BITS);
+    }
+    bool test(size_t i) const {
+        return (words[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+    }
+    // this := this | other. Both must have the same size.
+    // @return whether a bit was added.
+    bool unite(const Bitset& other) {
+        uint64_t added = 0;
+        for (size_t i = 0; i < words.size(); ++i) {
+            added |= other.words[i] & ~words[i];
+            words[i] |= other.words[i];
+        }
+        return added != 0;
+    }
+    // this := this & ~other. Both must have the same size.
+    void subtract(const Bitset& other) {
+        for (size_t i = 0; i < words.size(); ++i) {
+            words[i] &= ~other.words[i];
+        }
+    }
+    void clear() {
+        for (uint64_t& word : words) {
+            word = 0;
+        }
+    }
+    bool operator==(const Bitset& other) const {
+        return words == other.words;
+    }
+    bool operator!=(const Bitset& other) const {
+        return words != other.words;
+    }
+
+    // Calls f(i) for every i in the set, in increasing order.
+    template <typename F> void forEach(F f) const {
+        forEachWord(f, [](size_t) { return ~uint64_t(0); });
+    }
+    // Calls f(i) for every i in both this and other, in increasing order.
+    template <typename F> void forEachCommon(const Bitset& other, F f) const {
+        forEachWord(f, [&other](size_t i) { return other.words[i]; });
+    }
+
+  private:
+    static const size_t WORD_BITS = 64;
+    std::vector<uint64_t> words;
+
+    template <typename F, typename Mask> void forEachWord(F f, Mask mask) const {
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t word = words[i] & mask(i);
+            for (size_t bit = 0; word != 0; ++bit, word >>= 1) {
+                if (word & 1) {
+                    f(i * WORD_BITS + bit);
+                }
+            }
+        }
+    }
+};
+} // namespace backend
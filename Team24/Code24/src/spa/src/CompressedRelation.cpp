@@ -0,0 +1,169 @@
+#include "CompressedRelation.h"
+
+#include <algorithm>
+
+namespace backend {
+CompressedRelation CompressedRelation::fromEdges(std::vector<std::pair<int, int>> edges) {
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    CompressedRelation relation;
+    size_t sourceCount = edges.empty() ? 0 : static_cast<size_t>(edges.back().first) + 1;
+    relation.offsets.assign(sourceCount + 1, 0);
+    relation.targets.reserve(edges.size());
+    for (const std::pair<int, int>& edge : edges) {
+        relation.offsets[edge.first + 1]++;
+        relation.targets.push_back(edge.second);
+    }
+    for (size_t i = 1; i < relation.offsets.size(); ++i) {
+        relation.offsets[i] += relation.offsets[i - 1];
+    }
+    return relation;
+}
+
+CompressedRelation CompressedRelation::fromMap(const std::unordered_map<int, std::unordered_set<int>>& map) {
+    std::vector<std::pair<int, int>> edges;
+    for (const auto& p : map) {
+        for (int target : p.second) {
+            edges.emplace_back(p.first, target);
+        }
+    }
+    return fromEdges(std::move(edges));
+}
+
+CompressedRelation CompressedRelation::fromMap(const std::unordered_map<int, int>& map) {
+    return fromEdges({ map.begin(), map.end() });
+}
+
+CompressedRelation CompressedRelation::reversed() const {
+    std::vector<std::pair<int, int>> edges;
+    edges.reserve(targets.size());
+    for (size_t source = 0; source < sourceCount(); ++source) {
+        for (int target : get(static_cast<int>(source))) {
+            edges.emplace_back(target, static_cast<int>(source));
+        }
+    }
+    return fromEdges(std::move(edges));
+}
+
+bool CompressedRelation::contains(int source, int target) const {
+    Range range = get(source);
+    return std::binary_search(range.begin(), range.end(), target);
+}
+
+std::vector<int> CompressedRelation::getSources() const {
+    std::vector<int> sources;
+    for (size_t source = 0; source < sourceCount(); ++source) {
+        if (offsets[source] != offsets[source + 1]) {
+            sources.push_back(static_cast<int>(source));
+        }
+    }
+    return sources;
+}
+
+std::vector<int> CompressedRelation::getReachable(int source) const {
+    std::vector<int> reachable;
+    std::vector<bool> visited;
+    std::vector<int> toVisit(get(source).begin(), get(source).end());
+    while (!toVisit.empty()) {
+        int visiting = toVisit.back();
+        toVisit.pop_back();
+        if (static_cast<size_t>(visiting) >= visited.size()) {
+            visited.resize(std::max(sourceCount(), static_cast<size_t>(visiting) + 1));
+        }
+        if (visited[visiting]) {
+            continue;
+        }
+        visited[visiting] = true;
+        reachable.push_back(visiting);
+        Range next = get(visiting);
+        toVisit.insert(toVisit.end(), next.begin(), next.end());
+    }
+    return reachable;
+}
+
+std::vector<std::pair<int, int>> CompressedRelation::getReachablePairs(const std::vector<int>& sources,
+                                                                        const std::vector<int>& targets) const {
+    const size_t WORD_BITS = 64;
+    // Nodes past the last source have no pairs, so only the targets among them are of interest.
+    size_t nodeCount = sourceCount();
+    for (int target : targets) {
+        nodeCount = std::max(nodeCount, static_cast<size_t>(std::max(target, -1) + 1));
+    }
+
+    std::vector<std::pair<int, int>> pairs;
+    // Bit i of a node's word is set once source i of the batch reaches it.
+    std::vector<bool> isTarget(nodeCount, false);
+    for (int target : targets) {
+        if (target >= 0) {
+            isTarget[target] = true;
+        }
+    }
+    std::vector<uint64_t> seen(nodeCount);
+    std::vector<uint64_t> frontier(nodeCount);
+    std::vector<uint64_t> nextFrontier(nodeCount);
+    std::vector<int> active;
+    std::vector<int> nextActive;
+    // The nodes that the batch reached, so that a batch costs as much as the part of the relation
+    // that it searches, however many targets there are.
+    std::vector<int> reached;
+    for (size_t first = 0; first < sources.size(); first += WORD_BITS) {
+        size_t batchSize = std::min(WORD_BITS, sources.size() - first);
+        for (int node : reached) {
+            seen[node] = 0;
+        }
+        reached.clear();
+        for (size_t i = 0; i < batchSize; ++i) {
+            int source = sources[first + i];
+            if (source < 0 || static_cast<size_t>(source) >= nodeCount) {
+                continue;
+            }
+            if (frontier[source] == 0) {
+                active.push_back(source);
+            }
+            frontier[source] |= uint64_t(1) << i;
+        }
+
+        while (!active.empty()) {
+            for (int node : active) {
+                uint64_t reaching = frontier[node];
+                frontier[node] = 0;
+                for (int next : get(node)) {
+                    if (static_cast<size_t>(next) >= nodeCount) {
+                        continue;
+                    }
+                    uint64_t added = reaching & ~seen[next];
+                    if (added == 0) {
+                        continue;
+                    }
+                    if (seen[next] == 0) {
+                        reached.push_back(next);
+                    }
+                    if (nextFrontier[next] == 0) {
+                        nextActive.push_back(next);
+                    }
+                    nextFrontier[next] |= added;
+                    seen[next] |= added;
+                }
+            }
+            std::swap(frontier, nextFrontier);
+            std::swap(active, nextActive);
+            nextActive.clear();
+        }
+
+        for (int target : reached) {
+            if (!isTarget[target]) {
+                continue;
+            }
+            for (uint64_t word = seen[target]; word != 0; word &= word - 1) {
+                size_t i = 0;
+                while (!((word >> i) & 1)) {
+                    ++i;
+                }
+                pairs.emplace_back(sources[first + i], target);
+            }
+        }
+    }
+    return pairs;
+}
+} // namespace backend
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace backend {
+/**
+ * A binary relation over dense integer keys (statement numbers or variable ids), in compressed
+ * sparse row form: the sorted targets of every source are stored contiguously, and `offsets` marks
+ * where the targets of each source start. It is built once and never modified.
+ *
+ * Compared with an unordered_map of unordered_sets, there is no hash node per edge, a source's
+ * targets are found with two array reads, and traversals read memory in order.
+ */
+class CompressedRelation {
+  public:
+    // The sorted targets of a source.
+    class Range {
+      public:
+        Range(const int* first, const int* last) : first(first), last(last) {
+        }
+        const int* begin() const {
+            return first;
+        }
+        const int* end() const {
+            return last;
+        }
+        size_t size() const {
+            return static_cast<size_t>(last - first);
+        }
+        bool empty() const {
+            return first == last;
+        }
+
+      private:
+        const int* first;
+        const int* last;
+    };
+
+    CompressedRelation() = default;
+
+    // Builds the relation of the pairs (source, target). Duplicate pairs are kept once. Sources
+    // must not be negative.
+    static CompressedRelation fromEdges(std::vector<std::pair<int, int>> edges);
+    static CompressedRelation fromMap(const std::unordered_map<int, std::unordered_set<int>>& map);
+    static CompressedRelation fromMap(const std::unordered_map<int, int>& map);
+
+    // @return the relation with every pair (source, target) turned into (target, source).
+    CompressedRelation reversed() const;
+
+    // @return the targets of source, in increasing order. Empty if source has none.
+    Range get(int source) const {
+        if (source < 0 || static_cast<size_t>(source) + 1 >= offsets.size()) {
+            return { nullptr, nullptr };
+        }
+        return { targets.data() + offsets[source], targets.data() + offsets[source + 1] };
+    }
+    bool contains(int source, int target) const;
+    bool hasTargets(int source) const {
+        return !get(source).empty();
+    }
+    // @return the sources that have a target, in increasing order.
+    std::vector<int> getSources() const;
+    // @return every target reachable from source through one or more pairs, in no particular order.
+    std::vector<int> getReachable(int source) const;
+    /**
+     * A multi-source breadth-first search: 64 sources are searched at once, one bit of a word each,
+     * so that a node reached from several of them is visited once per level, not once per source.
+     * @return every (source, target) with target reachable from source through one or more pairs,
+     * in no particular order.
+     */
+    std::vector<std::pair<int, int>> getReachablePairs(const std::vector<int>& sources,
+                                                       const std::vector<int>& targets) const;
+
+    // One more than the largest source.
+    size_t sourceCount() const {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+    size_t edgeCount() const {
+        return targets.size();
+    }
+
+  private:
+    std::vector<uint32_t> offsets;
+    std::vector<int> targets;
+};
+} // namespace backend
@@ -0,0 +1,95 @@
+#include "ControlFlowGraph.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace backend {
+ControlFlowGraph::ControlFlowGraph(const ProgramIR& program,
+                                   const CompressedRelation& nextRelationship,
+                                   const CompressedRelation& previousRelationship) {
+    const int statementCount = program.getStatementCount();
+    std::vector<bool> isProcedureStart(statementCount + 1, false);
+    for (const ProcedureIR& procedure : program.getProcedures()) {
+        if (procedure.firstStatement != 0) {
+            isProcedureStart[procedure.firstStatement] = true;
+        }
+    }
+
+    // A block is extended with the only successor of its last statement for as long as that
+    // successor has no other predecessor.
+    blockOf.assign(statementCount + 1, -1);
+    offsetOf.assign(statementCount + 1, -1);
+    statements.reserve(statementCount);
+    for (STATEMENT_NUMBER first = 1; first <= statementCount; ++first) {
+        if (blockOf[first] != -1) {
+            continue;
+        }
+        int block = getBlockCount();
+        STATEMENT_NUMBER last = first;
+        while (true) {
+            blockOf[last] = block;
+            offsetOf[last] = static_cast<int>(statements.size() - offsets.back());
+            statements.push_back(last);
+            CompressedRelation::Range next = nextRelationship.get(last);
+            if (next.size() != 1) {
+                break;
+            }
+            STATEMENT_NUMBER following = *next.begin();
+            if (following > statementCount || blockOf[following] != -1 || isProcedureStart[following] ||
+                previousRelationship.get(following).size() != 1) {
+                break;
+            }
+            last = following;
+        }
+        offsets.push_back(static_cast<uint32_t>(statements.size()));
+    }
+
+    std::vector<std::pair<int, int>> edges;
+    for (int block = 0; block < getBlockCount(); ++block) {
+        CompressedRelation::Range blockStatements = getStatements(block);
+        for (STATEMENT_NUMBER next : nextRelationship.get(*(blockStatements.end() - 1))) {
+            if (next <= statementCount) {
+                edges.emplace_back(block, blockOf[next]);
+            }
+        }
+    }
+    successors = CompressedRelation::fromEdges(std::move(edges));
+    predecessors = successors.reversed();
+
+    // Depth-first search, without recursion, from the first block of each procedure.
+    std::vector<int> roots;
+    for (const ProcedureIR& procedure : program.getProcedures()) {
+        if (procedure.firstStatement != 0) {
+            roots.push_back(blockOf[procedure.firstStatement]);
+        }
+    }
+    for (int block = 0; block < getBlockCount(); ++block) {
+        roots.push_back(block);
+    }
+    std::vector<bool> visited(getBlockCount(), false);
+    // Each block being visited, with how many of its successors have been visited.
+    std::vector<std::pair<int, size_t>> visiting;
+    for (int root : roots) {
+        if (visited[root]) {
+            continue;
+        }
+        visited[root] = true;
+        visiting.emplace_back(root, 0);
+        while (!visiting.empty()) {
+            int block = visiting.back().first;
+            CompressedRelation::Range next = successors.get(block);
+            if (visiting.back().second < next.size()) {
+                int successor = next.begin()[visiting.back().second++];
+                if (!visited[successor]) {
+                    visited[successor] = true;
+                    visiting.emplace_back(successor, 0);
+                }
+                continue;
+            }
+            reversePostorder.push_back(block);
+            visiting.pop_back();
+        }
+    }
+    std::reverse(reversePostorder.begin(), reversePostorder.end());
+}
+} // namespace backend
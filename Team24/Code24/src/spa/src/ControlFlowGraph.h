@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CompressedRelation.h"
+#include "PKB.h"
+#include "ProgramIR.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace backend {
+/**
+ * The basic blocks of a program: maximal runs of statements that are always executed one after the
+ * other, with a single way in at the first statement and a single way out at the last.
+ * Blocks are numbered in the order of their first statements, and are linked by the Next pairs
+ * between them.
+ */
+class ControlFlowGraph {
+  public:
+    ControlFlowGraph() = default;
+    ControlFlowGraph(const ProgramIR& program,
+                     const CompressedRelation& nextRelationship,
+                     const CompressedRelation& previousRelationship);
+
+    int getBlockCount() const {
+        return static_cast<int>(offsets.size()) - 1;
+    }
+    // @return the statements of a block, in the order they are executed.
+    CompressedRelation::Range getStatements(int block) const {
+        return { statements.data() + offsets[block], statements.data() + offsets[block + 1] };
+    }
+    // @return the block of a statement, or -1 if s is not a statement.
+    int getBlock(STATEMENT_NUMBER s) const {
+        return s > 0 && static_cast<size_t>(s) < blockOf.size() ? blockOf[s] : -1;
+    }
+    // @return the position of a statement in its block, from 0. s must be a statement.
+    int getOffset(STATEMENT_NUMBER s) const {
+        return offsetOf[s];
+    }
+    const CompressedRelation& getSuccessors() const {
+        return successors;
+    }
+    const CompressedRelation& getPredecessors() const {
+        return predecessors;
+    }
+    // @return every block, in reverse postorder of a depth-first search from the first block of
+    // each procedure. A block comes before its successors, except along the back edges of loops.
+    const std::vector<int>& getReversePostorder() const {
+        return reversePostorder;
+    }
+
+  private:
+    std::vector<STATEMENT_NUMBER> statements;
+    std::vector<uint32_t> offsets{ 0 };
+    // Indexed by statement number.
+    std::vector<int> blockOf;
+    std::vector<int> offsetOf;
+    CompressedRelation successors;
+    CompressedRelation predecessors;
+    std::vector<int> reversePostorder;
+};
+} // namespace backend
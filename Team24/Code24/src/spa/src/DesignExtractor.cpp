@@ -1,8 +1,13 @@
 #include "DesignExtractor.h"
 
+#include "Bitset.h"
+#include "ControlFlowGraph.h"
 #include "Foost.hpp"
 #include "Logger.h"
+#include "ParallelFor.h"
 #include "PKB.h"
+#include "PatternIndex.h"
+#include "SsaForm.h"
 #include "TNode.h"
 
 #include <algorithm>
@@ -23,7 +28,7 @@ typedef int STATEMENT_NUMBER;
 std::unordered_map<const TNode*, int> getTNodeToStatementNumber(const TNode& ast) {
     logLine("start getTNodeToStatementNumber");
     logWord("getTNodeToStatementNumber: ast is ");
-    logLine(ast.toString());
+    logTNode(ast);
 
     std::unordered_map<const TNode*, int> tNodeToStatementNumber;
     int currentStatementNumber = 1;
@@ -152,29 +157,44 @@ getProcedureToCallees(const std::unordered_map<TNodeType, std::vector<const TNod
     return procedureToCallees;
 }
 
+/**
+ * A DFS from currentNode through the procedures it calls, with an explicit stack.
+ * @param currentlyVisiting the procedures on the path from currentNode to the procedure being visited.
+ * @return whether a procedure on the path is called again.
+ */
 bool cyclicCallExistsHelper(const TNode* currentNode,
                             const std::unordered_map<const TNode*, std::unordered_set<const TNode*>>& procedureToCallees,
                             std::unordered_set<const TNode*>& currentlyVisiting) {
-    if (currentlyVisiting.find(currentNode) != currentlyVisiting.end()) {
-        logLine("cyclicCallExistsHelper: Cycle detected at " + currentNode->toShortString());
-        return true;
-    }
-
-    logLine("cyclicCallExistsHelper: visiting " + currentNode->toShortString());
-    currentlyVisiting.insert(currentNode);
-    bool cyclicCallExists = false;
-    if (procedureToCallees.find(currentNode) != procedureToCallees.end()) {
-        for (const TNode* callee : procedureToCallees.find(currentNode)->second) {
-            cyclicCallExists =
-            cyclicCallExists || cyclicCallExistsHelper(callee, procedureToCallees, currentlyVisiting);
+    static const std::unordered_set<const TNode*> noCallees;
+    // Each procedure on the path, with the callee to visit next.
+    std::vector<std::pair<const TNode*, std::unordered_set<const TNode*>::const_iterator>> path;
+    auto visit = [&](const TNode* procedure) {
+        logLine("cyclicCallExistsHelper: visiting " + procedure->toShortString());
+        currentlyVisiting.insert(procedure);
+        auto it = procedureToCallees.find(procedure);
+        const std::unordered_set<const TNode*>& callees = it == procedureToCallees.end() ? noCallees : it->second;
+        path.emplace_back(procedure, callees.begin());
+    };
+
+    visit(currentNode);
+    while (!path.empty()) {
+        const TNode* procedure = path.back().first;
+        auto it = procedureToCallees.find(procedure);
+        if (it == procedureToCallees.end() || path.back().second == it->second.end()) {
+            logLine("cyclicCallExistsHelper: visited " + procedure->toShortString());
+            currentlyVisiting.erase(procedure);
+            path.pop_back();
+            continue;
+        }
+        const TNode* callee = *path.back().second;
+        ++path.back().second;
+        if (currentlyVisiting.find(callee) != currentlyVisiting.end()) {
+            logLine("cyclicCallExistsHelper: Cycle detected at " + callee->toShortString());
+            return true;
         }
+        visit(callee);
     }
-    currentlyVisiting.erase(currentNode);
-
-    logWord("cyclicCallExistsHelper: visited " + currentNode->toShortString() + ", cyclic call exists? ");
-    logLine(cyclicCallExists);
-
-    return cyclicCallExists;
+    return false;
 }
 
 bool cyclicCallExists(const std::unordered_map<const TNode*, std::unordered_set<const TNode*>>& procedureToCallees) {
@@ -190,79 +210,99 @@ bool cyclicCallExists(const std::unordered_map<const TNode*, std::unordered_set<
 
 
 /**
- * A DFS Helper that is used to compute the Uses mapping.
- * @param currentNode
- * @param tNodeTypeToTNodes
- * @param usesMapping a reference to the mapping, that will be updated with the Uses information for
- * the currentNode.
+ * A post-order DFS with an explicit stack, that indexes the variables of currentNode and of the
+ * nodes it depends on. A node is indexed after the nodes it depends on, with its own variables and
+ * theirs.
+ * @param dependenciesOf returns the nodes that a node depends on, e.g. its children.
+ * @param ownVariablesOf returns the variables of a node, not counting those of its dependencies.
+ * @param mapping a reference to the mapping, that will be updated with the variables of every
+ * node visited.
  */
-void getUsesMappingHelper(const TNode* currentNode,
-                          const std::unordered_map<TNodeType, std::vector<const TNode*>, EnumClassHash>& tNodeTypeToTNodes,
-                          std::unordered_map<const TNode*, std::unordered_set<std::string>>& usesMapping) {
-    logLine("Starting usesHelper for node " + currentNode->toString());
-    // The Uses information for this node was already computed.
-    if (usesMapping.find(currentNode) != usesMapping.end()) {
-        return;
-    }
-
-    // In the case of a read statement, we don't want to accumulate the variable name
-    // since we modify it instead of using it.
-    if (currentNode->type == TNodeType::Read) {
+template <typename Dependencies, typename OwnVariables>
+void indexVariablesInPostOrder(const TNode* currentNode,
+                               Dependencies dependenciesOf,
+                               OwnVariables ownVariablesOf,
+                               std::unordered_map<const TNode*, std::unordered_set<std::string>>& mapping) {
+    if (mapping.find(currentNode) != mapping.end()) {
         return;
     }
-
-    std::unordered_set<std::string> variablesUsedByCurrentTNode;
-
-    if (currentNode->type == TNodeType::Variable) {
-        // Base case. We want to propagate the usage of a variable upwards.
-        variablesUsedByCurrentTNode.insert(currentNode->name);
-        logLine("adding var name (" + currentNode->name + ")");
-    } else if (currentNode->type == TNodeType::Assign) {
-        // Only visit the RHS. Ignore the LHS of the assignment.
-        for (auto it = currentNode->children.begin() + 1; it != currentNode->children.end(); it++) {
-            // get a pointer to the child
-            const TNode* child = &(*it);
-            // Index all the variables used by the child
-            getUsesMappingHelper(child, tNodeTypeToTNodes, usesMapping);
-            // If the child has used any variables, the currentNode has also used the variables
-            // used by the child.
-            if (usesMapping.find(child) != usesMapping.end()) {
-                variablesUsedByCurrentTNode.insert(usesMapping[child].begin(), usesMapping[child].end());
+    struct Frame {
+        const TNode* node;
+        std::vector<const TNode*> dependencies;
+        size_t nextDependency;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({ currentNode, dependenciesOf(currentNode), 0 });
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        if (frame.nextDependency < frame.dependencies.size()) {
+            const TNode* dependency = frame.dependencies[frame.nextDependency++];
+            if (mapping.find(dependency) == mapping.end()) {
+                stack.push_back({ dependency, dependenciesOf(dependency), 0 });
             }
+            continue;
         }
-    } else if (currentNode->type == TNodeType::Call) {
-        // Retrieve the procedure name
-        const TNode* procNameNode = &(currentNode->children[0]);
-        auto calledProc = getProcedureFromProcedureName(procNameNode->name, tNodeTypeToTNodes);
 
-        // Compute the Uses mapping of the called procedure.
-        getUsesMappingHelper(calledProc, tNodeTypeToTNodes, usesMapping);
-
-        // Index the variables used in the called procedure, if any, becuase
-        // this call statement uses all the variables used by the called procedure
-        if (usesMapping.find(calledProc) != usesMapping.end()) {
-            variablesUsedByCurrentTNode.insert(usesMapping[calledProc].begin(),
-                                               usesMapping[calledProc].end());
-        } else {
-            logLine("Procedure " + calledProc->toShortString() + " uses nothing");
-        }
-    } else {
-        // Accumulate the variables used by currentNode's children (if any), and add them to the variables used by the currentNode
-        for (auto& child : currentNode->children) {
-            getUsesMappingHelper(&child, tNodeTypeToTNodes, usesMapping);
-            if (usesMapping.find(&child) != usesMapping.end()) {
-                variablesUsedByCurrentTNode.insert(usesMapping[&child].begin(), usesMapping[&child].end());
+        std::unordered_set<std::string> variables = ownVariablesOf(frame.node);
+        for (const TNode* dependency : frame.dependencies) {
+            auto it = mapping.find(dependency);
+            if (it != mapping.end()) {
+                variables.insert(it->second.begin(), it->second.end());
             }
         }
+        if (mapping.find(frame.node) != mapping.end()) {
+            throw std::runtime_error(
+            "Current node " + frame.node->toShortString() +
+            " has already been indexed, but every TNode should only be indexed once.");
+        }
+        mapping[frame.node] = std::move(variables);
+        stack.pop_back();
     }
+}
 
-    if (usesMapping.find(currentNode) != usesMapping.end()) {
-        throw std::runtime_error(
-        "Current node " + currentNode->toShortString() +
-        " has already been indexed, but every TNode should only be indexed once.");
+std::vector<const TNode*> getChildPointers(const TNode* node, size_t firstChild = 0) {
+    std::vector<const TNode*> result;
+    for (size_t i = firstChild; i < node->children.size(); i++) {
+        result.push_back(&node->children[i]);
     }
-    usesMapping[currentNode] = std::unordered_set<std::string>(variablesUsedByCurrentTNode.begin(),
-                                                               variablesUsedByCurrentTNode.end());
+    return result;
+}
+
+/**
+ * A DFS Helper that is used to compute the Uses mapping.
+ * @param currentNode
+ * @param tNodeTypeToTNodes
+ * @param usesMapping a reference to the mapping, that will be updated with the Uses information for
+ * the currentNode.
+ */
+void getUsesMappingHelper(const TNode* currentNode,
+                          const std::unordered_map<TNodeType, std::vector<const TNode*>, EnumClassHash>& tNodeTypeToTNodes,
+                          std::unordered_map<const TNode*, std::unordered_set<std::string>>& usesMapping) {
+    auto dependenciesOf = [&](const TNode* node) -> std::vector<const TNode*> {
+        switch (node->type) {
+        case TNodeType::Read:
+            // In the case of a read statement, we don't want to accumulate the variable name
+            // since we modify it instead of using it.
+            return {};
+        case TNodeType::Assign:
+            // Only visit the RHS. Ignore the LHS of the assignment.
+            return getChildPointers(node, 1);
+        case TNodeType::Call:
+            // This call statement uses all the variables used by the called procedure.
+            return { getProcedureFromProcedureName(node->children[0].name, tNodeTypeToTNodes) };
+        default:
+            // Accumulate the variables used by the node's children (if any).
+            return getChildPointers(node);
+        }
+    };
+    auto ownVariablesOf = [](const TNode* node) -> std::unordered_set<std::string> {
+        // Base case. We want to propagate the usage of a variable upwards.
+        if (node->type == TNodeType::Variable) {
+            return { node->name };
+        }
+        return {};
+    };
+    indexVariablesInPostOrder(currentNode, dependenciesOf, ownVariablesOf, usesMapping);
 }
 
 std::unordered_map<const TNode*, std::unordered_set<std::string>>
@@ -300,8 +340,6 @@ getUsesMapping(std::unordered_map<TNodeType, std::vector<const TNode*>, EnumClas
 
 /**
  * A DFS Helper that is used to compute the Modifies mapping.
- * Prerequisite: any procedure(s) that currentNode calls must have been indexed, i.e. it must exist
- * in the modifiesMapping.
  * @param currentNode
  * @param tNodeTypeToTNodes
  * @param modifiesMapping a reference to the mapping, that will be updated with the Modifies
@@ -310,54 +348,26 @@ getUsesMapping(std::unordered_map<TNodeType, std::vector<const TNode*>, EnumClas
 void getModifiesMappingHelper(const TNode* currentNode,
                               const std::unordered_map<TNodeType, std::vector<const TNode*>, EnumClassHash>& tNodeTypeToTNodes,
                               std::unordered_map<const TNode*, std::unordered_set<std::string>>& modifiesMapping) {
-    if (modifiesMapping.find(currentNode) != modifiesMapping.end()) {
-        return;
-    }
-
-    std::unordered_set<std::string> variablesModifiedByCurrentTNode;
-
-    if (currentNode->type == TNodeType::Assign) {
-        std::string variableAssignedTo = currentNode->children.at(0).name;
-        variablesModifiedByCurrentTNode.insert(variableAssignedTo);
-        logLine("adding Assigned var name (" + variableAssignedTo + ")");
-    } else if (currentNode->type == TNodeType::Read) {
-        std::string variableReadTo = currentNode->children.at(0).name;
-        variablesModifiedByCurrentTNode.insert(variableReadTo);
-        logLine("adding Read var name (" + variableReadTo + ")");
-    } else if (currentNode->type == TNodeType::Call) {
-        // Retrieve the procedure name
-        const TNode* procNameNode = &(currentNode->children[0]);
-        auto calledProc = getProcedureFromProcedureName(procNameNode->name, tNodeTypeToTNodes);
-
-        // Compute the Modifies mapping of the called procedure.
-        getModifiesMappingHelper(calledProc, tNodeTypeToTNodes, modifiesMapping);
-
-        // Index the variables modified in this procedure, if any, because
-        // this call statement modifies all the variables modified by the called procedure.
-        if (modifiesMapping.find(calledProc) != modifiesMapping.end()) {
-            variablesModifiedByCurrentTNode.insert(modifiesMapping[calledProc].begin(),
-                                                   modifiesMapping[calledProc].end());
-        } else {
-            logLine("Procedure " + calledProc->toShortString() + " modifies nothing");
+    auto dependenciesOf = [&](const TNode* node) -> std::vector<const TNode*> {
+        switch (node->type) {
+        case TNodeType::Assign:
+        case TNodeType::Read:
+            return {};
+        case TNodeType::Call:
+            // This call statement modifies all the variables modified by the called procedure.
+            return { getProcedureFromProcedureName(node->children[0].name, tNodeTypeToTNodes) };
+        default:
+            // Accumulate the variables modified by the node's children (if any).
+            return getChildPointers(node);
         }
-    } else {
-        // Accumulate the variables modified by currentNode's children (if any), and add them to the variables used by the currentNode
-        for (auto& child : currentNode->children) {
-            getModifiesMappingHelper(&child, tNodeTypeToTNodes, modifiesMapping);
-            if (modifiesMapping.find(&child) != modifiesMapping.end()) {
-                variablesModifiedByCurrentTNode.insert(modifiesMapping[&child].begin(),
-                                                       modifiesMapping[&child].end());
-            }
+    };
+    auto ownVariablesOf = [](const TNode* node) -> std::unordered_set<std::string> {
+        if (node->type == TNodeType::Assign || node->type == TNodeType::Read) {
+            return { node->children.at(0).name };
         }
-    }
-
-    if (modifiesMapping.find(currentNode) != modifiesMapping.end()) {
-        throw std::runtime_error(
-        "Current node " + currentNode->toShortString() +
-        " has already been indexed, but every TNode should only be indexed once.");
-    }
-
-    modifiesMapping[currentNode] = variablesModifiedByCurrentTNode;
+        return {};
+    };
+    indexVariablesInPostOrder(currentNode, dependenciesOf, ownVariablesOf, modifiesMapping);
 }
 
 std::unordered_map<const TNode*, std::unordered_set<std::string>>
@@ -469,73 +479,12 @@ STATEMENT_NUMBER_SET getVisitedPathFromStart(int start, const std::unordered_map
     return result;
 }
 
-/**
- * Helper method for getPatternsMap when running a post-order traversal on the expr of an assignment statement.
- * @param result - the hashmap storing the result
- * @param visiting - The node that we are currently visiting
- * @param assignee - For each assignment statement in the AST, there is an assignee, which is
- * the left of the assignment statement. i.e. the "a" in a = 1 + 1;
- * @param stmtNo - The statement number of the assignee and expression.
- * @param isSubExpr - boolean of whether the visiting tNode is a sub expression
- * @return the string representation of visitingNode.
- */
-std::string dfsHelper(std::unordered_map<std::string, std::vector<std::tuple<std::string, int, bool>>>& result,
-                      const TNode& visiting,
-                      const std::string& assignee,
-                      int stmtNo,
-                      bool isSubExpr) {
-    if (visiting.children.size() == 0) {
-        // By validity of AST, if `visiting` is leaf node, it must be a const or a var.
-        if (visiting.type == TNodeType::Constant) {
-            result[visiting.constant].emplace_back(assignee, stmtNo, isSubExpr);
-            return visiting.constant;
-        } else if (visiting.type == TNodeType::Variable) {
-            result[visiting.name].emplace_back(assignee, stmtNo, isSubExpr);
-            return visiting.name;
-        } else {
-            throw std::runtime_error(
-            "dfsHelper: leaf node should only be a constant or a variable. Got: " +
-            getTNodeTypeString(visiting.type));
-        }
-    }
-    // there should be 2 children for any operator.
-    const TNode& lhs = visiting.children.at(0);
-    const TNode& rhs = visiting.children.at(1);
-
-    // the lhs string must have a right subtree (rhsString), and vice-versa
-    std::string lhsString = dfsHelper(result, lhs, assignee, stmtNo, true);
-    std::string rhsString = dfsHelper(result, rhs, assignee, stmtNo, true);
-    std::string opString = getOperatorStringFromTNodeType(visiting.type);
-
-    std::string visitingString = "(" + lhsString + opString + rhsString + ")";
-    result[visitingString].emplace_back(assignee, stmtNo, isSubExpr);
-    return visitingString;
-}
-
-/**
- * Helper method for getPatternsMap when running a post-order traversal on the ast.
- * @param result - the hashmap storing the result
- * @param visiting - The node that we are currently visiting
- * @param assignee - For each assignment statement in the AST, there is an assignee, which is
- * the left of the assignment statement. i.e. the "a" in a = 1 + 1;
- * @param stmtNo - The statement number of the assignee and expression.
- * @param hasLeft - boolean of whether this visiting node has a left expr. e.g. for 1 + (visiting
- * node) + 2, visitingNode has both left(1) and right(2) expr.
- * @param hasRight - symmetric to hasLeft
- * @return map<string, {assignee, stmt_number, has_left_node, has_right_node}>
- * eg {1+2*4/5: {a, 4, false, true}};
- */
-std::unordered_map<std::string, std::vector<std::tuple<std::string, int, bool>>>
-getPatternsMap(const std::vector<const TNode*>& assignTNodes,
-               const std::unordered_map<const TNode*, int>& tNodeToStatementNumber) {
-    std::unordered_map<std::string, std::vector<std::tuple<std::string, int, bool>>> result;
+PatternIndex getPatternIndex(const std::vector<const TNode*>& assignTNodes,
+                             const std::unordered_map<const TNode*, int>& tNodeToStatementNumber) {
+    PatternIndex result;
     for (const TNode* tNodePtr : assignTNodes) {
         const TNode& assigneeNode = tNodePtr->children.at(0);
-        const std::string& assigneeName = assigneeNode.name;
-        int stmtNo = tNodeToStatementNumber.at(tNodePtr);
-
-        const TNode& exprTNode = tNodePtr->children.at(1);
-        dfsHelper(result, exprTNode, assigneeName, stmtNo, false);
+        result.addAssignment(assigneeNode.name, tNodeToStatementNumber.at(tNodePtr), tNodePtr->children.at(1));
     }
     return result;
 }
@@ -582,6 +531,287 @@ bool isValidSimpleProgram(const TNode& ast) {
     return true;
 }
 
+namespace {
+// A node being visited by extractDesign, with the variables used and modified in its subtree, not
+// counting those of called procedures.
+struct ExtractionFrame {
+    const TNode* node;
+    size_t nextChild;
+    std::unordered_set<std::string> uses;
+    std::unordered_set<std::string> modifies;
+    // The id of a statement list in the ProgramIR.
+    int statementList;
+};
+
+bool canUse(TNodeType type) {
+    return type == Assign || type == Print || type == IfElse || type == While || type == Call || type == Procedure;
+}
+
+bool canModify(TNodeType type) {
+    return type == Assign || type == Read || type == IfElse || type == While || type == Call || type == Procedure;
+}
+
+void mergeVariables(std::unordered_set<std::string>& to, const std::unordered_set<std::string>& from) {
+    if (to.empty()) {
+        to = from;
+    } else {
+        to.insert(from.begin(), from.end());
+    }
+}
+
+void eraseEmptySets(std::unordered_map<const TNode*, std::unordered_set<std::string>>& mapping) {
+    for (auto it = mapping.begin(); it != mapping.end();) {
+        if (it->second.empty()) {
+            it = mapping.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+} // namespace
+
+DesignTables extractDesign(const TNode& ast) {
+    DesignTables tables;
+    int currentStatementNumber = 1;
+    std::unordered_map<std::string, const TNode*> procedureNameToProcedure;
+    // The innermost procedure, while or if statement that contains each statement, and those that
+    // contain the node being visited.
+    std::unordered_map<const TNode*, const TNode*> containerOf;
+    std::vector<const TNode*> containers;
+    // Each call statement, with the procedure that contains it.
+    std::vector<std::pair<const TNode*, const TNode*>> callStatements;
+    std::unordered_map<const TNode*, PROCEDURE_ID> procedureIds;
+    PROCEDURE_ID currentProcedure = NO_PROCEDURE;
+    int statementListCount = 0;
+
+    std::vector<ExtractionFrame> stack;
+    auto enter = [&](const TNode* node) {
+        tables.tNodeTypeToTNodes[node->type].push_back(node);
+        if (node->isStatementNode()) {
+            if (containers.empty()) {
+                throw std::runtime_error("extractDesign: statement " + node->toShortString() +
+                                         " is not in a procedure");
+            }
+            tables.tNodeToStatementNumber[node] = currentStatementNumber++;
+            containerOf[node] = containers.back();
+
+            StatementIR statement;
+            statement.type = node->type;
+            if (containers.back()->type != Procedure) {
+                statement.parent = tables.tNodeToStatementNumber.at(containers.back());
+            }
+            statement.procedure = currentProcedure;
+            statement.statementList = stack.back().statementList;
+            statement.position = static_cast<int>(stack.back().nextChild) - 1;
+            STATEMENT_NUMBER statementNumber = tables.program.addStatement(statement);
+            ProcedureIR& procedure = tables.program.getProcedure(currentProcedure);
+            if (procedure.firstStatement == 0) {
+                procedure.firstStatement = statementNumber;
+            }
+            procedure.lastStatement = statementNumber;
+        }
+
+        ExtractionFrame frame = { node, 0, {}, {}, 0 };
+        switch (node->type) {
+        case Procedure:
+            if (!procedureNameToProcedure.emplace(node->name, node).second) {
+                throw std::runtime_error("extractDesign: procedure " + node->name + " is defined twice");
+            }
+            tables.procedureToCallees[node] = {};
+            containers.push_back(node);
+            currentProcedure = tables.program.addProcedure(node->name);
+            procedureIds[node] = currentProcedure;
+            break;
+        case StatementList:
+            frame.statementList = statementListCount++;
+            break;
+        case While:
+        case IfElse:
+            containers.push_back(node);
+            break;
+        case Assign: {
+            StatementIR& statement = tables.program.getStatement(currentStatementNumber - 1);
+            statement.expression = tables.patternIndex.addAssignment(node->children.at(0).name,
+                                                                     currentStatementNumber - 1,
+                                                                     node->children.at(1));
+            statement.modifiedVariable = tables.program.internVariable(node->children.at(0).name);
+            frame.modifies.insert(node->children.at(0).name);
+            break;
+        }
+        case Read:
+            tables.program.getStatement(currentStatementNumber - 1).modifiedVariable =
+            tables.program.internVariable(node->children.at(0).name);
+            frame.modifies.insert(node->children.at(0).name);
+            break;
+        case Call:
+            callStatements.emplace_back(node, containers.front());
+            break;
+        case Variable:
+            if (!node->isProcedureVar) {
+                tables.program.internVariable(node->name);
+            }
+            frame.uses.insert(node->name);
+            break;
+        default:
+            break;
+        }
+        stack.push_back(std::move(frame));
+    };
+
+    auto leave = [&](const ExtractionFrame& frame) {
+        const TNode* node = frame.node;
+        if (node->type == Procedure || node->type == While || node->type == IfElse) {
+            containers.pop_back();
+        }
+        if (node->type == StatementList) {
+            const std::vector<TNode>& statements = node->children;
+            for (size_t i = 1; i < statements.size(); i++) {
+                int previous = tables.tNodeToStatementNumber.at(&statements[i - 1]);
+                int current = tables.tNodeToStatementNumber.at(&statements[i]);
+                tables.followedFollowRelation[previous] = current;
+                tables.followFollowedRelation[current] = previous;
+            }
+        }
+        if (node->type == While || node->type == IfElse) {
+            int parent = tables.tNodeToStatementNumber.at(node);
+            STATEMENT_NUMBER_SET& children = tables.parentChildrenRelation[parent];
+            for (const TNode& statementList : node->children) {
+                if (statementList.type != StatementList) {
+                    continue;
+                }
+                for (const TNode& statement : statementList.children) {
+                    int child = tables.tNodeToStatementNumber.at(&statement);
+                    tables.childrenParentRelation[child] = parent;
+                    children.insert(child);
+                }
+            }
+        }
+        if (canUse(node->type)) {
+            tables.usesMapping[node] = frame.uses;
+        }
+        if (canModify(node->type)) {
+            tables.modifiesMapping[node] = frame.modifies;
+        }
+
+        if (stack.empty()) {
+            return;
+        }
+        ExtractionFrame& parentFrame = stack.back();
+        const TNode* parent = parentFrame.node;
+        size_t childIndex = parentFrame.nextChild - 1;
+        if ((parent->type == While || parent->type == IfElse) && childIndex == 0) {
+            int parentStatementNumber = tables.tNodeToStatementNumber.at(parent);
+            for (const VARIABLE_NAME& variable : frame.uses) {
+                tables.conditionVariablesToStatementNumbers[variable].insert(parentStatementNumber);
+            }
+        }
+        // A read statement modifies its variable, an assignment only uses its RHS, and a call
+        // statement uses the variables of the called procedure, which are added after the traversal.
+        bool isUsedByParent = parent->type != Read && parent->type != Call &&
+                              !(parent->type == Assign && childIndex == 0);
+        if (isUsedByParent) {
+            mergeVariables(parentFrame.uses, frame.uses);
+        }
+        mergeVariables(parentFrame.modifies, frame.modifies);
+    };
+
+    enter(&ast);
+    while (!stack.empty()) {
+        ExtractionFrame& frame = stack.back();
+        if (frame.nextChild < frame.node->children.size()) {
+            // Entering the child invalidates `frame`.
+            enter(&frame.node->children[frame.nextChild++]);
+            continue;
+        }
+        ExtractionFrame visited = std::move(frame);
+        stack.pop_back();
+        leave(visited);
+    }
+
+    // Link the call statements to the procedures they call.
+    std::unordered_map<const TNode*, std::vector<const TNode*>> procedureToCallers;
+    std::vector<std::pair<const TNode*, const TNode*>> callStatementsAndCallees;
+    for (const auto& p : callStatements) {
+        const TNode* callStatement = p.first;
+        const TNode* caller = p.second;
+        const std::string& calleeName = callStatement->children.at(0).name;
+        auto it = procedureNameToProcedure.find(calleeName);
+        if (it == procedureNameToProcedure.end()) {
+            throw std::runtime_error("extractDesign: call to non-existing procedure " + calleeName);
+        }
+        const TNode* callee = it->second;
+        if (tables.procedureToCallees[caller].insert(callee).second) {
+            procedureToCallers[callee].push_back(caller);
+        }
+        callStatementsAndCallees.emplace_back(callStatement, callee);
+    }
+
+    // Order the procedures so that every procedure comes after those it calls. A procedure that is
+    // never reached is part of a cyclic call.
+    std::unordered_map<const TNode*, size_t> calleesLeft;
+    std::vector<const TNode*> calleesFirst;
+    for (const auto& p : tables.procedureToCallees) {
+        calleesLeft[p.first] = p.second.size();
+        if (p.second.empty()) {
+            calleesFirst.push_back(p.first);
+        }
+    }
+    for (size_t i = 0; i < calleesFirst.size(); i++) {
+        for (const TNode* caller : procedureToCallers[calleesFirst[i]]) {
+            if (--calleesLeft[caller] == 0) {
+                calleesFirst.push_back(caller);
+            }
+        }
+    }
+    if (calleesFirst.size() != tables.procedureToCallees.size()) {
+        throw std::runtime_error("extractDesign: cyclic calls exist");
+    }
+
+    // A procedure uses and modifies the variables of the procedures it calls, as do the call
+    // statements and the statements that contain them.
+    for (const TNode* procedure : calleesFirst) {
+        for (const TNode* callee : tables.procedureToCallees[procedure]) {
+            mergeVariables(tables.usesMapping[procedure], tables.usesMapping[callee]);
+            mergeVariables(tables.modifiesMapping[procedure], tables.modifiesMapping[callee]);
+        }
+    }
+    for (const auto& p : callStatementsAndCallees) {
+        const std::unordered_set<std::string>& calleeUses = tables.usesMapping[p.second];
+        const std::unordered_set<std::string>& calleeModifies = tables.modifiesMapping[p.second];
+        for (const TNode* node = p.first; node->type != Procedure; node = containerOf.at(node)) {
+            mergeVariables(tables.usesMapping[node], calleeUses);
+            mergeVariables(tables.modifiesMapping[node], calleeModifies);
+        }
+    }
+    eraseEmptySets(tables.usesMapping);
+    eraseEmptySets(tables.modifiesMapping);
+
+    for (const auto& p : callStatementsAndCallees) {
+        tables.program.getStatement(tables.tNodeToStatementNumber.at(p.first)).callee = procedureIds.at(p.second);
+    }
+    std::vector<std::pair<int, int>> modifiedVariables;
+    std::vector<std::pair<int, int>> usedVariables;
+    for (const auto& p : tables.modifiesMapping) {
+        if (p.first->isStatementNode()) {
+            for (const VARIABLE_NAME& variable : p.second) {
+                modifiedVariables.emplace_back(tables.tNodeToStatementNumber.at(p.first),
+                                               tables.program.getVariableId(variable));
+            }
+        }
+    }
+    for (const auto& p : tables.usesMapping) {
+        if (p.first->isStatementNode()) {
+            for (const VARIABLE_NAME& variable : p.second) {
+                usedVariables.emplace_back(tables.tNodeToStatementNumber.at(p.first),
+                                           tables.program.getVariableId(variable));
+            }
+        }
+    }
+    tables.program.setModifiesAndUses(CompressedRelation::fromEdges(std::move(modifiedVariables)),
+                                      CompressedRelation::fromEdges(std::move(usedVariables)));
+    return tables;
+}
+
 /**
  * @returns the last lines that will be executed in a procedure, according to the provided
  * nextRelationship.
@@ -866,150 +1096,212 @@ getConditionVariablesToStatementNumbers(const std::unordered_map<int, const TNod
 }
 
 
-std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET>
-getAffectsMapping(const std::unordered_map<TNodeType, std::vector<const TNode*>, EnumClassHash>& tNodeTypeToTNodes,
-                  const std::unordered_map<const TNode*, STATEMENT_NUMBER>& tNodeToStatementNumber,
-                  const std::unordered_map<STATEMENT_NUMBER, const TNode*>& statementNumberToTNode,
-                  const std::unordered_map<int, std::unordered_set<int>>& nextRelationship,
-                  const std::unordered_map<int, std::unordered_set<int>>& previousRelationship,
-                  const std::unordered_map<const TNode*, std::unordered_set<std::string>>& usesMapping,
-                  const std::unordered_map<const TNode*, std::unordered_set<std::string>>& modifiesMapping) {
-    // This is an implementation of a worklist algorithm for reaching definition analysis.
-
-    // Represents the assignment that cause a certain variable to be modified.
-    typedef std::unordered_map<VARIABLE_NAME, STATEMENT_NUMBER_SET> VariableToAssigners;
-
-    std::unordered_map<STATEMENT_NUMBER, VariableToAssigners> variablesReachingIn;
-    for (auto& p : statementNumberToTNode) {
-        variablesReachingIn.insert({ p.first, VariableToAssigners() });
+namespace {
+/**
+ * A bit-vector reaching definition analysis of one procedure, over its basic blocks. The
+ * definitions are the assignments of the procedure, numbered densely, and every set of definitions
+ * is a Bitset.
+ * @param blocks the blocks of the procedure, in reverse postorder.
+ * @return the Affects pairs from the assignments of the procedure, and the size of the analysis.
+ */
+std::pair<std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET>, size_t>
+getProcedureAffectsMapping(const ProgramIR& program,
+                           const ControlFlowGraph& cfg,
+                           const ProcedureIR& procedure,
+                           const std::vector<int>& blocks) {
+    std::vector<STATEMENT_NUMBER> definitions;
+    std::vector<int> definitionOf(procedure.lastStatement - procedure.firstStatement + 1, -1);
+    // Only the variables that an assignment of the procedure modifies have definitions to kill.
+    std::vector<VARIABLE_ID> variables;
+    std::vector<int> localVariableOf(program.getVariableCount(), -1);
+    for (STATEMENT_NUMBER statementNumber = procedure.firstStatement; statementNumber <= procedure.lastStatement;
+         ++statementNumber) {
+        const StatementIR& statement = program.getStatement(statementNumber);
+        if (statement.type != Assign) {
+            continue;
+        }
+        definitionOf[statementNumber - procedure.firstStatement] = static_cast<int>(definitions.size());
+        definitions.push_back(statementNumber);
+        if (localVariableOf[statement.modifiedVariable] == -1) {
+            localVariableOf[statement.modifiedVariable] = static_cast<int>(variables.size());
+            variables.push_back(statement.modifiedVariable);
+        }
     }
-    std::unordered_map<STATEMENT_NUMBER, VariableToAssigners> variablesGoingOut;
-    for (auto& p : statementNumberToTNode) {
-        variablesGoingOut.insert({ p.first, VariableToAssigners() });
+    const size_t definitionCount = definitions.size();
+    std::vector<Bitset> definitionsOfVariable(variables.size(), Bitset(definitionCount));
+    for (size_t definition = 0; definition < definitionCount; ++definition) {
+        VARIABLE_ID variable = program.getStatement(definitions[definition]).modifiedVariable;
+        definitionsOfVariable[localVariableOf[variable]].set(definition);
     }
 
-
-    // Initialize
-    std::unordered_set<const TNode*> startingTNodes;
-    startingTNodes.insert(tNodeTypeToTNodes.at(Assign).begin(), tNodeTypeToTNodes.at(Assign).end());
-    for (const TNode* tNode : startingTNodes) {
-        STATEMENT_NUMBER statementNumber = tNodeToStatementNumber.at(tNode);
-        VariableToAssigners initialVariableToAssigners;
-        if (modifiesMapping.count(tNode)) {
-            for (const VARIABLE_NAME& variable : modifiesMapping.at(tNode)) {
-                initialVariableToAssigners[variable] = STATEMENT_NUMBER_SET();
-                initialVariableToAssigners[variable].insert(statementNumber);
+    // Assignments, reads and calls KILL the definitions of the variables they modify, and an
+    // assignment then GENs its own definition.
+    auto transfer = [&](STATEMENT_NUMBER statementNumber, Bitset& reaching, Bitset* killed) {
+        const StatementIR& statement = program.getStatement(statementNumber);
+        if (statement.type != Assign && statement.type != Read && statement.type != Call) {
+            return;
+        }
+        for (VARIABLE_ID modifiedVariable : program.getModifiedVariables(statementNumber)) {
+            int variable = localVariableOf[modifiedVariable];
+            if (variable == -1) {
+                continue;
             }
+            reaching.subtract(definitionsOfVariable[variable]);
+            if (killed != nullptr) {
+                killed->unite(definitionsOfVariable[variable]);
+            }
+        }
+        if (statement.type == Assign) {
+            reaching.set(definitionOf[statementNumber - procedure.firstStatement]);
+        }
+    };
+
+    // The blocks of a procedure are numbered consecutively, from the block of its first statement.
+    const int firstBlock = cfg.getBlock(procedure.firstStatement);
+    const int blockCount = static_cast<int>(blocks.size());
+    std::vector<Bitset> gen(blockCount, Bitset(definitionCount));
+    std::vector<Bitset> kill(blockCount, Bitset(definitionCount));
+    for (int block = 0; block < blockCount; ++block) {
+        for (STATEMENT_NUMBER statementNumber : cfg.getStatements(block + firstBlock)) {
+            transfer(statementNumber, gen[block], &kill[block]);
         }
-        variablesGoingOut[statementNumber] = initialVariableToAssigners;
     }
 
-
-    std::vector<STATEMENT_NUMBER> changedStatements;
-    for (auto& p : statementNumberToTNode) {
-        STATEMENT_NUMBER statementNumber = p.first;
-        changedStatements.push_back(statementNumber);
+    // OUT(b) = GEN(b) + (IN(b) - KILL(b)), where IN(b) is the union of the OUT of its predecessors.
+    // Blocks are visited in reverse postorder, so that a pass over a loop-free procedure settles
+    // every block, and a block is visited again only if the OUT of a predecessor changed.
+    std::vector<int> positionOf(blockCount);
+    for (int position = 0; position < blockCount; ++position) {
+        positionOf[blocks[position] - firstBlock] = position;
     }
-
-
-    while (!changedStatements.empty()) {
-        STATEMENT_NUMBER statementNumber = changedStatements.back();
-        changedStatements.pop_back();
-
-        if (previousRelationship.find(statementNumber) == previousRelationship.end()) {
-            continue;
-        }
-
-        variablesReachingIn[statementNumber] = VariableToAssigners();
-        VariableToAssigners& statementAffects = variablesReachingIn.at(statementNumber);
-
-        for (const STATEMENT_NUMBER& previousStatement : previousRelationship.at(statementNumber)) {
-            for (auto& p1 : variablesGoingOut.at(previousStatement)) {
-                const VARIABLE_NAME& variable = p1.first;
-                const STATEMENT_NUMBER_SET& newAffectors = p1.second;
-
-                if (statementAffects.find(variable) == statementAffects.end()) {
-                    statementAffects[variable] = STATEMENT_NUMBER_SET();
+    std::vector<Bitset> in(blockCount, Bitset(definitionCount));
+    std::vector<Bitset> out(gen);
+    std::vector<bool> isChanged(blockCount, true);
+    Bitset newOut(definitionCount);
+    int firstChanged = 0;
+    while (firstChanged < blockCount) {
+        int position = firstChanged;
+        firstChanged = blockCount;
+        for (; position < blockCount; ++position) {
+            int block = blocks[position] - firstBlock;
+            if (!isChanged[block]) {
+                continue;
+            }
+            isChanged[block] = false;
+            in[block].clear();
+            for (int predecessor : cfg.getPredecessors().get(block + firstBlock)) {
+                in[block].unite(out[predecessor - firstBlock]);
+            }
+            newOut = in[block];
+            newOut.subtract(kill[block]);
+            newOut.unite(gen[block]);
+            if (newOut == out[block]) {
+                continue;
+            }
+            std::swap(out[block], newOut);
+            for (int successor : cfg.getSuccessors().get(block + firstBlock)) {
+                successor -= firstBlock;
+                isChanged[successor] = true;
+                // A successor that has been passed over is visited in the next pass.
+                if (positionOf[successor] <= position) {
+                    firstChanged = std::min(firstChanged, positionOf[successor]);
                 }
-
-                statementAffects[variable].insert(newAffectors.begin(), newAffectors.end());
             }
         }
+    }
 
-        // Make a copy of the old affects
-        const VariableToAssigners oldOutwardAffects = variablesGoingOut[statementNumber];
-
-        // OUT := IN
-        variablesGoingOut[statementNumber] = variablesReachingIn[statementNumber];
-
-        const TNode* tNode = statementNumberToTNode.at(statementNumber);
-
-        // - KILL modified variables
-        if (tNode->type == Assign || tNode->type == Read || tNode->type == Call) {
-            if (modifiesMapping.count(tNode)) {
-                const VARIABLE_NAME_SET& modifiedVariables = modifiesMapping.at(tNode);
-                for (const VARIABLE_NAME& modifiedVariable : modifiedVariables) {
-                    variablesGoingOut[statementNumber].erase(modifiedVariable);
+    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> affectsMapping;
+    Bitset reaching(definitionCount);
+    for (int block = 0; block < blockCount; ++block) {
+        reaching = in[block];
+        for (STATEMENT_NUMBER statementNumber : cfg.getStatements(block + firstBlock)) {
+            // Only assignments affect each other.
+            if (program.getStatement(statementNumber).type == Assign) {
+                for (VARIABLE_ID usedVariable : program.getUsedVariables(statementNumber)) {
+                    if (localVariableOf[usedVariable] == -1) {
+                        continue;
+                    }
+                    reaching.forEachCommon(definitionsOfVariable[localVariableOf[usedVariable]], [&](size_t definition) {
+                        affectsMapping[definitions[definition]].insert(statementNumber);
+                    });
                 }
             }
+            transfer(statementNumber, reaching, nullptr);
         }
+    }
 
-        // + GEN new variables
-        if (tNode->type == Assign) {
-            VARIABLE_NAME variableModified = *modifiesMapping.at(tNode).begin();
-            variablesGoingOut[statementNumber][variableModified] = { statementNumber };
-        }
+    size_t bitsetCount = definitionsOfVariable.size() + gen.size() + kill.size() + in.size() + out.size();
+    return { std::move(affectsMapping), bitsetCount * ((definitionCount + 63) / 64) * sizeof(uint64_t) };
+}
+} // namespace
 
-        if (variablesGoingOut[statementNumber] != oldOutwardAffects) {
-            if (nextRelationship.find(statementNumber) == nextRelationship.end()) {
-                continue;
-            }
-            for (const STATEMENT_NUMBER& nextStatement : nextRelationship.at(statementNumber)) {
-                changedStatements.push_back(nextStatement);
-            }
+std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET>
+getAffectsMapping(const ProgramIR& program,
+                  const ControlFlowGraph& cfg,
+                  AffectsEngine engine,
+                  size_t* analysisBytes,
+                  unsigned int threadCount) {
+    if (engine == SsaEngine) {
+        SsaForm ssa(program, cfg);
+        if (analysisBytes != nullptr) {
+            *analysisBytes = ssa.getSizeInBytes();
         }
+        return ssa.getAffectsMapping();
     }
 
-    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> affectsMapping;
-    for (auto& p : statementNumberToTNode) {
-        STATEMENT_NUMBER statementNumber = p.first;
-        const TNode* tNode = p.second;
-
-        // Only assignments affect each other
-        if (tNode->type != Assign) {
-            continue;
+    // No Next pair leaves a procedure, so the definitions that reach a statement are all in its
+    // procedure, and each procedure is analysed on its own.
+    std::vector<ProcedureIR> procedures;
+    for (const ProcedureIR& procedure : program.getProcedures()) {
+        if (procedure.firstStatement != 0) {
+            procedures.push_back(procedure);
         }
+    }
+    // The reverse postorder of the blocks of each procedure.
+    std::vector<int> procedureOfBlock(cfg.getBlockCount());
+    for (size_t i = 0; i < procedures.size(); ++i) {
+        for (int block = cfg.getBlock(procedures[i].firstStatement); block <= cfg.getBlock(procedures[i].lastStatement);
+             ++block) {
+            procedureOfBlock[block] = static_cast<int>(i);
+        }
+    }
+    std::vector<std::vector<int>> procedureBlocks(procedures.size());
+    for (int block : cfg.getReversePostorder()) {
+        procedureBlocks[procedureOfBlock[block]].push_back(block);
+    }
 
-        for (auto& p1 : variablesReachingIn[statementNumber]) {
-            VARIABLE_NAME variable = p1.first;
-
-            // If this tNode does not use the variable that reaching this, skip.
-            if (usesMapping.find(tNode) == usesMapping.end()) {
-                continue;
-            }
-            auto& tNodeUses = usesMapping.at(tNode);
-            if (tNodeUses.find(variable) == tNodeUses.end()) {
-                continue;
-            }
-
-            STATEMENT_NUMBER_SET& affectors = p1.second;
-            for (const STATEMENT_NUMBER& affector : affectors) {
-                const TNode* affectorTNode = statementNumberToTNode.at(affector);
-                // Only assignments affect each other
-                if (affectorTNode->type != Assign) {
-                    continue;
-                }
+    std::vector<std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET>> procedureMappings(procedures.size());
+    std::vector<size_t> procedureBytes(procedures.size());
+    parallelFor(procedures.size(), threadCount, [&](size_t i) {
+        std::tie(procedureMappings[i], procedureBytes[i]) =
+        getProcedureAffectsMapping(program, cfg, procedures[i], procedureBlocks[i]);
+    });
 
-                if (affectsMapping.find(affector) == affectsMapping.end())
-                    affectsMapping[affector] = STATEMENT_NUMBER_SET();
-                affectsMapping[affector].insert(statementNumber);
-            }
+    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> affectsMapping;
+    size_t bytes = 0;
+    for (size_t i = 0; i < procedures.size(); ++i) {
+        for (auto& p : procedureMappings[i]) {
+            affectsMapping.emplace(p.first, std::move(p.second));
         }
+        bytes += procedureBytes[i];
+    }
+    if (analysisBytes != nullptr) {
+        *analysisBytes = bytes;
     }
-
     return affectsMapping;
 }
 
+std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET>
+getAffectsMapping(const ProgramIR& program,
+                  const CompressedRelation& nextRelationship,
+                  const CompressedRelation& previousRelationship,
+                  AffectsEngine engine,
+                  size_t* analysisBytes,
+                  unsigned int threadCount) {
+    return getAffectsMapping(program, ControlFlowGraph(program, nextRelationship, previousRelationship), engine,
+                             analysisBytes, threadCount);
+}
+
 std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET>
 getAffectedMapping(const std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET>& affectsMapping) {
     std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> result;
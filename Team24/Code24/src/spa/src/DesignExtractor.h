@@ -1,9 +1,15 @@
 #pragma once
 
+#include "CompressedRelation.h"
+#include "ControlFlowGraph.h"
 #include "PKB.h"
+#include "PatternIndex.h"
+#include "ProgramIR.h"
 #include "TNode.h"
 
 #include <functional>
+#include <map>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -65,17 +71,17 @@ template <typename T> STATEMENT_NUMBER_SET getKeysInMap(const std::unordered_map
 STATEMENT_NUMBER_SET getVisitedPathFromStart(int start, const std::unordered_map<int, int>& relation);
 
 /**
- * Get a mapping of pattern to {assignee, stmtNumber, isSubExpr}
+ * Get the pattern index of the expressions of the assign statements, where every subexpression of
+ * an assignment has a posting {assignee, stmtNumber, isSubExpr}.
  *
  * Note:
- * - isSubExpr - boolean of whether the visiting tNode is a sub expression
+ * - isSubExpr - boolean of whether the subexpression is a proper sub expression of the assignment's expr
  * - stmtNo - the statement number of the assignee and expression.
  * - assignee - for each assign statement in the AST, the assignee is the variable on
  *   the left of the assignment statement. i.e. the "a" in a = 1 + 1;
  */
-std::unordered_map<std::string, std::vector<std::tuple<std::string, int, bool>>>
-getPatternsMap(const std::vector<const TNode*>& assignTNodes,
-               const std::unordered_map<const TNode*, int>& tNodeToStatementNumber);
+PatternIndex getPatternIndex(const std::vector<const TNode*>& assignTNodes,
+                             const std::unordered_map<const TNode*, int>& tNodeToStatementNumber);
 
 std::unordered_map<int, TNodeType>
 getStatementNumberToTNodeTypeMap(const std::unordered_map<int, const TNode*>& statementNumberToTNode);
@@ -155,17 +161,64 @@ getPreviousRelationship(const std::unordered_map<int, std::unordered_set<int>>&
 std::unordered_map<VARIABLE_NAME, STATEMENT_NUMBER_SET>
 getConditionVariablesToStatementNumbers(const std::unordered_map<int, const TNode*>& statementNumberToTNode);
 
+/**
+ * The design abstractions of a program that are read off its AST, as computed by extractDesign.
+ * Each table is the same as the one returned by the extractor function of the same name.
+ */
+struct DesignTables {
+    std::unordered_map<const TNode*, int> tNodeToStatementNumber;
+    std::unordered_map<TNodeType, std::vector<const TNode*>, EnumClassHash> tNodeTypeToTNodes;
+    std::unordered_map<const TNode*, std::unordered_set<const TNode*>> procedureToCallees;
+    // {follower : followed} and {followed : follower}, as in getFollowRelationship.
+    std::unordered_map<int, int> followFollowedRelation;
+    std::unordered_map<int, int> followedFollowRelation;
+    // {child : parent} and {parent : children}, as in getParentRelationship.
+    std::unordered_map<int, int> childrenParentRelation;
+    std::unordered_map<int, STATEMENT_NUMBER_SET> parentChildrenRelation;
+    PatternIndex patternIndex;
+    std::unordered_map<VARIABLE_NAME, STATEMENT_NUMBER_SET> conditionVariablesToStatementNumbers;
+    std::unordered_map<const TNode*, std::unordered_set<std::string>> usesMapping;
+    std::unordered_map<const TNode*, std::unordered_set<std::string>> modifiesMapping;
+    // The statements and procedures of the program, without pointers into the AST.
+    ProgramIR program;
+};
+
+/**
+ * Extracts the DesignTables of a program by visiting every node of its AST once. Uses and Modifies
+ * through call statements are then added with a pass over the call graph, from the procedures that
+ * call no other procedure up to their callers.
+ * @throws std::runtime_error if the AST is not a valid SIMPLE program, see isValidSimpleProgram.
+ */
+DesignTables extractDesign(const TNode& ast);
+
+// The analyses that getAffectsMapping can run. They compute the same mapping.
+enum AffectsEngine {
+    // Bit-vector reaching definitions over basic blocks.
+    ReachingDefinitionsEngine,
+    // Def-use chains of the static single assignment form, see SsaForm.
+    SsaEngine
+};
+
 /**
  * Get mapping of the possible assignment statements that Affect other assignment statements.
+ * @param analysisBytes if not null, is set to the size of the state that the analysis kept.
+ * @param threadCount the maximum number of threads that analyse procedures, or 0 to use one per
+ * hardware thread. The SsaEngine analyses the whole program on the calling thread.
  */
 std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET>
-getAffectsMapping(const std::unordered_map<TNodeType, std::vector<const TNode*>, EnumClassHash>& tNodeTypeToTNodes,
-                  const std::unordered_map<const TNode*, STATEMENT_NUMBER>& tNodeToStatementNumber,
-                  const std::unordered_map<STATEMENT_NUMBER, const TNode*>& statementNumberToTNode,
-                  const std::unordered_map<int, std::unordered_set<int>>& nextRelationship,
-                  const std::unordered_map<int, std::unordered_set<int>>& previousRelationship,
-                  const std::unordered_map<const TNode*, std::unordered_set<std::string>>& usesMapping,
-                  const std::unordered_map<const TNode*, std::unordered_set<std::string>>& modifiesMapping);
+getAffectsMapping(const ProgramIR& program,
+                  const ControlFlowGraph& cfg,
+                  AffectsEngine engine = ReachingDefinitionsEngine,
+                  size_t* analysisBytes = nullptr,
+                  unsigned int threadCount = 1);
+// Builds the ControlFlowGraph of the program from its Next pairs.
+std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET>
+getAffectsMapping(const ProgramIR& program,
+                  const CompressedRelation& nextRelationship,
+                  const CompressedRelation& previousRelationship,
+                  AffectsEngine engine = ReachingDefinitionsEngine,
+                  size_t* analysisBytes = nullptr,
+                  unsigned int threadCount = 1);
 
 std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET>
 getAffectedMapping(const std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET>& affectsMapping);
@@ -188,7 +241,7 @@ getAffectedBipMapping(const std::pair<std::unordered_map<STATEMENT_NUMBER, STATE
 } // namespace backend
 
 namespace std {
-template <> struct ::std::hash<backend::extractor::NextBipEdge> {
+template <> struct hash<backend::extractor::NextBipEdge> {
     std::size_t operator()(backend::extractor::NextBipEdge const& s) const noexcept {
         return (s.nextLine ^ (s.prevLine << 1)) ^ (s.label << 1);
     }
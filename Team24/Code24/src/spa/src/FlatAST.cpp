@@ -0,0 +1,84 @@
+#include "FlatAST.h"
+
+#include <utility>
+
+namespace backend {
+NameId FlatAST::internName(const std::string& name) {
+    auto it = nameToId.find(name);
+    if (it != nameToId.end()) {
+        return it->second;
+    }
+    NameId id = static_cast<NameId>(names.size());
+    names.push_back(name);
+    nameToId.emplace(name, id);
+    return id;
+}
+
+NodeId FlatAST::addLeaf(TNodeType type, int line, NameId name) {
+    std::vector<NodeId> noChildren;
+    return addNode(type, line, noChildren.begin(), noChildren.end(), name);
+}
+
+NodeId FlatAST::addNode(TNodeType type, int line, std::initializer_list<NodeId> children) {
+    return addNode(type, line, children.begin(), children.end(), NO_NAME);
+}
+
+NodeId FlatAST::addNode(TNodeType type, int line, const std::vector<NodeId>& children, NameId name) {
+    return addNode(type, line, children.begin(), children.end(), name);
+}
+
+template <typename Iterator>
+NodeId FlatAST::addNode(TNodeType type, int line, Iterator childrenBegin, Iterator childrenEnd, NameId name) {
+    FlatNode node;
+    node.type = type;
+    node.line = line;
+    node.name = name;
+    node.firstChild = static_cast<uint32_t>(childIds.size());
+    childIds.insert(childIds.end(), childrenBegin, childrenEnd);
+    node.childCount = static_cast<uint32_t>(childIds.size()) - node.firstChild;
+    node.isProcedureVar = false;
+    nodes.push_back(node);
+    return static_cast<NodeId>(nodes.size() - 1);
+}
+
+void FlatAST::setProcedureVar(NodeId id) {
+    nodes[id].isProcedureVar = true;
+}
+
+TNode FlatAST::toTNode(NodeId id) const {
+    // A post-order traversal with an explicit stack. A node is visited twice: first to visit its
+    // children, then to build it from the TNodes of its children, which are on top of `built`.
+    std::vector<std::pair<NodeId, bool>> toVisit = { { id, false } };
+    std::vector<TNode> built;
+    while (!toVisit.empty()) {
+        NodeId visiting = toVisit.back().first;
+        bool areChildrenBuilt = toVisit.back().second;
+        toVisit.pop_back();
+        const FlatNode& node = nodes[visiting];
+        if (!areChildrenBuilt) {
+            toVisit.emplace_back(visiting, true);
+            for (uint32_t i = node.childCount; i-- > 0;) {
+                toVisit.emplace_back(child(node, i), false);
+            }
+            continue;
+        }
+
+        TNode result(node.type, node.line);
+        if (node.name != NO_NAME) {
+            if (node.type == Constant) {
+                result.constant = names[node.name];
+            } else {
+                result.name = names[node.name];
+            }
+        }
+        result.isProcedureVar = node.isProcedureVar;
+        result.children.reserve(node.childCount);
+        for (auto it = built.end() - node.childCount; it != built.end(); ++it) {
+            result.addChild(std::move(*it));
+        }
+        built.erase(built.end() - node.childCount, built.end());
+        built.push_back(std::move(result));
+    }
+    return std::move(built.back());
+}
+} // namespace backend
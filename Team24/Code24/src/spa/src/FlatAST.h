@@ -0,0 +1,71 @@
+#pragma once
+
+#include "TNode.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace backend {
+typedef uint32_t NodeId;
+typedef uint32_t NameId;
+
+// Name of a node that has no name or constant value.
+const NameId NO_NAME = UINT32_MAX;
+
+struct FlatNode {
+    TNodeType type;
+    int line;
+    // The name of a Procedure or Variable, or the value of a Constant.
+    NameId name;
+    // The children of the node are FlatAST::child(node, 0) to FlatAST::child(node, childCount - 1).
+    uint32_t firstChild;
+    uint32_t childCount;
+    bool isProcedureVar; // For use in `call`.
+};
+
+/**
+ * AST stored in contiguous arrays. Nodes refer to their children by a range of indices and to their
+ * names by a handle into a table of interned names, so a node is built once and never copied.
+ *
+ * Nodes are added bottom-up: the children of a node must be added before the node itself.
+ */
+class FlatAST {
+  public:
+    NameId internName(const std::string& name);
+    NodeId addLeaf(TNodeType type, int line, NameId name = NO_NAME);
+    NodeId addNode(TNodeType type, int line, std::initializer_list<NodeId> children);
+    NodeId addNode(TNodeType type, int line, const std::vector<NodeId>& children, NameId name = NO_NAME);
+    void setProcedureVar(NodeId id);
+
+    size_t size() const {
+        return nodes.size();
+    }
+    const FlatNode& operator[](NodeId id) const {
+        return nodes[id];
+    }
+    NodeId child(const FlatNode& node, size_t index) const {
+        return childIds[node.firstChild + index];
+    }
+    const std::string& nameOf(const FlatNode& node) const {
+        return names[node.name];
+    }
+
+    /**
+     * Adapter for the consumers of TNode, e.g. DesignExtractor and PKBImplementation.
+     * @return the subtree rooted at `id` as a TNode. Every TNode is built once, in linear time.
+     */
+    TNode toTNode(NodeId id) const;
+
+  private:
+    std::vector<FlatNode> nodes;
+    std::vector<NodeId> childIds;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, NameId> nameToId;
+
+    template <typename Iterator>
+    NodeId addNode(TNodeType type, int line, Iterator childrenBegin, Iterator childrenEnd, NameId name);
+};
+} // namespace backend
@@ -2,7 +2,14 @@
 
 #include "Lexer.h"
 
+#include <algorithm>
 #include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
 namespace backend {
 namespace lexer {
@@ -94,7 +101,469 @@ std::vector<std::string> splitLines(std::istream& stream) {
 }
 
 
-std::vector<Token> tokenize(std::istream& stream, bool willLexWithWhitespace) {
+namespace {
+// Character classes of the scanner. Every byte of the input is classified once through
+// CharTable, which replaces trying each regex in `rules` at every position.
+enum CharClass { INVALID_CHAR, LETTER, DIGIT, SPACE, SYMBOL };
+
+// A SYMBOL either forms a single character token, or a two character token when it is followed
+// by `second` (e.g. `!` and `!=`). The longer token is always preferred, as in `rules`.
+struct SymbolRule {
+    bool hasSingle;
+    TokenType single;
+    char second;
+    TokenType pair;
+};
+
+struct CharTable {
+    CharClass classes[256];
+    SymbolRule symbols[256];
+
+    CharTable() : classes(), symbols() {
+        for (int c = 'a'; c <= 'z'; c++) {
+            classes[c] = LETTER;
+        }
+        for (int c = 'A'; c <= 'Z'; c++) {
+            classes[c] = LETTER;
+        }
+        for (int c = '0'; c <= '9'; c++) {
+            classes[c] = DIGIT;
+        }
+        // Same characters as \s; '\n' never reaches the scanner as it ends a line.
+        for (char c : { ' ', '\t', '\v', '\f', '\r' }) {
+            classes[static_cast<unsigned char>(c)] = SPACE;
+        }
+
+        addSingle('{', LBRACE);
+        addSingle('}', RBRACE);
+        addSingle('(', LPAREN);
+        addSingle(')', RPAREN);
+        addSingle(';', SEMICOLON);
+        addSingle(',', COMMA);
+        addSingle('_', UNDERSCORE);
+        addSingle('"', DOUBLE_QUOTE);
+        addSingle('+', PLUS);
+        addSingle('-', MINUS);
+        addSingle('*', MULT);
+        addSingle('/', DIV);
+        addSingle('%', MOD);
+        addSingle('.', PERIOD);
+        addSingle('#', HASH);
+
+        addSingle('!', NOT);
+        addPair('!', '=', NEQ);
+        addSingle('=', SINGLE_EQ);
+        addPair('=', '=', EQEQ);
+        addSingle('>', GT);
+        addPair('>', '=', GTE);
+        addSingle('<', LT);
+        addPair('<', '=', LTE);
+        addPair('&', '&', ANDAND);
+        addPair('|', '|', OROR);
+    }
+
+    void addSingle(char c, TokenType type) {
+        unsigned char index = static_cast<unsigned char>(c);
+        classes[index] = SYMBOL;
+        symbols[index].hasSingle = true;
+        symbols[index].single = type;
+    }
+
+    void addPair(char first, char second, TokenType type) {
+        unsigned char index = static_cast<unsigned char>(first);
+        classes[index] = SYMBOL;
+        symbols[index].second = second;
+        symbols[index].pair = type;
+    }
+};
+
+const CharTable& getCharTable() {
+    static const CharTable table;
+    return table;
+}
+
+bool isWordChar(const CharTable& table, char c) {
+    CharClass charClass = table.classes[static_cast<unsigned char>(c)];
+    return charClass == LETTER || charClass == DIGIT || c == '_';
+}
+
+} // namespace
+
+class Scanner {
+  public:
+    Scanner(const SourceBuffer& buffer, bool willLexWithWhitespace)
+    : source(buffer.data()), size(buffer.size()), willLexWithWhitespace(willLexWithWhitespace),
+      table(getCharTable()) {
+        if (size > UINT32_MAX) {
+            throw std::runtime_error("Lexer: Source of " + std::to_string(size) + " bytes is too large");
+        }
+    }
+
+    // Lines are split on '\n' the same way std::getline splits them: a trailing '\n' does not
+    // start another (empty) line.
+    std::vector<SourceToken> scan() {
+        return scan(0, size, 1);
+    }
+
+    /**
+     * Scans the lines in [begin, end), where begin is the start of line `firstLine` and end is
+     * just past a '\n' or the end of the source.
+     *
+     * A chunk that does not start the source keeps its leading whitespace, since only the tokens
+     * before it decide whether that whitespace is compressed away (see appendChunk).
+     */
+    std::vector<SourceToken> scan(size_t begin, size_t end, int firstLine) {
+        start(begin, end, firstLine);
+        while (scanNextLine()) {
+        }
+        return std::move(result);
+    }
+
+    // Prepares to scan the lines in [begin, end) one at a time with scanNextLine.
+    void start(size_t begin, size_t end, int firstLine) {
+        isFirstChunk = begin == 0;
+        lineStart = begin;
+        chunkEnd = end;
+        lineNumber = firstLine;
+    }
+
+    // Appends the tokens of the next line to `tokens()`. Returns false if there are no lines left.
+    bool scanNextLine() {
+        if (lineStart >= chunkEnd) {
+            return false;
+        }
+        const char* newline = static_cast<const char*>(memchr(source + lineStart, '\n', chunkEnd - lineStart));
+        size_t lineEnd = newline == nullptr ? chunkEnd : newline - source;
+        scanLine(lineStart, lineEnd, lineNumber);
+
+        // Feed a newline token at the end of every (non-last) line.
+        bool isLastLine = lineEnd == size || lineEnd + 1 == size;
+        if (!isLastLine) {
+            pushWhitespace(lineNumber, lineEnd, 1);
+        }
+        lineStart = lineEnd + 1;
+        lineNumber++;
+        return true;
+    }
+
+    std::vector<SourceToken>& tokens() {
+        return result;
+    }
+
+  private:
+    const char* source;
+    size_t size;
+    bool willLexWithWhitespace;
+    const CharTable& table;
+    bool isFirstChunk{ true };
+    size_t lineStart{ 0 };
+    size_t chunkEnd{ 0 };
+    int lineNumber{ 1 };
+    // Type of the last token pushed, which may already have been taken out of `result`.
+    bool hasPushed{ false };
+    TokenType lastPushedType{ WHITESPACE };
+    std::vector<SourceToken> result;
+
+    CharClass classOf(char c) const {
+        return table.classes[static_cast<unsigned char>(c)];
+    }
+
+    void scanLine(size_t lineStart, size_t lineEnd, int lineNumber) {
+        size_t i = lineStart;
+        while (i < lineEnd) {
+            char c = source[i];
+            size_t j = i + 1;
+            switch (classOf(c)) {
+            case LETTER:
+                while (j < lineEnd && isWordChar(table, source[j])) {
+                    j++;
+                }
+                push(NAME, lineNumber, i, j - i);
+                break;
+            case DIGIT:
+                while (j < lineEnd && classOf(source[j]) == DIGIT) {
+                    j++;
+                }
+                // Integers cannot be '00001'.
+                if (c == '0' && j - i > 1) {
+                    throw std::runtime_error("Trailing zeroes not allowed: " + std::string(source + i, j - i));
+                }
+                push(INTEGER, lineNumber, i, j - i);
+                break;
+            case SPACE:
+                while (j < lineEnd && classOf(source[j]) == SPACE) {
+                    j++;
+                }
+                pushWhitespace(lineNumber, i, j - i);
+                break;
+            case SYMBOL: {
+                const SymbolRule& rule = table.symbols[static_cast<unsigned char>(c)];
+                if (rule.second != '\0' && j < lineEnd && source[j] == rule.second) {
+                    j++;
+                    push(rule.pair, lineNumber, i, 2);
+                } else if (rule.hasSingle) {
+                    push(rule.single, lineNumber, i, 1);
+                } else {
+                    throwNoRules(i, lineEnd, lineNumber);
+                }
+                break;
+            }
+            default:
+                throwNoRules(i, lineEnd, lineNumber);
+            }
+            i = j;
+        }
+    }
+
+    void push(TokenType type, int lineNumber, size_t offset, size_t length) {
+        result.push_back({ type, lineNumber, static_cast<uint32_t>(offset), static_cast<uint32_t>(length) });
+        hasPushed = true;
+        lastPushedType = type;
+    }
+
+    // Compress whitespaces together. For e.g. " \n " will be stored as 1 whitespace, and
+    // leading whitespaces are dropped.
+    void pushWhitespace(int lineNumber, size_t offset, size_t length) {
+        if (!willLexWithWhitespace || (!hasPushed && isFirstChunk) ||
+            (hasPushed && lastPushedType == WHITESPACE)) {
+            return;
+        }
+        push(WHITESPACE, lineNumber, offset, length);
+    }
+
+    void throwNoRules(size_t position, size_t lineEnd, int lineNumber) {
+        throw std::runtime_error("Lexer: No rules available to parse the remaining line: <" +
+                                 std::string(source + position, lineEnd - position) +
+                                 "> at line: " + std::to_string(lineNumber));
+    }
+};
+
+TokenizedSource::TokenizedSource(std::shared_ptr<const SourceBuffer> buffer, std::vector<SourceToken> tokens)
+: buffer(std::move(buffer)), tokens(std::move(tokens)) {
+}
+
+TokenizedSource TokenizedSource::fromTokens(const std::vector<Token>& tokens) {
+    std::string text;
+    std::vector<SourceToken> sourceTokens;
+    sourceTokens.reserve(tokens.size());
+    for (const Token& token : tokens) {
+        const std::string& value = token.type == INTEGER ? token.integerValue : token.nameValue;
+        sourceTokens.push_back({ token.type, token.line, static_cast<uint32_t>(text.size()),
+                                 static_cast<uint32_t>(value.size()) });
+        text += value;
+    }
+    return TokenizedSource(SourceBuffer::fromString(std::move(text)), std::move(sourceTokens));
+}
+
+std::string TokenizedSource::text(const SourceToken& token) const {
+    return std::string(buffer->data() + token.offset, token.length);
+}
+
+bool TokenizedSource::textEquals(const SourceToken& token, const std::string& value) const {
+    return token.length == value.size() && value.compare(0, value.size(), buffer->data() + token.offset,
+                                                         token.length) == 0;
+}
+
+TokenizedSource TokenizedSource::slice(size_t begin, size_t end) const {
+    return TokenizedSource(buffer, std::vector<SourceToken>(tokens.begin() + begin, tokens.begin() + end));
+}
+
+std::vector<Token> TokenizedSource::toTokens() const {
+    std::vector<Token> result;
+    result.reserve(tokens.size());
+    // Line positions are recovered by walking the buffer alongside the tokens, which are ordered.
+    int currentLine = 1;
+    size_t lineStart = 0;
+    for (const SourceToken& sourceToken : tokens) {
+        while (currentLine < sourceToken.line) {
+            const char* newline =
+            static_cast<const char*>(memchr(buffer->data() + lineStart, '\n', buffer->size() - lineStart));
+            if (newline == nullptr) {
+                // Built by fromTokens, which does not keep line breaks.
+                break;
+            }
+            lineStart = newline - buffer->data() + 1;
+            currentLine++;
+        }
+        Token token(sourceToken.type);
+        token.line = sourceToken.line;
+        // The newline token is positioned at the start of its line.
+        bool isNewline = sourceToken.type == WHITESPACE && sourceToken.length > 0 &&
+                         buffer->data()[sourceToken.offset] == '\n';
+        token.linePosition = isNewline ? 0 : static_cast<int>(sourceToken.offset - lineStart);
+        if (sourceToken.type == NAME) {
+            token.nameValue = text(sourceToken);
+        } else if (sourceToken.type == INTEGER) {
+            token.integerValue = text(sourceToken);
+        }
+        result.push_back(std::move(token));
+    }
+    return result;
+}
+
+TokenStream::TokenStream(TokenizedSource source) : source(std::move(source)) {
+}
+
+TokenStream::TokenStream(std::shared_ptr<const SourceBuffer> buffer)
+: buffer(std::move(buffer)), scanner(new Scanner(*this->buffer, false)) {
+    scanner->start(0, this->buffer->size(), 1);
+}
+
+TokenStream::TokenStream(TokenStream&&) = default;
+TokenStream& TokenStream::operator=(TokenStream&&) = default;
+TokenStream::~TokenStream() = default;
+
+const SourceToken* TokenStream::peek(size_t position) {
+    if (!scanner) {
+        return position < source.size() ? &source[position] : nullptr;
+    }
+    if (position < windowStart) {
+        throw std::runtime_error("Lexer: Token " + std::to_string(position) + " was already released");
+    }
+    // Lex lines until the token is in the window.
+    while (position >= windowStart + window.size()) {
+        if (!scanner->scanNextLine()) {
+            return nullptr;
+        }
+        std::vector<SourceToken>& lineTokens = scanner->tokens();
+        window.insert(window.end(), lineTokens.begin(), lineTokens.end());
+        lineTokens.clear();
+        peakWindowSize = std::max(peakWindowSize, window.size());
+    }
+    return &window[position - windowStart];
+}
+
+void TokenStream::release(size_t position) {
+    while (windowStart < position && !window.empty()) {
+        window.pop_front();
+        windowStart++;
+    }
+}
+
+std::string TokenStream::text(const SourceToken& token) const {
+    return scanner ? std::string(buffer->data() + token.offset, token.length) : source.text(token);
+}
+
+bool TokenStream::textEquals(const SourceToken& token, const std::string& value) const {
+    if (!scanner) {
+        return source.textEquals(token, value);
+    }
+    return token.length == value.size() && value.compare(0, value.size(), buffer->data() + token.offset,
+                                                         token.length) == 0;
+}
+
+const TokenizedSource* TokenStream::tokenizedSource() const {
+    return scanner ? nullptr : &source;
+}
+
+size_t TokenStream::getPeakWindowSize() const {
+    return scanner ? peakWindowSize : source.size();
+}
+
+TokenizedSource tokenize(std::shared_ptr<const SourceBuffer> buffer, bool willLexWithWhitespace) {
+    std::vector<SourceToken> tokens = Scanner(*buffer, willLexWithWhitespace).scan();
+    return TokenizedSource(std::move(buffer), std::move(tokens));
+}
+
+namespace {
+// Below this many bytes per chunk, starting a thread costs more than lexing the chunk.
+const size_t MIN_PARALLEL_CHUNK_SIZE = 64 * 1024;
+
+// Concatenates the tokens of a chunk, compressing whitespace across the chunk boundary.
+void appendChunk(std::vector<SourceToken>& result, const std::vector<SourceToken>& chunk) {
+    auto begin = chunk.begin();
+    if (begin != chunk.end() && begin->type == WHITESPACE &&
+        (result.empty() || result.back().type == WHITESPACE)) {
+        ++begin;
+    }
+    result.insert(result.end(), begin, chunk.end());
+}
+
+// Runs `work(i)` for every chunk on its own thread. The exception of the earliest failing chunk is
+// rethrown, which is the error that lexing the chunks in order would have thrown.
+template <typename Work> void runChunks(size_t chunkCount, Work work) {
+    std::vector<std::exception_ptr> errors(chunkCount);
+    std::vector<std::thread> workers;
+    workers.reserve(chunkCount);
+    for (size_t i = 0; i < chunkCount; i++) {
+        workers.emplace_back([&work, &errors, i]() {
+            try {
+                work(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+} // namespace
+
+TokenizedSource tokenizeInParallel(std::shared_ptr<const SourceBuffer> buffer,
+                                   bool willLexWithWhitespace,
+                                   unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const char* source = buffer->data();
+    size_t size = buffer->size();
+    size_t chunkCount = std::min<size_t>(threadCount, size / MIN_PARALLEL_CHUNK_SIZE);
+    if (chunkCount <= 1) {
+        return tokenize(std::move(buffer), willLexWithWhitespace);
+    }
+
+    // Split into line aligned chunks of roughly equal size: every chunk ends just past a '\n'.
+    std::vector<size_t> bounds = { 0 };
+    for (size_t i = 1; i < chunkCount; i++) {
+        size_t target = std::max(bounds.back(), size * i / chunkCount);
+        const char* newline = static_cast<const char*>(memchr(source + target, '\n', size - target));
+        if (newline == nullptr) {
+            break;
+        }
+        size_t bound = newline - source + 1;
+        if (bound > bounds.back() && bound < size) {
+            bounds.push_back(bound);
+        }
+    }
+    bounds.push_back(size);
+    chunkCount = bounds.size() - 1;
+
+    // The first line of every chunk is only known once the lines of the chunks before it are counted.
+    std::vector<int> lineCounts(chunkCount);
+    runChunks(chunkCount, [&](size_t i) {
+        lineCounts[i] = static_cast<int>(std::count(source + bounds[i], source + bounds[i + 1], '\n'));
+    });
+    std::vector<int> firstLines = { 1 };
+    for (size_t i = 0; i + 1 < chunkCount; i++) {
+        firstLines.push_back(firstLines.back() + lineCounts[i]);
+    }
+
+    std::vector<std::vector<SourceToken>> chunks(chunkCount);
+    runChunks(chunkCount, [&](size_t i) {
+        chunks[i] = Scanner(*buffer, willLexWithWhitespace).scan(bounds[i], bounds[i + 1], firstLines[i]);
+    });
+
+    size_t tokenCount = 0;
+    for (const std::vector<SourceToken>& chunk : chunks) {
+        tokenCount += chunk.size();
+    }
+    std::vector<SourceToken> tokens;
+    tokens.reserve(tokenCount);
+    for (const std::vector<SourceToken>& chunk : chunks) {
+        appendChunk(tokens, chunk);
+    }
+    return TokenizedSource(std::move(buffer), std::move(tokens));
+}
+
+// The original regex based lexer, kept as the reference that `tokenize` is checked and
+// benchmarked against. It constructs a regex per rule at every position, so it is slow.
+std::vector<Token> tokenizeWithRegex(std::istream& stream, bool willLexWithWhitespace) {
     std::vector<Token> result;
 
     int lineNumber = 1;
@@ -183,12 +652,20 @@ std::vector<Token> tokenize(std::istream& stream, bool willLexWithWhitespace) {
 // Public API definition
 
 std::vector<Token> tokenize(std::istream& stream) {
-    return tokenize(stream, false);
+    return tokenize(SourceBuffer::fromStream(stream), false).toTokens();
 };
 
 std::vector<Token> tokenizeWithWhitespace(std::istream& stream) {
-    return tokenize(stream, true);
+    return tokenize(SourceBuffer::fromStream(stream), true).toTokens();
 };
 
+TokenizedSource tokenize(std::shared_ptr<const SourceBuffer> buffer) {
+    return tokenize(std::move(buffer), false);
+}
+
+TokenizedSource tokenizeWithWhitespace(std::shared_ptr<const SourceBuffer> buffer) {
+    return tokenize(std::move(buffer), true);
+}
+
 } // namespace lexer
 } // namespace backend
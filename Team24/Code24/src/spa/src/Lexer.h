@@ -1,8 +1,13 @@
 #pragma once
 
+#include "SourceBuffer.h"
+
 #include <algorithm>
+#include <cstdint>
+#include <deque>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <regex>
 #include <string>
 #include <vector>
@@ -60,8 +65,113 @@ struct Token {
     explicit Token(TokenType t) : type(t), line(), linePosition(), nameValue(), integerValue(){};
 };
 
+// Compact token that refers to its text in a SourceBuffer instead of owning a copy of it.
+struct SourceToken {
+    TokenType type;
+    int line;
+    // Position of the token's text in the SourceBuffer.
+    uint32_t offset;
+    uint32_t length;
+};
+
+/**
+ * Tokens of a source text, together with the SourceBuffer that their text refers to.
+ */
+class TokenizedSource {
+  public:
+    TokenizedSource() = default;
+    TokenizedSource(std::shared_ptr<const SourceBuffer> buffer, std::vector<SourceToken> tokens);
+
+    // Builds a TokenizedSource from owning tokens. The line positions of the tokens are not kept.
+    static TokenizedSource fromTokens(const std::vector<Token>& tokens);
+
+    size_t size() const {
+        return tokens.size();
+    }
+    const SourceToken& operator[](size_t index) const {
+        return tokens[index];
+    }
+
+    std::string text(const SourceToken& token) const;
+    // Compares the text of the token without copying it.
+    bool textEquals(const SourceToken& token, const std::string& value) const;
+
+    // Returns the tokens in [begin, end), sharing this SourceBuffer.
+    TokenizedSource slice(size_t begin, size_t end) const;
+
+    // Converts to owning tokens, e.g. for callers that outlive the SourceBuffer.
+    std::vector<Token> toTokens() const;
+
+  private:
+    std::shared_ptr<const SourceBuffer> buffer;
+    std::vector<SourceToken> tokens;
+};
+
+class Scanner;
+
+/**
+ * Tokens that are pulled on demand, either from a source that was tokenized up front or by lexing a
+ * SourceBuffer one line at a time. A lexed stream only holds the tokens from the oldest position
+ * that is still needed, so its memory does not grow with the size of the source.
+ */
+class TokenStream {
+  public:
+    explicit TokenStream(TokenizedSource source);
+    // Lexes the buffer, without whitespace, as its tokens are peeked.
+    explicit TokenStream(std::shared_ptr<const SourceBuffer> buffer);
+    TokenStream(TokenStream&&);
+    TokenStream& operator=(TokenStream&&);
+    ~TokenStream();
+
+    /**
+     * @return the token at `position`, or nullptr if the source has no more tokens. The token stays
+     * valid until it is released.
+     * @throws std::runtime_error if lexing up to `position` fails, or if the token at `position` was
+     * already released.
+     */
+    const SourceToken* peek(size_t position);
+    // Tokens before `position` will not be peeked again, so a lexed stream can drop them.
+    void release(size_t position);
+
+    std::string text(const SourceToken& token) const;
+    bool textEquals(const SourceToken& token, const std::string& value) const;
+
+    // Returns all tokens if the source was tokenized up front, or nullptr if it is lexed on demand.
+    const TokenizedSource* tokenizedSource() const;
+    // Returns the most tokens held at once.
+    size_t getPeakWindowSize() const;
+
+  private:
+    std::shared_ptr<const SourceBuffer> buffer;
+    // Set only when lexing on demand.
+    std::unique_ptr<Scanner> scanner;
+    TokenizedSource source;
+    // Tokens [windowStart, windowStart + window.size()) of a stream lexed on demand.
+    std::deque<SourceToken> window;
+    size_t windowStart{ 0 };
+    size_t peakWindowSize{ 0 };
+};
+
 std::vector<Token> tokenize(std::istream& stream);
 
 std::vector<Token> tokenizeWithWhitespace(std::istream& stream);
+
+TokenizedSource tokenize(std::shared_ptr<const SourceBuffer> buffer);
+
+TokenizedSource tokenizeWithWhitespace(std::shared_ptr<const SourceBuffer> buffer);
+
+/**
+ * Tokenizes the buffer on several threads. The buffer is split into line aligned chunks that are
+ * lexed independently and concatenated in order, so the tokens, line numbers and errors are the same
+ * as those of `tokenize`/`tokenizeWithWhitespace`. Small sources are lexed on the calling thread.
+ * @param threadCount The maximum number of threads to use, or 0 to use one per hardware thread.
+ */
+TokenizedSource tokenizeInParallel(std::shared_ptr<const SourceBuffer> buffer,
+                                   bool willLexWithWhitespace,
+                                   unsigned int threadCount = 0);
+
+// Regex based reference lexer producing the same tokens as `tokenize`/`tokenizeWithWhitespace`.
+// Only meant for testing and benchmarking.
+std::vector<Token> tokenizeWithRegex(std::istream& stream, bool willLexWithWhitespace);
 } // namespace lexer
 } // namespace backend
@@ -4,6 +4,7 @@
 
 #include "QPTypes.h"
 
+#include <algorithm>
 #include <cassert>
 #include <functional>
 #include <iostream>
@@ -1,19 +1,24 @@
 #pragma once
 
 #include <set>
+#include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 typedef std::string PROCEDURE_NAME;
 typedef std::vector<PROCEDURE_NAME> PROCEDURE_NAME_LIST;
 typedef std::unordered_set<std::string> PROCEDURE_NAME_SET;
+typedef std::vector<std::pair<PROCEDURE_NAME, PROCEDURE_NAME>> PROCEDURE_NAME_PAIR_LIST;
 
 typedef std::string VARIABLE_NAME;
 typedef std::vector<VARIABLE_NAME> VARIABLE_NAME_LIST;
 typedef std::unordered_set<std::string> VARIABLE_NAME_SET;
 
 typedef int STATEMENT_NUMBER;
+typedef std::vector<STATEMENT_NUMBER> STATEMENT_NUMBER_LIST;
 typedef std::unordered_set<STATEMENT_NUMBER> STATEMENT_NUMBER_SET;
+typedef std::vector<std::pair<STATEMENT_NUMBER, STATEMENT_NUMBER>> STATEMENT_NUMBER_PAIR_LIST;
 
 typedef std::string CONSTANT_NAME;
 typedef std::unordered_set<CONSTANT_NAME> CONSTANT_NAME_SET;
@@ -23,6 +28,9 @@ typedef std::unordered_set<PROGRAM_LINE> PROGRAM_LINE_SET;
 
 
 namespace backend {
+// The transitive relations between statements that getTransitivePairs answers.
+enum TransitiveStatementRelation { NextTransitive, AffectsTransitive, ParentTransitive };
+
 class PKB {
   public:
     PKB() = default;
@@ -87,6 +95,13 @@ class PKB {
     // Get all statements that follow some statement.
     virtual STATEMENT_NUMBER_SET getAllStatementsThatFollows() const = 0;
 
+    // The same statements as getStatementsThatFollows and getStatementsFollowedBy, in the order of
+    // their statement list, without building a set.
+    virtual STATEMENT_NUMBER_LIST getStatementsThatFollowAsList(STATEMENT_NUMBER s) const = 0;
+    virtual STATEMENT_NUMBER_LIST getStatementsFollowedByAsList(STATEMENT_NUMBER s) const = 0;
+    // Whether Follows*(a, b) holds.
+    virtual bool isFollowsTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const = 0;
+
 
     /* -- PARENT / PARENT* -- */
     // Retrieves all the statements that
@@ -111,6 +126,10 @@ class PKB {
     // of the statement at this statement number.
     virtual STATEMENT_NUMBER_SET getDescendants(STATEMENT_NUMBER statementNumber) const = 0;
     virtual STATEMENT_NUMBER_SET getStatementsThatHaveDescendants() const = 0;
+    // The same statements as getDescendants, in increasing order, without building a set.
+    virtual STATEMENT_NUMBER_LIST getDescendantsAsList(STATEMENT_NUMBER statementNumber) const = 0;
+    // Whether Parent*(a, b) holds.
+    virtual bool isParentTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const = 0;
 
     /* -- USES -- */
     // Get all statements that Uses v
@@ -195,6 +214,8 @@ class PKB {
     // list of all statement numbers that goes to `statementNumber`
     virtual STATEMENT_NUMBER_SET
     getPreviousStatementOf(STATEMENT_NUMBER statementNumber, bool isTransitive) const = 0;
+    // Whether Next*(a, b) holds.
+    virtual bool isNextTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const = 0;
 
     virtual const STATEMENT_NUMBER_SET& getAllStatementsWithNext() const = 0;
     virtual const STATEMENT_NUMBER_SET& getAllStatementsWithPrev() const = 0;
@@ -222,6 +243,8 @@ class PKB {
     // i.e. get all assignment statements such that Affects(statementNumber, s) is true.
     virtual PROGRAM_LINE_SET getStatementsAffectedBy(PROGRAM_LINE statementNumber, bool isTransitive) const = 0;
     virtual PROGRAM_LINE_SET getStatementsThatAffect(PROGRAM_LINE statementNumber, bool isTransitive) const = 0;
+    // Whether Affects*(a, b) holds.
+    virtual bool isAffectsTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const = 0;
     virtual const PROGRAM_LINE_SET& getAllStatementsThatAffect() const = 0;
     virtual const PROGRAM_LINE_SET& getAllStatementsThatAreAffected() const = 0;
 
@@ -239,6 +262,40 @@ class PKB {
     virtual const PROGRAM_LINE_SET& getAllStatementsThatAffectBip() const = 0;
     virtual const PROGRAM_LINE_SET& getAllStatementsThatAreAffectedBip() const = 0;
 
+    /* -- PROCEDURE PARTITION -- */
+    // The statements of a procedure are numbered consecutively, and Follows, Parent, Next and
+    // Affects, and their transitive closures, only hold between statements of the same procedure.
+    // Get the procedure that a statement is in, or "" if s is not a statement.
+    virtual PROCEDURE_NAME getProcedureOfStatement(STATEMENT_NUMBER s) const = 0;
+    // Get the first and last statement of a procedure, or {0, 0} if there is no such procedure.
+    virtual std::pair<STATEMENT_NUMBER, STATEMENT_NUMBER> getStatementRange(const PROCEDURE_NAME& p) const = 0;
+    // Checks whether a and b are statements of the same procedure, in constant time.
+    // Example query:
+    //     Select BOOLEAN such that Next*(5, 9000)
+    // Possible query plan:
+    //     return isInSameProcedure(5, 9000) && <ask getNextStatementOf(5, true)>
+    virtual bool isInSameProcedure(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const = 0;
+
+    /* -- BATCHED TRANSITIVE RELATIONS -- */
+    // Get every pair (s, t), with s in sources and t in targets, such that the relation holds
+    // for s and t, such as Next*(s, t). The sources are searched together rather than one at a
+    // time.
+    // Example query:
+    //     stmt s1, s2; select s1 such that Next*(s1, s2)
+    // Possible query plan:
+    //     getTransitivePairs(NextTransitive, <candidates of s1>, <candidates of s2>)
+    virtual STATEMENT_NUMBER_PAIR_LIST getTransitivePairs(TransitiveStatementRelation relation,
+                                                          const std::vector<STATEMENT_NUMBER>& sources,
+                                                          const std::vector<STATEMENT_NUMBER>& targets) const = 0;
+    // Get every pair (p, q), with p in callers and q in callees, such that Calls*(p, q), searching
+    // from all callers together as getTransitivePairs does.
+    // Example query:
+    //     procedure p, q; select p such that Calls*(p, q)
+    // Possible query plan:
+    //     getTransitiveCallPairs(<candidates of p>, <candidates of q>)
+    virtual PROCEDURE_NAME_PAIR_LIST getTransitiveCallPairs(const PROCEDURE_NAME_LIST& callers,
+                                                            const PROCEDURE_NAME_LIST& callees) const = 0;
+
     /* -- Patterns -- */
     // Get all assignment statements that matches the input pattern.
     // Example:
@@ -249,6 +306,14 @@ class PKB {
                                                                      const std::string& pattern,
                                                                      bool isSubExpr) const = 0;
 
+    // Same as getAllAssignmentStatementsThatMatch, but `canonicalPattern` is already in the canonical
+    // form returned by Parser::parseExpr, e.g. "x + y*2" is "(x+(y*2))", which is how the
+    // QueryPreprocessor stores patterns. It is matched as is, without being parsed again.
+    // An empty `canonicalPattern` matches any expression.
+    virtual STATEMENT_NUMBER_SET getAllAssignmentStatementsThatMatchCanonical(const std::string& assignee,
+                                                                              const std::string& canonicalPattern,
+                                                                              bool isSubExpr) const = 0;
+
 
     /**
      * Example:
@@ -7,33 +7,50 @@
 #include "Parser.h"
 #include "TNode.h"
 
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace backend {
+namespace {
+template <typename Range> STATEMENT_NUMBER_SET toSet(const Range& range) {
+    return STATEMENT_NUMBER_SET(range.begin(), range.end());
+}
+
+VARIABLE_NAME_LIST toVariableNames(const ProgramIR& program, CompressedRelation::Range variables) {
+    VARIABLE_NAME_LIST names;
+    names.reserve(variables.size());
+    for (VARIABLE_ID variable : variables) {
+        names.push_back(program.getVariableName(variable));
+    }
+    return names;
+}
+} // namespace
 
 PKBImplementation::PKBImplementation(const TNode& ast) {
     logWord("PKB starting with ast");
-    logLine(ast.toString());
-
-    if (!extractor::isValidSimpleProgram(ast)) {
-        throw std::runtime_error("Provided AST does not represent a valid SIMPLE program");
-    }
+    logTNode(ast);
 
+    // Visit the AST once for every table that is read off it. This also checks that the AST is a
+    // valid SIMPLE program.
+    extractor::DesignTables tables = extractor::extractDesign(ast);
 
-    tNodeToStatementNumber = extractor::getTNodeToStatementNumber(ast);
-    statementNumberToTNode = extractor::getStatementNumberToTNode(tNodeToStatementNumber);
-    tNodeTypeToTNodesMap = extractor::getTNodeTypeToTNodes(ast);
-    statementNumberToTNodeType = extractor::getStatementNumberToTNodeTypeMap(statementNumberToTNode);
+    // The tables keyed by TNode are only used while the PKB is built. What the PKB needs afterwards
+    // is kept in `program`, so the AST can be freed once the PKB is built.
+    std::unordered_map<const TNode*, int>& tNodeToStatementNumber = tables.tNodeToStatementNumber;
+    std::unordered_map<TNodeType, std::vector<const TNode*>, EnumClassHash>& tNodeTypeToTNodesMap =
+    tables.tNodeTypeToTNodes;
+    program = std::move(tables.program);
 
-    for (auto i : statementNumberToTNode) {
-        allStatementsNumber.insert(i.first);
+    for (STATEMENT_NUMBER s = 1; s <= program.getStatementCount(); ++s) {
+        allStatementsNumber.insert(s);
     }
 
     // Get mapping of all procedures that calls (procedureToCalledProcedures) and
     // are called by procedureToCallers) procedure:
-    for (const auto& p : extractor::getProcedureToCallees(tNodeTypeToTNodesMap)) {
+    for (const auto& p : tables.procedureToCallees) {
         PROCEDURE_NAME callerName = p.first->name;
 
         for (auto calledProcedure : p.second) {
@@ -108,42 +125,71 @@ PKBImplementation::PKBImplementation(const TNode& ast) {
     }
 
     // Follow
-    std::tie(followFollowedRelation, followedFollowRelation) = extractor::getFollowRelationship(ast);
-    allStatementsThatFollows = extractor::getKeysInMap(followFollowedRelation);
-    allStatementsThatAreFollowed = extractor::getKeysInMap(followedFollowRelation);
-
-    for (auto i : allStatementsNumber) {
-        transitiveFollows[i] = extractor::getVisitedPathFromStart(i, followedFollowRelation);
-    }
-    for (auto i : allStatementsNumber) {
-        transitiveFollowed[i] = extractor::getVisitedPathFromStart(i, followFollowedRelation);
+    std::vector<std::pair<int, int>> statementListEdges;
+    statementListEdges.reserve(program.getStatementCount());
+    for (STATEMENT_NUMBER s = 1; s <= program.getStatementCount(); ++s) {
+        statementListEdges.emplace_back(program.getStatement(s).statementList, s);
     }
+    statementListToStatements = CompressedRelation::fromEdges(std::move(statementListEdges));
+    followFollowedRelation = CompressedRelation::fromMap(tables.followFollowedRelation);
+    followedFollowRelation = CompressedRelation::fromMap(tables.followedFollowRelation);
+    allStatementsThatFollows = toSet(followFollowedRelation.getSources());
+    allStatementsThatAreFollowed = toSet(followedFollowRelation.getSources());
 
     // Parent
-    std::tie(childrenParentRelation, parentChildrenRelation) = extractor::getParentRelationship(ast);
-    allStatementsThatHaveAncestors = extractor::getKeysInMap(childrenParentRelation);
-    allStatementsThatHaveDescendants = extractor::getKeysInMap(parentChildrenRelation);
+    childrenParentRelation = CompressedRelation::fromMap(tables.childrenParentRelation);
+    parentChildrenRelation = CompressedRelation::fromMap(tables.parentChildrenRelation);
+    allStatementsThatHaveAncestors = toSet(childrenParentRelation.getSources());
+    allStatementsThatHaveDescendants = toSet(parentChildrenRelation.getSources());
+    // A child is numbered after its parent, so visiting the statements backwards extends every
+    // parent's interval after those of its children.
+    lastDescendant.resize(program.getStatementCount() + 1);
+    for (STATEMENT_NUMBER s = program.getStatementCount(); s > 0; --s) {
+        lastDescendant[s] = std::max(lastDescendant[s], s);
+        STATEMENT_NUMBER parent = program.getStatement(s).parent;
+        if (parent != 0) {
+            lastDescendant[parent] = std::max(lastDescendant[parent], lastDescendant[s]);
+        }
+    }
 
     // next
-    nextRelationship = extractor::getNextRelationship(tNodeTypeToTNodesMap, tNodeToStatementNumber);
-    for (const auto& pair : nextRelationship) {
-        statementsWithNext.insert(pair.first);
+    std::unordered_map<STATEMENT_NUMBER, std::unordered_set<STATEMENT_NUMBER>> nextMap =
+    extractor::getNextRelationship(tNodeTypeToTNodesMap, tNodeToStatementNumber);
+    nextRelationship = CompressedRelation::fromMap(nextMap);
+    previousRelationship = nextRelationship.reversed();
+    for (PROCEDURE_ID id = 0; id < static_cast<PROCEDURE_ID>(program.getProcedures().size()); ++id) {
+        const ProcedureIR& procedure = program.getProcedures()[id];
+        procedureIds.emplace(procedure.name, id);
+        if (procedure.firstStatement != 0) {
+            procedureRanges.emplace_back(procedure.firstStatement, procedure.lastStatement);
+        }
     }
-    previousRelationship = extractor::getPreviousRelationship(nextRelationship);
-    for (const auto& pair : previousRelationship) {
-        statementsWithPrev.insert(pair.first);
+    std::vector<std::pair<int, int>> callEdges;
+    for (const auto& callees : procedureToCalledProcedures) {
+        for (const PROCEDURE_NAME& callee : callees.second) {
+            callEdges.emplace_back(procedureIds.at(callees.first), procedureIds.at(callee));
+        }
+    }
+    callsRelation = CompressedRelation::fromEdges(std::move(callEdges));
+    controlFlowGraph = ControlFlowGraph(program, nextRelationship, previousRelationship);
+    std::vector<std::pair<int, int>> blockRanges;
+    for (const std::pair<int, int>& range : procedureRanges) {
+        blockRanges.emplace_back(controlFlowGraph.getBlock(range.first), controlFlowGraph.getBlock(range.second));
     }
+    blockReachability = ReachabilityIndex(controlFlowGraph.getSuccessors(), blockRanges, 0);
+    statementsWithNext = toSet(nextRelationship.getSources());
+    statementsWithPrev = toSet(previousRelationship.getSources());
 
-    // NextBip
+    // NextBip. The end-nodes of the procedures are only needed to build the relation.
+    std::unordered_map<STATEMENT_NUMBER, std::unique_ptr<const TNode>> procedureEndNodes;
     std::tie(nextBipRelationship, procedureEndNodes) =
-    extractor::getNextBipRelationship(nextRelationship, tNodeTypeToTNodesMap, tNodeToStatementNumber);
+    extractor::getNextBipRelationship(nextMap, tNodeTypeToTNodesMap, tNodeToStatementNumber);
     previousBipRelationship = extractor::getPreviousBipRelationship(nextBipRelationship);
 
 
     // Pattern
-    patternsMap = extractor::getPatternsMap(tNodeTypeToTNodesMap[Assign], tNodeToStatementNumber);
-    conditionVariablesToStatementNumbers =
-    extractor::getConditionVariablesToStatementNumbers(statementNumberToTNode);
+    patternIndex = std::move(tables.patternIndex);
+    conditionVariablesToStatementNumbers = std::move(tables.conditionVariablesToStatementNumbers);
     std::unordered_set<int> allConditionStatementWithVariables;
     for (const auto& pair : conditionVariablesToStatementNumbers) {
         for (int stmtNo : pair.second) {
@@ -154,23 +200,18 @@ PKBImplementation::PKBImplementation(const TNode& ast) {
     allIfElseCondWithVariables = foost::SetIntersection(allConditionStatementWithVariables, allIfElseStatements);
 
     // Uses
-    usesMapping = extractor::getUsesMapping(tNodeTypeToTNodesMap);
+    variableToStatementsThatUseIt = program.getUses().reversed();
+    const std::unordered_map<const TNode*, std::unordered_set<std::string>>& usesMapping = tables.usesMapping;
 
     for (auto& p : usesMapping) {
         const TNode* tNode = p.first;
-        std::unordered_set<VARIABLE_NAME> usedVariables = p.second;
+        const std::unordered_set<VARIABLE_NAME>& usedVariables = p.second;
         // For Statements
         if (tNode->isStatementNode()) {
-            STATEMENT_NUMBER statementNumber = tNodeToStatementNumber[tNode];
+            STATEMENT_NUMBER statementNumber = tNodeToStatementNumber.at(tNode);
             // Update statement -> variable
             allStatementsThatUseSomeVariable.insert(statementNumber);
-            statementToUsedVariables[statementNumber] = usedVariables;
-
-            // Update variable -> statement
-            for (const VARIABLE_NAME& variable : usedVariables) {
-                variableToStatementsThatUseIt[variable].insert(statementNumber);
-                allVariablesUsedBySomeStatement.insert(variable);
-            }
+            allVariablesUsedBySomeStatement.insert(usedVariables.begin(), usedVariables.end());
             // For Procedures
         } else if (tNode->type == TNodeType::Procedure) {
             PROCEDURE_NAME procedureName = tNode->name;
@@ -189,22 +230,18 @@ PKBImplementation::PKBImplementation(const TNode& ast) {
     }
 
     // Modifies
-    modifiesMapping = extractor::getModifiesMapping(tNodeTypeToTNodesMap);
+    variableToStatementsThatModifyIt = program.getModifies().reversed();
+    const std::unordered_map<const TNode*, std::unordered_set<std::string>>& modifiesMapping =
+    tables.modifiesMapping;
     for (auto& p : modifiesMapping) {
         const TNode* tNode = p.first;
-        std::unordered_set<VARIABLE_NAME> modifiedVariables = p.second;
+        const std::unordered_set<VARIABLE_NAME>& modifiedVariables = p.second;
         // For Statements
         if (tNode->isStatementNode()) {
-            STATEMENT_NUMBER statementNumber = tNodeToStatementNumber[tNode];
+            STATEMENT_NUMBER statementNumber = tNodeToStatementNumber.at(tNode);
             // Update statement -> variable
             allStatementsThatModifySomeVariable.insert(statementNumber);
-            statementToModifiedVariables[statementNumber] = modifiedVariables;
-
-            // Update variable -> statement
-            for (const VARIABLE_NAME& variable : modifiedVariables) {
-                variableToStatementsThatModifyIt[variable].insert(statementNumber);
-                allVariablesModifiedBySomeStatement.insert(variable);
-            }
+            allVariablesModifiedBySomeStatement.insert(modifiedVariables.begin(), modifiedVariables.end());
             // For Procedures
         } else if (tNode->type == TNodeType::Procedure) {
             PROCEDURE_NAME procedureName = tNode->name;
@@ -223,17 +260,6 @@ PKBImplementation::PKBImplementation(const TNode& ast) {
     }
 
 
-    // affectsMapping = extractor::getAffectsMapping(tNodeTypeToTNodesMap, tNodeToStatementNumber,
-    // statementNumberToTNode, nextRelationship,
-    // previousRelationship, usesMapping, modifiesMapping);
-    // for (const auto& p : affectsMapping) {
-    // statementsThatAffect.insert(p.first);
-    //}
-    // affectedMapping = extractor::getAffectedMapping(affectsMapping);
-    // for (const auto& p : affectedMapping) {
-    // statementsThatAreAffected.insert(p.first);
-    //}
-
     std::tie(affectsBipMapping, affectsBipStarMapping) =
     extractor::getAffectsBipMapping(tNodeTypeToTNodesMap, tNodeToStatementNumber,
                                     extractor::getStatementNumberToTNode(tNodeToStatementNumber),
@@ -275,11 +301,7 @@ const STATEMENT_NUMBER_SET PKBImplementation::getCallStatementsWithProcedureName
 
 const PROCEDURE_NAME
 PKBImplementation::getProcedureNameFromCallStatement(STATEMENT_NUMBER callStatementNumber) const {
-    if (statementNumberToTNode.find(callStatementNumber) == statementNumberToTNode.end()) {
-        return VARIABLE_NAME();
-    }
-
-    if (statementNumberToTNodeType.at(callStatementNumber) != Call) {
+    if (!program.isStatement(callStatementNumber) || program.getStatement(callStatementNumber).type != Call) {
         return VARIABLE_NAME();
     }
 
@@ -294,11 +316,7 @@ const STATEMENT_NUMBER_SET PKBImplementation::getReadStatementsWithVariableName(
 }
 
 const VARIABLE_NAME PKBImplementation::getVariableNameFromReadStatement(STATEMENT_NUMBER readStatementNumber) const {
-    if (statementNumberToTNode.find(readStatementNumber) == statementNumberToTNode.end()) {
-        return VARIABLE_NAME();
-    }
-
-    if (statementNumberToTNodeType.at(readStatementNumber) != Read) {
+    if (!program.isStatement(readStatementNumber) || program.getStatement(readStatementNumber).type != Read) {
         return VARIABLE_NAME();
     }
     return readStatementsToVariableName.at(readStatementNumber);
@@ -313,11 +331,7 @@ const STATEMENT_NUMBER_SET PKBImplementation::getPrintStatementsWithVariableName
 
 const VARIABLE_NAME
 PKBImplementation::getVariableNameFromPrintStatement(STATEMENT_NUMBER printStatementNumber) const {
-    if (statementNumberToTNode.find(printStatementNumber) == statementNumberToTNode.end()) {
-        return VARIABLE_NAME();
-    }
-
-    if (statementNumberToTNodeType.at(printStatementNumber) != Print) {
+    if (!program.isStatement(printStatementNumber) || program.getStatement(printStatementNumber).type != Print) {
         return VARIABLE_NAME();
     }
     return printStatementsToVariableName.at(printStatementNumber);
@@ -326,33 +340,56 @@ PKBImplementation::getVariableNameFromPrintStatement(STATEMENT_NUMBER printState
 /** -------------------------- FOLLOWS ---------------------------- **/
 
 STATEMENT_NUMBER_SET PKBImplementation::getDirectFollow(STATEMENT_NUMBER s) const {
-    auto it = followedFollowRelation.find(s);
-    if (it == followedFollowRelation.end()) {
+    return toSet(followedFollowRelation.get(s));
+}
+
+STATEMENT_NUMBER_SET PKBImplementation::getDirectFollowedBy(STATEMENT_NUMBER s) const {
+    return toSet(followFollowedRelation.get(s));
+}
+
+STATEMENT_NUMBER_SET PKBImplementation::getStatementsThatFollows(STATEMENT_NUMBER s) const {
+    if (!program.isStatement(s)) {
         return {};
     }
-    return { it->second };
+    const StatementIR& statement = program.getStatement(s);
+    CompressedRelation::Range statements = statementListToStatements.get(statement.statementList);
+    return STATEMENT_NUMBER_SET(statements.begin() + statement.position + 1, statements.end());
 }
 
-STATEMENT_NUMBER_SET PKBImplementation::getDirectFollowedBy(STATEMENT_NUMBER s) const {
-    auto it = followFollowedRelation.find(s);
-    if (it == followFollowedRelation.end()) {
+STATEMENT_NUMBER_SET PKBImplementation::getStatementsFollowedBy(STATEMENT_NUMBER s) const {
+    if (!program.isStatement(s)) {
         return {};
     }
-    return { it->second };
+    const StatementIR& statement = program.getStatement(s);
+    CompressedRelation::Range statements = statementListToStatements.get(statement.statementList);
+    return STATEMENT_NUMBER_SET(statements.begin(), statements.begin() + statement.position);
 }
 
-STATEMENT_NUMBER_SET PKBImplementation::getStatementsThatFollows(STATEMENT_NUMBER s) const {
-    if (transitiveFollows.find(s) == transitiveFollows.end()) {
+STATEMENT_NUMBER_LIST PKBImplementation::getStatementsThatFollowAsList(STATEMENT_NUMBER s) const {
+    if (!program.isStatement(s)) {
         return {};
     }
-    return transitiveFollows.at(s);
+    const StatementIR& statement = program.getStatement(s);
+    CompressedRelation::Range statements = statementListToStatements.get(statement.statementList);
+    return STATEMENT_NUMBER_LIST(statements.begin() + statement.position + 1, statements.end());
 }
 
-STATEMENT_NUMBER_SET PKBImplementation::getStatementsFollowedBy(STATEMENT_NUMBER s) const {
-    if (transitiveFollowed.find(s) == transitiveFollowed.end()) {
+STATEMENT_NUMBER_LIST PKBImplementation::getStatementsFollowedByAsList(STATEMENT_NUMBER s) const {
+    if (!program.isStatement(s)) {
         return {};
     }
-    return transitiveFollowed.at(s);
+    const StatementIR& statement = program.getStatement(s);
+    CompressedRelation::Range statements = statementListToStatements.get(statement.statementList);
+    return STATEMENT_NUMBER_LIST(statements.begin(), statements.begin() + statement.position);
+}
+
+bool PKBImplementation::isFollowsTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const {
+    if (!program.isStatement(a) || !program.isStatement(b)) {
+        return false;
+    }
+    const StatementIR& first = program.getStatement(a);
+    const StatementIR& second = program.getStatement(b);
+    return first.statementList == second.statementList && first.position < second.position;
 }
 
 STATEMENT_NUMBER_SET PKBImplementation::getAllStatementsThatFollows() const {
@@ -366,23 +403,23 @@ STATEMENT_NUMBER_SET PKBImplementation::getAllStatementsThatAreFollowed() const
 /** -------------------------- PARENTS ---------------------------- **/
 
 STATEMENT_NUMBER_SET PKBImplementation::getParent(STATEMENT_NUMBER statementNumber) const {
-    auto it = childrenParentRelation.find(statementNumber);
-    if (it == childrenParentRelation.end()) {
-        return {};
-    }
-    return { it->second };
+    return toSet(childrenParentRelation.get(statementNumber));
 }
 
 STATEMENT_NUMBER_SET PKBImplementation::getChildren(STATEMENT_NUMBER statementNumber) const {
-    auto it = parentChildrenRelation.find(statementNumber);
-    if (it == parentChildrenRelation.end()) {
-        return {};
-    }
-    return it->second;
+    return toSet(parentChildrenRelation.get(statementNumber));
 }
 
 STATEMENT_NUMBER_SET PKBImplementation::getAncestors(STATEMENT_NUMBER s) const {
-    return extractor::getVisitedPathFromStart(s, childrenParentRelation);
+    STATEMENT_NUMBER_SET ancestors;
+    if (!program.isStatement(s)) {
+        return ancestors;
+    }
+    for (STATEMENT_NUMBER parent = program.getStatement(s).parent; parent != 0;
+         parent = program.getStatement(parent).parent) {
+        ancestors.insert(parent);
+    }
+    return ancestors;
 }
 
 STATEMENT_NUMBER_SET PKBImplementation::getStatementsThatHaveAncestors() const {
@@ -390,23 +427,30 @@ STATEMENT_NUMBER_SET PKBImplementation::getStatementsThatHaveAncestors() const {
 }
 
 STATEMENT_NUMBER_SET PKBImplementation::getDescendants(STATEMENT_NUMBER statementNumber) const {
-    std::unordered_set<int> visited;
-    std::vector<int> toVisit = { statementNumber };
-    while (!toVisit.empty()) {
-        int visiting = toVisit.back();
-        toVisit.pop_back();
-        if (visited.find(visiting) != visited.end()) {
-            continue;
-        }
-        visited.insert(visiting);
-        auto it = parentChildrenRelation.find(visiting);
-        if (it == parentChildrenRelation.end()) {
-            continue;
-        }
-        toVisit.insert(toVisit.end(), it->second.begin(), it->second.end());
+    STATEMENT_NUMBER_SET descendants;
+    if (!program.isStatement(statementNumber)) {
+        return descendants;
+    }
+    for (STATEMENT_NUMBER s = statementNumber + 1; s <= lastDescendant[statementNumber]; ++s) {
+        descendants.insert(s);
+    }
+    return descendants;
+}
+
+STATEMENT_NUMBER_LIST PKBImplementation::getDescendantsAsList(STATEMENT_NUMBER statementNumber) const {
+    STATEMENT_NUMBER_LIST descendants;
+    if (!program.isStatement(statementNumber)) {
+        return descendants;
+    }
+    descendants.reserve(lastDescendant[statementNumber] - statementNumber);
+    for (STATEMENT_NUMBER s = statementNumber + 1; s <= lastDescendant[statementNumber]; ++s) {
+        descendants.push_back(s);
     }
-    visited.erase(statementNumber);
-    return visited;
+    return descendants;
+}
+
+bool PKBImplementation::isParentTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const {
+    return program.isStatement(a) && program.isStatement(b) && a < b && b <= lastDescendant[a];
 }
 
 STATEMENT_NUMBER_SET PKBImplementation::getStatementsThatHaveDescendants() const {
@@ -415,12 +459,7 @@ STATEMENT_NUMBER_SET PKBImplementation::getStatementsThatHaveDescendants() const
 
 /** -------------------------- USES ---------------------------- **/
 STATEMENT_NUMBER_SET PKBImplementation::getStatementsThatUse(VARIABLE_NAME v) const {
-    auto it = variableToStatementsThatUseIt.find(v);
-    if (it == variableToStatementsThatUseIt.end()) {
-        return STATEMENT_NUMBER_SET();
-    } else {
-        return it->second;
-    }
+    return toSet(variableToStatementsThatUseIt.get(program.getVariableId(v)));
 }
 STATEMENT_NUMBER_SET PKBImplementation::getStatementsThatUseSomeVariable() const {
     return STATEMENT_NUMBER_SET(allStatementsThatUseSomeVariable.begin(),
@@ -451,12 +490,7 @@ VARIABLE_NAME_LIST PKBImplementation::getVariablesUsedBySomeProcedure() const {
                               allVariablesUsedBySomeProcedure.end());
 }
 VARIABLE_NAME_LIST PKBImplementation::getVariablesUsedIn(STATEMENT_NUMBER s) const {
-    auto it = statementToUsedVariables.find(s);
-    if (it == statementToUsedVariables.end()) {
-        return VARIABLE_NAME_LIST();
-    } else {
-        return VARIABLE_NAME_LIST(it->second.begin(), it->second.end());
-    }
+    return toVariableNames(program, program.getUsedVariables(s));
 }
 VARIABLE_NAME_LIST PKBImplementation::getVariablesUsedBySomeStatement() const {
     return VARIABLE_NAME_LIST(allVariablesUsedBySomeStatement.begin(),
@@ -465,12 +499,7 @@ VARIABLE_NAME_LIST PKBImplementation::getVariablesUsedBySomeStatement() const {
 
 /** -------------------------- MODIFIES ---------------------------- **/
 STATEMENT_NUMBER_SET PKBImplementation::getStatementsThatModify(VARIABLE_NAME v) const {
-    auto it = variableToStatementsThatModifyIt.find(v);
-    if (it == variableToStatementsThatModifyIt.end()) {
-        return STATEMENT_NUMBER_SET();
-    } else {
-        return it->second;
-    }
+    return toSet(variableToStatementsThatModifyIt.get(program.getVariableId(v)));
 }
 STATEMENT_NUMBER_SET PKBImplementation::getStatementsThatModifySomeVariable() const {
     return STATEMENT_NUMBER_SET(allStatementsThatModifySomeVariable.begin(),
@@ -501,12 +530,7 @@ VARIABLE_NAME_LIST PKBImplementation::getVariablesModifiedBySomeProcedure() cons
                               allVariablesModifiedBySomeProcedure.end());
 }
 VARIABLE_NAME_LIST PKBImplementation::getVariablesModifiedBy(STATEMENT_NUMBER s) const {
-    auto it = statementToModifiedVariables.find(s);
-    if (it == statementToModifiedVariables.end()) {
-        return VARIABLE_NAME_LIST();
-    } else {
-        return VARIABLE_NAME_LIST(it->second.begin(), it->second.end());
-    }
+    return toVariableNames(program, program.getModifiedVariables(s));
 }
 VARIABLE_NAME_LIST PKBImplementation::getVariablesModifiedBySomeStatement() const {
     return VARIABLE_NAME_LIST(allVariablesModifiedBySomeStatement.begin(),
@@ -524,6 +548,22 @@ PKBImplementation::getAllAssignmentStatementsThatMatch(const std::string& assign
 
     // catch `pattern = "        "` case
     if (strippedPattern.empty()) {
+        return getAllAssignmentStatementsThatMatchCanonical(assignee, "", isSubExpr);
+    }
+
+    // Preprocess pattern using the parser, to set precedence.
+    std::string searchPattern = Parser::parseExpr(pattern);
+    if (searchPattern.empty()) {
+        return {};
+    }
+    return getAllAssignmentStatementsThatMatchCanonical(assignee, searchPattern, isSubExpr);
+}
+
+STATEMENT_NUMBER_SET
+PKBImplementation::getAllAssignmentStatementsThatMatchCanonical(const std::string& assignee,
+                                                                const std::string& canonicalPattern,
+                                                                bool isSubExpr) const {
+    if (canonicalPattern.empty()) {
         if (!isSubExpr) {
             return {};
         }
@@ -532,42 +572,10 @@ PKBImplementation::getAllAssignmentStatementsThatMatch(const std::string& assign
             return allAssignmentStatements;
         }
         // Return all s such that Modifies(assignee, s);
-        if (variableToStatementsThatModifyIt.find(assignee) == variableToStatementsThatModifyIt.end()) {
-            return STATEMENT_NUMBER_SET();
-        }
-        STATEMENT_NUMBER_SET statementsThatModifyAssignee =
-        variableToStatementsThatModifyIt.find(assignee)->second;
-        return statementsThatModifyAssignee;
+        return getStatementsThatModify(assignee);
     }
 
-    // Preprocess pattern using the parser, to set precedence.
-    std::string searchPattern = Parser::parseExpr(pattern);
-    if (searchPattern.empty() || patternsMap.find(searchPattern) == patternsMap.end()) {
-        return {};
-    }
-    std::vector<std::tuple<std::string, STATEMENT_NUMBER, bool>> candidateResult = patternsMap.at(searchPattern);
-    if (assignee != "_") {
-        // remove results that have a different assignee
-        auto res = std::remove_if(candidateResult.begin(), candidateResult.end(),
-                                  [&](const std::tuple<std::string, STATEMENT_NUMBER, bool>& x) {
-                                      return std::get<0>(x) != assignee;
-                                  });
-        candidateResult.erase(res, candidateResult.end());
-    }
-    if (!isSubExpr) {
-        // Remove results that are sub expressions
-        auto res = std::remove_if(candidateResult.begin(), candidateResult.end(),
-                                  [&](const std::tuple<std::string, STATEMENT_NUMBER, bool>& x) {
-                                      return std::get<2>(x);
-                                  });
-        candidateResult.erase(res, candidateResult.end());
-    }
-
-    STATEMENT_NUMBER_SET result;
-    for (auto tup : candidateResult) {
-        result.insert(std::get<1>(tup));
-    }
-    return result;
+    return patternIndex.match(assignee, canonicalPattern, isSubExpr);
 }
 
 STATEMENT_NUMBER_SET PKBImplementation::getAllWhileStatementsThatMatch(const VARIABLE_NAME& variable,
@@ -613,51 +621,27 @@ STATEMENT_NUMBER_SET PKBImplementation::getAllIfElseStatementsThatMatch(const VA
 }
 
 bool PKBImplementation::isRead(STATEMENT_NUMBER s) const {
-    auto it = statementNumberToTNodeType.find(s);
-    if (it == statementNumberToTNodeType.end()) {
-        return false;
-    }
-    return it->second == Read;
+    return program.isStatement(s) && program.getStatement(s).type == Read;
 }
 
 bool PKBImplementation::isPrint(STATEMENT_NUMBER s) const {
-    auto it = statementNumberToTNodeType.find(s);
-    if (it == statementNumberToTNodeType.end()) {
-        return false;
-    }
-    return it->second == Print;
+    return program.isStatement(s) && program.getStatement(s).type == Print;
 }
 
 bool PKBImplementation::isCall(STATEMENT_NUMBER s) const {
-    auto it = statementNumberToTNodeType.find(s);
-    if (it == statementNumberToTNodeType.end()) {
-        return false;
-    }
-    return it->second == Call;
+    return program.isStatement(s) && program.getStatement(s).type == Call;
 }
 
 bool PKBImplementation::isWhile(STATEMENT_NUMBER s) const {
-    auto it = statementNumberToTNodeType.find(s);
-    if (it == statementNumberToTNodeType.end()) {
-        return false;
-    }
-    return it->second == While;
+    return program.isStatement(s) && program.getStatement(s).type == While;
 }
 
 bool PKBImplementation::isIfElse(STATEMENT_NUMBER s) const {
-    auto it = statementNumberToTNodeType.find(s);
-    if (it == statementNumberToTNodeType.end()) {
-        return false;
-    }
-    return it->second == IfElse;
+    return program.isStatement(s) && program.getStatement(s).type == IfElse;
 }
 
 bool PKBImplementation::isAssign(STATEMENT_NUMBER s) const {
-    auto it = statementNumberToTNodeType.find(s);
-    if (it == statementNumberToTNodeType.end()) {
-        return false;
-    }
-    return it->second == Assign;
+    return program.isStatement(s) && program.getStatement(s).type == Assign;
 }
 
 PROCEDURE_NAME_SET PKBImplementation::getProcedureThatCalls(const PROCEDURE_NAME& procedureName,
@@ -678,12 +662,57 @@ const PROCEDURE_NAME_SET& PKBImplementation::getAllCalledProcedures() const {
 
 STATEMENT_NUMBER_SET
 PKBImplementation::getNextStatementOf(STATEMENT_NUMBER statementNumber, bool isTransitive) const {
-    return foost::getVisitedInDFS(statementNumber, nextRelationship, isTransitive);
+    if (!isTransitive) {
+        return toSet(nextRelationship.get(statementNumber));
+    }
+    STATEMENT_NUMBER_SET result;
+    int block = controlFlowGraph.getBlock(statementNumber);
+    if (block == -1) {
+        return result;
+    }
+    // The rest of its own block, unless the block is on a loop, which adds the whole block.
+    if (!blockReachability.reaches(block, block)) {
+        CompressedRelation::Range statements = controlFlowGraph.getStatements(block);
+        result.insert(statements.begin() + controlFlowGraph.getOffset(statementNumber) + 1, statements.end());
+    }
+    for (int reachable : blockReachability.getReachable(block)) {
+        CompressedRelation::Range statements = controlFlowGraph.getStatements(reachable);
+        result.insert(statements.begin(), statements.end());
+    }
+    return result;
 }
 
 STATEMENT_NUMBER_SET PKBImplementation::getPreviousStatementOf(STATEMENT_NUMBER statementNumber,
                                                                bool isTransitive) const {
-    return foost::getVisitedInDFS(statementNumber, previousRelationship, isTransitive);
+    if (!isTransitive) {
+        return toSet(previousRelationship.get(statementNumber));
+    }
+    STATEMENT_NUMBER_SET result;
+    int block = controlFlowGraph.getBlock(statementNumber);
+    if (block == -1) {
+        return result;
+    }
+    if (!blockReachability.reaches(block, block)) {
+        CompressedRelation::Range statements = controlFlowGraph.getStatements(block);
+        result.insert(statements.begin(), statements.begin() + controlFlowGraph.getOffset(statementNumber));
+    }
+    for (int reaching : blockReachability.getReaching(block)) {
+        CompressedRelation::Range statements = controlFlowGraph.getStatements(reaching);
+        result.insert(statements.begin(), statements.end());
+    }
+    return result;
+}
+
+bool PKBImplementation::isNextTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const {
+    int blockA = controlFlowGraph.getBlock(a);
+    int blockB = controlFlowGraph.getBlock(b);
+    if (blockA == -1 || blockB == -1) {
+        return false;
+    }
+    if (blockA == blockB && controlFlowGraph.getOffset(a) < controlFlowGraph.getOffset(b)) {
+        return true;
+    }
+    return blockReachability.reaches(blockA, blockB);
 }
 
 const STATEMENT_NUMBER_SET& PKBImplementation::getAllStatementsWithNext() const {
@@ -840,62 +869,206 @@ STATEMENT_NUMBER_SET PKBImplementation::getAllStatementsWithPreviousBip() const
     return result;
 }
 
-PROGRAM_LINE_SET PKBImplementation::getStatementsAffectedBy(PROGRAM_LINE statementNumber, bool isTransitive) const {
-    // AVOIDING PRE-COMPUTATION
-    affectsMapping = extractor::getAffectsMapping(tNodeTypeToTNodesMap, tNodeToStatementNumber,
-                                                  statementNumberToTNode, nextRelationship,
-                                                  previousRelationship, usesMapping, modifiesMapping);
-    for (const auto& p : affectsMapping) {
-        statementsThatAffect.insert(p.first);
+const PKBImplementation::AffectsCache& PKBImplementation::getAffectsCache() const {
+    AffectsCache& cache = *affectsCache;
+    std::call_once(cache.computed, [this, &cache]() {
+        cache.affectsMapping =
+        extractor::getAffectsMapping(program, controlFlowGraph, extractor::ReachingDefinitionsEngine, nullptr, 0);
+        for (const auto& p : cache.affectsMapping) {
+            cache.statementsThatAffect.insert(p.first);
+        }
+        cache.affectedMapping = extractor::getAffectedMapping(cache.affectsMapping);
+        for (const auto& p : cache.affectedMapping) {
+            cache.statementsThatAreAffected.insert(p.first);
+        }
+        cache.affectsRelation = CompressedRelation::fromMap(cache.affectsMapping);
+        cache.affectsReachability = ReachabilityIndex(cache.affectsRelation, procedureRanges, 0);
+        cache.isComputed = true;
+    });
+    return cache;
+}
+
+bool PKBImplementation::isAffectsDemandDriven() const {
+    return !affectsCache->isComputed && affectsCache->demandDrivenQueries++ < DEMAND_DRIVEN_AFFECTS_QUERIES;
+}
+
+PROGRAM_LINE_SET PKBImplementation::getStatementsAffectedByOnDemand(PROGRAM_LINE statementNumber) const {
+    // Follow Next from the assignment until the variable that it modifies is modified again. The
+    // search steps a block at a time, and scans the statements of a block in order.
+    PROGRAM_LINE_SET affected;
+    if (!isAssign(statementNumber)) {
+        return affected;
+    }
+    VARIABLE_ID variable = program.getStatement(statementNumber).modifiedVariable;
+    // @return whether the statements of a block from `first` on leave the variable unmodified.
+    auto scan = [&](CompressedRelation::Range statements, const STATEMENT_NUMBER* first) {
+        for (; first != statements.end(); ++first) {
+            const StatementIR& statement = program.getStatement(*first);
+            if (statement.type == Assign && program.getUses().contains(*first, variable)) {
+                affected.insert(*first);
+            }
+            if ((statement.type == Assign || statement.type == Read || statement.type == Call) &&
+                program.getModifies().contains(*first, variable)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    int block = controlFlowGraph.getBlock(statementNumber);
+    CompressedRelation::Range statements = controlFlowGraph.getStatements(block);
+    if (!scan(statements, statements.begin() + controlFlowGraph.getOffset(statementNumber) + 1)) {
+        return affected;
+    }
+    std::vector<bool> visited(controlFlowGraph.getBlockCount(), false);
+    std::vector<int> toVisit(controlFlowGraph.getSuccessors().get(block).begin(),
+                             controlFlowGraph.getSuccessors().get(block).end());
+    while (!toVisit.empty()) {
+        block = toVisit.back();
+        toVisit.pop_back();
+        if (visited[block]) {
+            continue;
+        }
+        visited[block] = true;
+        statements = controlFlowGraph.getStatements(block);
+        if (scan(statements, statements.begin())) {
+            toVisit.insert(toVisit.end(), controlFlowGraph.getSuccessors().get(block).begin(),
+                           controlFlowGraph.getSuccessors().get(block).end());
+        }
     }
-    affectedMapping = extractor::getAffectedMapping(affectsMapping);
-    for (const auto& p : affectedMapping) {
-        statementsThatAreAffected.insert(p.first);
+    return affected;
+}
+
+PROGRAM_LINE_SET PKBImplementation::getStatementsThatAffectOnDemand(PROGRAM_LINE statementNumber) const {
+    // Follow Previous from the assignment, for each variable that it uses, back to the statements
+    // that last modify the variable, a block at a time.
+    PROGRAM_LINE_SET affecting;
+    if (!isAssign(statementNumber)) {
+        return affecting;
+    }
+    const int start = controlFlowGraph.getBlock(statementNumber);
+    std::vector<bool> visited;
+    std::vector<int> toVisit;
+    for (VARIABLE_ID variable : program.getUsedVariables(statementNumber)) {
+        // @return whether the statements of a block before `end` leave the variable unmodified.
+        auto scan = [&](CompressedRelation::Range statements, const STATEMENT_NUMBER* end) {
+            while (end != statements.begin()) {
+                --end;
+                const StatementIR& statement = program.getStatement(*end);
+                if ((statement.type == Assign || statement.type == Read || statement.type == Call) &&
+                    program.getModifies().contains(*end, variable)) {
+                    if (statement.type == Assign) {
+                        affecting.insert(*end);
+                    }
+                    return false;
+                }
+            }
+            return true;
+        };
+        CompressedRelation::Range statements = controlFlowGraph.getStatements(start);
+        if (!scan(statements, statements.begin() + controlFlowGraph.getOffset(statementNumber))) {
+            continue;
+        }
+        visited.assign(controlFlowGraph.getBlockCount(), false);
+        toVisit.assign(controlFlowGraph.getPredecessors().get(start).begin(),
+                       controlFlowGraph.getPredecessors().get(start).end());
+        while (!toVisit.empty()) {
+            int block = toVisit.back();
+            toVisit.pop_back();
+            if (visited[block]) {
+                continue;
+            }
+            visited[block] = true;
+            statements = controlFlowGraph.getStatements(block);
+            if (scan(statements, statements.end())) {
+                toVisit.insert(toVisit.end(), controlFlowGraph.getPredecessors().get(block).begin(),
+                               controlFlowGraph.getPredecessors().get(block).end());
+            }
+        }
     }
+    return affecting;
+}
 
-    return foost::getVisitedInDFS(statementNumber, affectsMapping, isTransitive);
+PROGRAM_LINE_SET PKBImplementation::getStatementsAffectedBy(PROGRAM_LINE statementNumber, bool isTransitive) const {
+    if (!isTransitive && isAffectsDemandDriven()) {
+        return getStatementsAffectedByOnDemand(statementNumber);
+    }
+    if (isTransitive) {
+        return toSet(getAffectsCache().affectsReachability.getReachable(statementNumber));
+    }
+    return foost::getVisitedInDFS(statementNumber, getAffectsCache().affectsMapping, false);
 }
 PROGRAM_LINE_SET PKBImplementation::getStatementsThatAffect(PROGRAM_LINE statementNumber, bool isTransitive) const {
-    // AVOIDING PRE-COMPUTATION
-    affectsMapping = extractor::getAffectsMapping(tNodeTypeToTNodesMap, tNodeToStatementNumber,
-                                                  statementNumberToTNode, nextRelationship,
-                                                  previousRelationship, usesMapping, modifiesMapping);
-    for (const auto& p : affectsMapping) {
-        statementsThatAffect.insert(p.first);
+    if (!isTransitive && isAffectsDemandDriven()) {
+        return getStatementsThatAffectOnDemand(statementNumber);
     }
-    affectedMapping = extractor::getAffectedMapping(affectsMapping);
-    for (const auto& p : affectedMapping) {
-        statementsThatAreAffected.insert(p.first);
+    if (isTransitive) {
+        return toSet(getAffectsCache().affectsReachability.getReaching(statementNumber));
     }
-    return foost::getVisitedInDFS(statementNumber, affectedMapping, isTransitive);
+    return foost::getVisitedInDFS(statementNumber, getAffectsCache().affectedMapping, false);
+}
+bool PKBImplementation::isAffectsTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const {
+    return getAffectsCache().affectsReachability.reaches(a, b);
 }
 const PROGRAM_LINE_SET& PKBImplementation::getAllStatementsThatAffect() const {
-    // AVOIDING PRE-COMPUTATION
-    affectsMapping = extractor::getAffectsMapping(tNodeTypeToTNodesMap, tNodeToStatementNumber,
-                                                  statementNumberToTNode, nextRelationship,
-                                                  previousRelationship, usesMapping, modifiesMapping);
-    for (const auto& p : affectsMapping) {
-        statementsThatAffect.insert(p.first);
+    return getAffectsCache().statementsThatAffect;
+}
+const PROGRAM_LINE_SET& PKBImplementation::getAllStatementsThatAreAffected() const {
+    return getAffectsCache().statementsThatAreAffected;
+}
+
+PROCEDURE_NAME PKBImplementation::getProcedureOfStatement(STATEMENT_NUMBER s) const {
+    if (!program.isStatement(s)) {
+        return "";
     }
-    affectedMapping = extractor::getAffectedMapping(affectsMapping);
-    for (const auto& p : affectedMapping) {
-        statementsThatAreAffected.insert(p.first);
+    return program.getProcedures()[program.getStatement(s).procedure].name;
+}
+
+std::pair<STATEMENT_NUMBER, STATEMENT_NUMBER> PKBImplementation::getStatementRange(const PROCEDURE_NAME& p) const {
+    auto id = procedureIds.find(p);
+    if (id == procedureIds.end()) {
+        return { 0, 0 };
     }
-    return statementsThatAffect;
+    const ProcedureIR& procedure = program.getProcedures()[id->second];
+    return { procedure.firstStatement, procedure.lastStatement };
 }
-const PROGRAM_LINE_SET& PKBImplementation::getAllStatementsThatAreAffected() const {
-    // AVOIDING PRE-COMPUTATION
-    affectsMapping = extractor::getAffectsMapping(tNodeTypeToTNodesMap, tNodeToStatementNumber,
-                                                  statementNumberToTNode, nextRelationship,
-                                                  previousRelationship, usesMapping, modifiesMapping);
-    for (const auto& p : affectsMapping) {
-        statementsThatAffect.insert(p.first);
-    }
-    affectedMapping = extractor::getAffectedMapping(affectsMapping);
-    for (const auto& p : affectedMapping) {
-        statementsThatAreAffected.insert(p.first);
-    }
-    return statementsThatAreAffected;
+
+bool PKBImplementation::isInSameProcedure(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const {
+    return program.isStatement(a) && program.isStatement(b) &&
+           program.getStatement(a).procedure == program.getStatement(b).procedure;
+}
+
+STATEMENT_NUMBER_PAIR_LIST PKBImplementation::getTransitivePairs(TransitiveStatementRelation relation,
+                                                             const std::vector<STATEMENT_NUMBER>& sources,
+                                                             const std::vector<STATEMENT_NUMBER>& targets) const {
+    switch (relation) {
+    case NextTransitive:
+        return nextRelationship.getReachablePairs(sources, targets);
+    case AffectsTransitive:
+        return getAffectsCache().affectsRelation.getReachablePairs(sources, targets);
+    case ParentTransitive:
+        return parentChildrenRelation.getReachablePairs(sources, targets);
+    }
+    return {};
+}
+
+PROCEDURE_NAME_PAIR_LIST PKBImplementation::getTransitiveCallPairs(const PROCEDURE_NAME_LIST& callers,
+                                                                   const PROCEDURE_NAME_LIST& callees) const {
+    auto toIds = [this](const PROCEDURE_NAME_LIST& procedures) {
+        std::vector<int> ids;
+        for (const PROCEDURE_NAME& procedure : procedures) {
+            auto id = procedureIds.find(procedure);
+            if (id != procedureIds.end()) {
+                ids.push_back(id->second);
+            }
+        }
+        return ids;
+    };
+    PROCEDURE_NAME_PAIR_LIST pairs;
+    const std::vector<ProcedureIR>& procedures = program.getProcedures();
+    for (const std::pair<int, int>& idPair : callsRelation.getReachablePairs(toIds(callers), toIds(callees))) {
+        pairs.emplace_back(procedures[idPair.first].name, procedures[idPair.second].name);
+    }
+    return pairs;
 }
 
 ScopedStatements affectsBipStarHelper(const ScopedStatement& start,
@@ -1,9 +1,17 @@
 #pragma once
 
+#include "CompressedRelation.h"
+#include "ControlFlowGraph.h"
 #include "DesignExtractor.h"
 #include "PKB.h"
+#include "PatternIndex.h"
+#include "ProgramIR.h"
+#include "ReachabilityIndex.h"
 #include "TNode.h"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <unordered_map>
 
@@ -37,6 +45,11 @@ class PKBImplementation : virtual public backend::PKB {
     STATEMENT_NUMBER_SET getAllStatementsThatFollows() const override;
     STATEMENT_NUMBER_SET getStatementsThatFollows(STATEMENT_NUMBER s) const override;
     STATEMENT_NUMBER_SET getAllStatementsThatAreFollowed() const override;
+    // The statements after, or before, s in its statement list are a slice of the list.
+    STATEMENT_NUMBER_LIST getStatementsThatFollowAsList(STATEMENT_NUMBER s) const override;
+    STATEMENT_NUMBER_LIST getStatementsFollowedByAsList(STATEMENT_NUMBER s) const override;
+    // Compares the positions of a and b in their statement list, in constant time.
+    bool isFollowsTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const override;
 
     STATEMENT_NUMBER_SET getParent(STATEMENT_NUMBER statementNumber) const override;
     STATEMENT_NUMBER_SET getChildren(STATEMENT_NUMBER statementNumber) const override;
@@ -44,6 +57,10 @@ class PKBImplementation : virtual public backend::PKB {
     STATEMENT_NUMBER_SET getStatementsThatHaveAncestors() const override;
     STATEMENT_NUMBER_SET getDescendants(STATEMENT_NUMBER statementNumber) const override;
     STATEMENT_NUMBER_SET getStatementsThatHaveDescendants() const override;
+    // The descendants of s are the range of statements up to lastDescendant[s].
+    STATEMENT_NUMBER_LIST getDescendantsAsList(STATEMENT_NUMBER statementNumber) const override;
+    // Checks that b is in the range of descendants of a, in constant time.
+    bool isParentTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const override;
 
     STATEMENT_NUMBER_SET getStatementsThatUse(VARIABLE_NAME v) const override;
     STATEMENT_NUMBER_SET getStatementsThatUseSomeVariable() const override;
@@ -70,6 +87,8 @@ class PKBImplementation : virtual public backend::PKB {
 
     STATEMENT_NUMBER_SET getNextStatementOf(STATEMENT_NUMBER statementNumber, bool isTransitive) const override;
     STATEMENT_NUMBER_SET getPreviousStatementOf(STATEMENT_NUMBER statementNumber, bool isTransitive) const override;
+    // Next*(a, b), in constant time.
+    bool isNextTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const override;
     const STATEMENT_NUMBER_SET& getAllStatementsWithNext() const override;
     const STATEMENT_NUMBER_SET& getAllStatementsWithPrev() const override;
 
@@ -80,6 +99,8 @@ class PKBImplementation : virtual public backend::PKB {
 
     PROGRAM_LINE_SET getStatementsAffectedBy(PROGRAM_LINE statementNumber, bool isTransitive) const override;
     PROGRAM_LINE_SET getStatementsThatAffect(PROGRAM_LINE statementNumber, bool isTransitive) const override;
+    // Affects*(a, b), in constant time once Affects is computed.
+    bool isAffectsTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const override;
     const PROGRAM_LINE_SET& getAllStatementsThatAffect() const override;
     const PROGRAM_LINE_SET& getAllStatementsThatAreAffected() const override;
 
@@ -88,9 +109,42 @@ class PKBImplementation : virtual public backend::PKB {
     const PROGRAM_LINE_SET& getAllStatementsThatAffectBip() const override;
     const PROGRAM_LINE_SET& getAllStatementsThatAreAffectedBip() const override;
 
+    PROCEDURE_NAME getProcedureOfStatement(STATEMENT_NUMBER s) const override;
+    std::pair<STATEMENT_NUMBER, STATEMENT_NUMBER> getStatementRange(const PROCEDURE_NAME& p) const override;
+    bool isInSameProcedure(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const override;
+
+    STATEMENT_NUMBER_PAIR_LIST getTransitivePairs(TransitiveStatementRelation relation,
+                                                  const std::vector<STATEMENT_NUMBER>& sources,
+                                                  const std::vector<STATEMENT_NUMBER>& targets) const override;
+    PROCEDURE_NAME_PAIR_LIST getTransitiveCallPairs(const PROCEDURE_NAME_LIST& callers,
+                                                    const PROCEDURE_NAME_LIST& callees) const override;
+
+    // The statement-level relations, with the sorted targets of each statement, for callers that
+    // can read ranges instead of sets.
+    const CompressedRelation& getNextRelation() const {
+        return nextRelationship;
+    }
+    const CompressedRelation& getPreviousRelation() const {
+        return previousRelationship;
+    }
+    const CompressedRelation& getFollowsRelation() const {
+        return followedFollowRelation;
+    }
+    const CompressedRelation& getParentRelation() const {
+        return parentChildrenRelation;
+    }
+    // The basic blocks of every procedure, linked by Next.
+    const ControlFlowGraph& getControlFlowGraph() const {
+        return controlFlowGraph;
+    }
+
+
     // Pattern
     STATEMENT_NUMBER_SET
     getAllAssignmentStatementsThatMatch(const std::string& assignee, const std::string& pattern, bool isSubExpr) const override;
+    STATEMENT_NUMBER_SET getAllAssignmentStatementsThatMatchCanonical(const std::string& assignee,
+                                                                      const std::string& canonicalPattern,
+                                                                      bool isSubExpr) const override;
     STATEMENT_NUMBER_SET getAllWhileStatementsThatMatch(const VARIABLE_NAME& variable,
                                                         const std::string& pattern,
                                                         bool isSubExpr) const override;
@@ -101,55 +155,61 @@ class PKBImplementation : virtual public backend::PKB {
                                                          bool elsePatternIsSubExpr) const override;
 
   private:
-    std::unordered_map<const TNode*, int> tNodeToStatementNumber;
+    // The statements of the program. Relations that are computed lazily are computed from it.
+    ProgramIR program;
+
+    // The statement-level relations are indexed by statement number (or variable id), and hold
+    // sorted targets.
 
     // Follows helper:
-    // for k, v in map, follow(v, k).
-    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER> followedFollowRelation;
-    // for k, v in map, follow(k, v).
-    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER> followFollowedRelation;
+    // for k, v in relation, follow(k, v).
+    CompressedRelation followedFollowRelation;
+    // for k, v in relation, follow(v, k).
+    CompressedRelation followFollowedRelation;
     // Stmt list is private to prevent modification.
     STATEMENT_NUMBER_SET allStatementsThatFollows;
     STATEMENT_NUMBER_SET allStatementsThatAreFollowed;
-    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> transitiveFollows;
-    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> transitiveFollowed;
+    // The statements of each statement list, in order, so the statements at program positions
+    // 0, 1, ... of a list. Follows*(a, b) iff a and b are in the same list and a is before b.
+    CompressedRelation statementListToStatements;
 
     // Parent helper:
-    // for k, v in map, parent(k, j) for j in v
-    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> parentChildrenRelation;
-    // for k, v in map, parent(v, k).
-    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER> childrenParentRelation;
+    // for k, v in relation, parent(k, v).
+    CompressedRelation parentChildrenRelation;
+    // for k, v in relation, parent(v, k).
+    CompressedRelation childrenParentRelation;
     // Stmt list is private to prevent modification.
     STATEMENT_NUMBER_SET allStatementsThatHaveAncestors;
     STATEMENT_NUMBER_SET allStatementsThatHaveDescendants;
+    // Statements are numbered in preorder, so the descendants of s are the statements numbered
+    // s + 1 to lastDescendant[s]. Indexed by statement number.
+    std::vector<STATEMENT_NUMBER> lastDescendant;
 
 
-    // Uses helper:
-    std::unordered_map<const TNode*, std::unordered_set<std::string>> usesMapping;
-    std::unordered_map<VARIABLE_NAME, STATEMENT_NUMBER_SET> variableToStatementsThatUseIt;
+    // Uses helper. Statements to variables are in program.getUses().
+    // For each variable id, the statements that use it.
+    CompressedRelation variableToStatementsThatUseIt;
     STATEMENT_NUMBER_SET allStatementsThatUseSomeVariable;
     std::unordered_map<VARIABLE_NAME, PROCEDURE_NAME_SET> variableToProceduresThatUseIt;
     PROCEDURE_NAME_SET allProceduresThatThatUseSomeVariable;
     std::unordered_map<PROCEDURE_NAME, VARIABLE_NAME_SET> procedureToUsedVariables;
     VARIABLE_NAME_SET allVariablesUsedBySomeProcedure;
-    std::unordered_map<STATEMENT_NUMBER, VARIABLE_NAME_SET> statementToUsedVariables;
     VARIABLE_NAME_SET allVariablesUsedBySomeStatement;
 
-    // Modifies helper:
-    std::unordered_map<const TNode*, std::unordered_set<std::string>> modifiesMapping;
-    std::unordered_map<VARIABLE_NAME, STATEMENT_NUMBER_SET> variableToStatementsThatModifyIt;
+    // Modifies helper. Statements to variables are in program.getModifies().
+    // For each variable id, the statements that modify it.
+    CompressedRelation variableToStatementsThatModifyIt;
     STATEMENT_NUMBER_SET allStatementsThatModifySomeVariable;
     std::unordered_map<VARIABLE_NAME, PROCEDURE_NAME_SET> variableToProceduresThatModifyIt;
     PROCEDURE_NAME_SET allProceduresThatThatModifySomeVariable;
     std::unordered_map<PROCEDURE_NAME, VARIABLE_NAME_SET> procedureToModifiedVariables;
     VARIABLE_NAME_SET allVariablesModifiedBySomeProcedure;
-    std::unordered_map<STATEMENT_NUMBER, VARIABLE_NAME_SET> statementToModifiedVariables;
     VARIABLE_NAME_SET allVariablesModifiedBySomeStatement;
 
     // Pattern helper:
     std::unordered_set<int> allWhileCondWithVariables;
     std::unordered_set<int> allIfElseCondWithVariables;
-    std::unordered_map<std::string, std::vector<std::tuple<std::string, STATEMENT_NUMBER, bool>>> patternsMap;
+    PatternIndex patternIndex;
     std::unordered_map<VARIABLE_NAME, STATEMENT_NUMBER_SET> conditionVariablesToStatementNumbers;
 
     // Call helper:
@@ -159,23 +219,53 @@ class PKBImplementation : virtual public backend::PKB {
     std::unordered_map<std::string, std::unordered_set<std::string>> procedureToCallers;
     PROCEDURE_NAME_SET allProceduresThatCall;
     PROCEDURE_NAME_SET allCalledProcedures;
+    // Calls between procedure ids, for the batched Calls* search.
+    CompressedRelation callsRelation;
 
     // Next helper:
-    std::unordered_map<STATEMENT_NUMBER, std::unordered_set<STATEMENT_NUMBER>> nextRelationship;
-    std::unordered_map<STATEMENT_NUMBER, std::unordered_set<STATEMENT_NUMBER>> previousRelationship;
+    CompressedRelation nextRelationship;
+    CompressedRelation previousRelationship;
+    // The first and last statement of each procedure that has statements. Next and Affects never
+    // leave a procedure.
+    std::vector<std::pair<int, int>> procedureRanges;
+    std::unordered_map<PROCEDURE_NAME, PROCEDURE_ID> procedureIds;
+    ControlFlowGraph controlFlowGraph;
+    // Next* between the blocks of each procedure, with the procedures indexed in parallel. Next*
+    // between two statements of a block is read off their offsets.
+    ReachabilityIndex blockReachability;
     STATEMENT_NUMBER_SET statementsWithNext;
     STATEMENT_NUMBER_SET statementsWithPrev;
 
     // NextBip helper:
     std::unordered_map<PROGRAM_LINE, std::unordered_set<extractor::NextBipEdge>> nextBipRelationship;
     std::unordered_map<PROGRAM_LINE, std::unordered_set<extractor::NextBipEdge>> previousBipRelationship;
-    std::unordered_map<STATEMENT_NUMBER, std::unique_ptr<const TNode>> procedureEndNodes;
 
     // Affects helper:
-    mutable std::unordered_map<PROGRAM_LINE, PROGRAM_LINE_SET> affectsMapping;
-    mutable std::unordered_map<PROGRAM_LINE, PROGRAM_LINE_SET> affectedMapping;
-    mutable STATEMENT_NUMBER_SET statementsThatAffect;
-    mutable STATEMENT_NUMBER_SET statementsThatAreAffected;
+    // Affects is computed from `program` the first time it is asked for, and only once, even if
+    // several threads ask for it at the same time. The procedures are analysed in parallel.
+    // Until then, Affects from or to a single statement is found by a search of the statements
+    // around it, for the first DEMAND_DRIVEN_AFFECTS_QUERIES such queries. After that, the whole
+    // relation is expected to be needed, and is computed.
+    static const int DEMAND_DRIVEN_AFFECTS_QUERIES = 16;
+    struct AffectsCache {
+        std::once_flag computed;
+        std::atomic<bool> isComputed{ false };
+        std::atomic<int> demandDrivenQueries{ 0 };
+        std::unordered_map<PROGRAM_LINE, PROGRAM_LINE_SET> affectsMapping;
+        std::unordered_map<PROGRAM_LINE, PROGRAM_LINE_SET> affectedMapping;
+        STATEMENT_NUMBER_SET statementsThatAffect;
+        STATEMENT_NUMBER_SET statementsThatAreAffected;
+        CompressedRelation affectsRelation;
+        // Affects* within each procedure, with the procedures indexed in parallel.
+        ReachabilityIndex affectsReachability;
+    };
+    // Held by pointer because a once_flag cannot be moved.
+    std::shared_ptr<AffectsCache> affectsCache = std::make_shared<AffectsCache>();
+    const AffectsCache& getAffectsCache() const;
+    // @return whether the next single-statement Affects query should be answered by a search.
+    bool isAffectsDemandDriven() const;
+    PROGRAM_LINE_SET getStatementsAffectedByOnDemand(PROGRAM_LINE statementNumber) const;
+    PROGRAM_LINE_SET getStatementsThatAffectOnDemand(PROGRAM_LINE statementNumber) const;
 
     // AffectsBip helper:
     std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> affectsBipMapping;
@@ -187,10 +277,6 @@ class PKBImplementation : virtual public backend::PKB {
     STATEMENT_NUMBER_SET statementsThatAffectBip;
     STATEMENT_NUMBER_SET statementsThatAreAffectedBip;
 
-    // Performance booster fields:
-    std::unordered_map<TNodeType, std::vector<const TNode*>, EnumClassHash> tNodeTypeToTNodesMap;
-    std::unordered_map<int, TNodeType> statementNumberToTNodeType;
-
     /// Entities retrieval helper
     VARIABLE_NAME_LIST allVariablesName;
     CONSTANT_NAME_SET allConstantsName;
@@ -199,7 +285,6 @@ class PKBImplementation : virtual public backend::PKB {
     STATEMENT_NUMBER_SET allAssignmentStatements;
     STATEMENT_NUMBER_SET allWhileStatements;
     STATEMENT_NUMBER_SET allIfElseStatements;
-    std::unordered_map<STATEMENT_NUMBER, const TNode*> statementNumberToTNode;
 
     std::unordered_map<PROCEDURE_NAME, STATEMENT_NUMBER_SET> procedureNameToCallStatements;
     std::unordered_map<VARIABLE_NAME, STATEMENT_NUMBER_SET> variableNameToReadStatements;
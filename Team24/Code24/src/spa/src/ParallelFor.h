@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace backend {
+/**
+ * Runs `work(i)` for every i in [0, count) on up to threadCount threads, or one per hardware thread
+ * if threadCount is 0. Each thread takes the next i when it finishes one, so that items of uneven
+ * size balance out. With a single thread, or a single item, the work runs on the calling thread.
+ * The exception of the lowest failing i is rethrown once every thread has finished.
+ */
+template <typename Work> void parallelFor(size_t count, unsigned int threadCount, Work work) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t workerCount = std::min<size_t>(threadCount, count);
+    if (workerCount <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            work(i);
+        }
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(count);
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+    for (size_t worker = 0; worker < workerCount; worker++) {
+        workers.emplace_back([&]() {
+            for (size_t i = next++; i < count; i = next++) {
+                try {
+                    work(i);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+} // namespace backend
@@ -2,45 +2,53 @@
 
 #include "Logger.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 namespace backend {
-Parser::Parser(std::vector<lexer::Token> tokens) : tokens(std::move(tokens)) {
+Parser::Parser(const std::vector<lexer::Token>& tokens)
+: tokens(lexer::TokenizedSource::fromTokens(tokens)) {
 }
-State::State(int tokenPos, TNode tNode) : tNode(std::move(tNode)), tokenPos(tokenPos){};
+Parser::Parser(lexer::TokenizedSource source) : tokens(std::move(source)) {
+}
+Parser::Parser(std::shared_ptr<const lexer::SourceBuffer> buffer) : tokens(std::move(buffer)) {
+}
+State::State(int tokenPos, NodeId node) : node(node), tokenPos(tokenPos){};
 
-bool Parser::haveTokensLeft(int tokenPos) const {
-    return tokenPos < tokens.size();
+bool Parser::haveTokensLeft(int tokenPos) {
+    return tokens.peek(tokenPos) != nullptr;
 }
 
-lexer::Token Parser::peekToken(int tokenPos) {
+const lexer::SourceToken& Parser::peekToken(int tokenPos) {
     if (!haveTokensLeft(tokenPos))
         throw std::runtime_error("no more tokens left when trying to peekToken");
-    return tokens[tokenPos];
+    return *tokens.peek(tokenPos);
 }
 
-lexer::Token Parser::assertNameTokenAndPop(int& tokenPos, const std::string& name) {
-    const lexer::Token& tok = assertTokenAndPop(tokenPos, lexer::TokenType::NAME);
-    if (tok.nameValue != name) {
+const lexer::SourceToken& Parser::assertNameTokenAndPop(int& tokenPos, const std::string& name) {
+    const lexer::SourceToken& tok = assertTokenAndPop(tokenPos, lexer::TokenType::NAME);
+    if (!tokens.textEquals(tok, name)) {
         throw std::runtime_error("expect " + lexer::prettyPrintType(lexer::TokenType::NAME) + " with value \"" +
                                  name + "\", got " + lexer::prettyPrintType(lexer::TokenType::NAME) +
-                                 " with value\"" + tok.nameValue + "\" instead");
+                                 " with value\"" + tokens.text(tok) + "\" instead");
     }
     return tok;
 }
 
-lexer::Token Parser::assertTokenAndPop(int& tokenPos, lexer::TokenType type) {
+const lexer::SourceToken& Parser::assertTokenAndPop(int& tokenPos, lexer::TokenType type) {
     assertTokenIsOfType(tokenPos, type);
-    const lexer::Token& tok = peekToken(tokenPos);
+    const lexer::SourceToken& tok = peekToken(tokenPos);
     tokenPos++;
     return tok;
 }
 
 void Parser::assertTokenIsOfType(int tokenPos, lexer::TokenType type) {
-    const lexer::Token& tok = peekToken(tokenPos);
+    const lexer::SourceToken& tok = peekToken(tokenPos);
     if (tok.type != type) {
         throw std::runtime_error("expect " + lexer::prettyPrintType(type) + ", got " +
                                  lexer::prettyPrintType(tok.type));
@@ -50,61 +58,148 @@ void Parser::assertTokenIsOfType(int tokenPos, lexer::TokenType type) {
 bool Parser::tokenTypeIs(int tokenPos, lexer::TokenType type) {
     if (!haveTokensLeft(tokenPos))
         throw std::runtime_error("no more tokens left when trying to tokenTypeIs");
-    return tokens[tokenPos].type == type;
+    return tokens.peek(tokenPos)->type == type;
+}
+
+NameId Parser::internName(const lexer::SourceToken& token) {
+    return ast.internName(tokens.text(token));
 }
 
 bool Parser::tokenHasName(int tokenPos, const std::string& name) {
     if (!haveTokensLeft(tokenPos))
         throw std::runtime_error("no more tokens left when trying to tokenHasName");
-    const lexer::Token& token = peekToken(tokenPos);
-    return token.type == lexer::TokenType::NAME && token.nameValue == name;
+    const lexer::SourceToken& token = peekToken(tokenPos);
+    return token.type == lexer::TokenType::NAME && tokens.textEquals(token, name);
 }
 
 TNode Parser::parse() {
     logLine("Parser: Parsing program");
-    TNode result = parseProgram(0).tNode;
+    NodeId program = parseProgram(0).node;
     logLine("Parser: Parsed program completed.");
-    return result;
+    return ast.toTNode(program);
+}
+
+TNode Parser::parseInParallel(unsigned int threadCount) {
+    logLine("Parser: Parsing program in parallel");
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // Procedures can only be found up front if the tokens are not lexed on demand.
+    const lexer::TokenizedSource* source = tokens.tokenizedSource();
+    if (source == nullptr) {
+        return parse();
+    }
+    std::vector<std::pair<int, int>> procedureBounds = findProcedureBounds();
+    size_t workerCount = std::min<size_t>(threadCount, procedureBounds.size());
+    if (workerCount <= 1) {
+        return parse();
+    }
+
+    // Workers take the next unparsed procedure, so large and small procedures balance out.
+    std::vector<TNode> procedures(procedureBounds.size());
+    std::atomic<size_t> nextProcedure(0);
+    std::atomic<bool> hasFailed(false);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([&]() {
+            for (size_t index = nextProcedure++; index < procedureBounds.size() && !hasFailed;
+                 index = nextProcedure++) {
+                try {
+                    Parser procedureParser(
+                    source->slice(procedureBounds[index].first, procedureBounds[index].second + 1));
+                    State procedureState = procedureParser.parseProcedure(0);
+                    if (procedureParser.haveTokensLeft(procedureState.tokenPos)) {
+                        throw std::runtime_error("procedure ended before its closing brace");
+                    }
+                    procedures[index] = procedureParser.ast.toTNode(procedureState.node);
+                } catch (const std::exception&) {
+                    hasFailed = true;
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (hasFailed) {
+        return parse();
+    }
+
+    TNode programNode(TNodeType::Program);
+    programNode.children.reserve(procedures.size());
+    for (TNode& procedure : procedures) {
+        programNode.addChild(std::move(procedure));
+    }
+    logLine("Parser: Parsed program completed.");
+    return programNode;
+}
+
+std::vector<std::pair<int, int>> Parser::findProcedureBounds() {
+    std::vector<std::pair<int, int>> bounds;
+    int tokenPos = 0;
+    while (haveTokensLeft(tokenPos)) {
+        // procedure: ‘procedure’ proc_name ‘{’ stmtLst ‘}’
+        if (!tokenHasName(tokenPos, constants::PROCEDURE) || !haveTokensLeft(tokenPos + 2) ||
+            !tokenTypeIs(tokenPos + 2, lexer::TokenType::LBRACE)) {
+            return {};
+        }
+        int end = tokenPos + 2;
+        int depth = 0;
+        for (; haveTokensLeft(end); end++) {
+            if (tokenTypeIs(end, lexer::TokenType::LBRACE)) {
+                depth++;
+            } else if (tokenTypeIs(end, lexer::TokenType::RBRACE) && --depth == 0) {
+                break;
+            }
+        }
+        if (!haveTokensLeft(end)) {
+            return {};
+        }
+        bounds.emplace_back(tokenPos, end);
+        tokenPos = end + 1;
+    }
+    return bounds;
 }
 
 State Parser::parseProgram(int tokenPos) {
     logLine("start parseProgram");
-    TNode programNode(TNodeType::Program);
+    std::vector<NodeId> procedures;
     do {
         State procState = parseProcedure(tokenPos);
-        programNode.addChild(procState.tNode);
+        procedures.push_back(procState.node);
         tokenPos = procState.tokenPos;
     } while (haveTokensLeft(tokenPos));
     logLine("success parseProgram");
-    return State(tokenPos, programNode);
+    return State(tokenPos, ast.addNode(TNodeType::Program, 0, procedures));
 }
 
 State Parser::parseProcedure(int tokenPos) {
     logLine("start parseProcedure");
-    TNode procedureNode(TNodeType::Procedure,
-                        /* line no */ assertNameTokenAndPop(tokenPos, constants::PROCEDURE).line);
-    procedureNode.name = assertTokenAndPop(tokenPos, lexer::TokenType::NAME).nameValue;
+    int line = assertNameTokenAndPop(tokenPos, constants::PROCEDURE).line;
+    NameId name = internName(assertTokenAndPop(tokenPos, lexer::TokenType::NAME));
 
     State stmtListResult = parseStatementList(tokenPos);
-    procedureNode.children.push_back(stmtListResult.tNode);
     logLine("success parseProcedure");
-    return State(stmtListResult.tokenPos, procedureNode);
+    return State(stmtListResult.tokenPos,
+                 ast.addNode(TNodeType::Procedure, line, { stmtListResult.node }, name));
 }
 
 State Parser::parseStatementList(int tokenPos) {
     logLine("start parseStatementList");
-    TNode statementList(TNodeType::StatementList,
-                        assertTokenAndPop(tokenPos, lexer::TokenType::LBRACE).line);
+    int line = assertTokenAndPop(tokenPos, lexer::TokenType::LBRACE).line;
 
+    std::vector<NodeId> statements;
     do {
         State statementResult = parseStatement(tokenPos);
-        statementList.addChild(statementResult.tNode);
+        statements.push_back(statementResult.node);
         tokenPos = statementResult.tokenPos;
+        // Statements are never parsed again, so the tokens before the next one can be dropped.
+        releaseTokensBefore(tokenPos);
     } while (haveTokensLeft(tokenPos) && !tokenTypeIs(tokenPos, lexer::TokenType::RBRACE));
 
     assertTokenAndPop(tokenPos, lexer::TokenType::RBRACE);
     logLine("success parseStatementList");
-    return State(tokenPos, statementList);
+    return State(tokenPos, ast.addNode(TNodeType::StatementList, line, statements));
 }
 
 // stmt: read | print | call | while | if | assign
@@ -136,51 +231,48 @@ State Parser::parseStatement(int tokenPos) {
         return parseIf(tokenPos);
     } else {
         throw std::runtime_error("Failed to parse statement, with first token that has name " +
-                                 peekToken(tokenPos).nameValue);
+                                 tokens.text(peekToken(tokenPos)));
     }
 }
 
 State Parser::parseIf(int tokenPos) {
     logLine("start parseIf");
-    TNode ifElseNode(TNodeType::IfElse, assertNameTokenAndPop(tokenPos, constants::IF).line);
+    int line = assertNameTokenAndPop(tokenPos, constants::IF).line;
 
     assertTokenAndPop(tokenPos, lexer::TokenType::LPAREN);
     const State& conditionalExpressionResult = parseCondition(tokenPos);
     tokenPos = conditionalExpressionResult.tokenPos;
     assertTokenAndPop(tokenPos, lexer::TokenType::RPAREN);
-    ifElseNode.addChild(conditionalExpressionResult.tNode);
 
     assertNameTokenAndPop(tokenPos, constants::THEN);
 
     const State& thenStatementListResult = parseStatementList(tokenPos);
     tokenPos = thenStatementListResult.tokenPos;
-    ifElseNode.addChild(thenStatementListResult.tNode);
 
     assertNameTokenAndPop(tokenPos, constants::ELSE);
 
     const State& elseStatementListResult = parseStatementList(tokenPos);
     tokenPos = elseStatementListResult.tokenPos;
-    ifElseNode.addChild(elseStatementListResult.tNode);
     logLine("success parseIf");
-    return State(tokenPos, ifElseNode);
+    return State(tokenPos, ast.addNode(TNodeType::IfElse, line,
+                                       { conditionalExpressionResult.node, thenStatementListResult.node,
+                                         elseStatementListResult.node }));
 }
 
 State Parser::parseWhile(int tokenPos) {
     logLine("start parseWhile");
-    TNode whileNode(TNodeType::While, assertNameTokenAndPop(tokenPos, constants::WHILE).line);
+    int line = assertNameTokenAndPop(tokenPos, constants::WHILE).line;
 
     assertTokenAndPop(tokenPos, lexer::TokenType::LPAREN);
     const State& condResult = parseCondition(tokenPos);
     tokenPos = condResult.tokenPos;
     assertTokenAndPop(tokenPos, lexer::TokenType::RPAREN);
-    whileNode.addChild(condResult.tNode);
 
     const State& stmtListResult = parseStatementList(tokenPos);
     tokenPos = stmtListResult.tokenPos;
-    whileNode.addChild(stmtListResult.tNode);
 
     logLine("success parseWhile");
-    return State(tokenPos, whileNode);
+    return State(tokenPos, ast.addNode(TNodeType::While, line, { condResult.node, stmtListResult.node }));
 }
 
 // cond_expr: rel_expr
@@ -195,36 +287,41 @@ State Parser::parseCondition(int tokenPos) {
         throw std::runtime_error("expect condition, none defined");
     }
 
-    // We try to get parseRel. If we cant, then we try the others.
-    // Consider ((x + y) < 1) and ((x < 1) && (y < 1))
-    // We need to check if it's the first case, before we check if its the second case.
-    try {
+    // The production is decided by lookahead, so every token is parsed once.
+    // Consider ((x + y) < 1) and ((x < 1) && (y < 1)): both start with '(', but only the second
+    // has a boolean operator right after the matching ')'. A rel_expr never starts with '!'.
+    bool isRelExpr;
+    if (tokenTypeIs(tokenPos, lexer::TokenType::LPAREN)) {
+        int closingParen = findClosingParen(tokenPos);
+        isRelExpr = closingParen == -1 || !haveTokensLeft(closingParen + 1) ||
+                    (!tokenTypeIs(closingParen + 1, lexer::TokenType::ANDAND) &&
+                     !tokenTypeIs(closingParen + 1, lexer::TokenType::OROR));
+    } else {
+        isRelExpr = tokenTypeIs(tokenPos, lexer::TokenType::NAME) ||
+                    tokenTypeIs(tokenPos, lexer::TokenType::INTEGER);
+    }
+    if (isRelExpr) {
         State result = parseRelExpr(tokenPos);
-        tokenPos = result.tokenPos;
         logLine("success parseCondition");
-        return State(tokenPos, result.tNode);
-    } catch (const std::exception&) {
-        logLine("failed parseRelExpr");
+        return result;
     }
 
     if (tokenTypeIs(tokenPos, lexer::TokenType::NOT)) {
         // | ‘!’ ‘(’ cond_expr ‘)’
         int line = assertTokenAndPop(tokenPos, lexer::TokenType::NOT).line;
-        TNode notNode(TNodeType::Not, line);
 
         assertTokenAndPop(tokenPos, lexer::TokenType::LPAREN);
         State cond = parseCondition(tokenPos);
         tokenPos = cond.tokenPos;
         assertTokenAndPop(tokenPos, lexer::TokenType::RPAREN);
 
-        notNode.addChild(cond.tNode);
         logLine("success parseCondition");
-        return State(tokenPos, notNode);
+        return State(tokenPos, ast.addNode(TNodeType::Not, line, { cond.node }));
     } else if (tokenTypeIs(tokenPos, lexer::TokenType::LPAREN)) {
         // | ‘(’ cond_expr ‘)’ ‘&&’ ‘(’ cond_expr ‘)’
         // | ‘(’ cond_expr ‘)’ ‘||’ ‘(’ cond_expr ‘)’
         assertTokenAndPop(tokenPos, lexer::TokenType::LPAREN);
-        const State& inner_left_cond = parseCondition(tokenPos);
+        State inner_left_cond = parseCondition(tokenPos);
         tokenPos = inner_left_cond.tokenPos;
         assertTokenAndPop(tokenPos, lexer::TokenType::RPAREN);
 
@@ -241,19 +338,43 @@ State Parser::parseCondition(int tokenPos) {
                                      prettyPrintType(peekToken(tokenPos).type));
         }
         assertTokenAndPop(tokenPos, lexer::TokenType::LPAREN);
-        const State& inner_right_cond = parseCondition(tokenPos);
+        State inner_right_cond = parseCondition(tokenPos);
         tokenPos = inner_right_cond.tokenPos;
         assertTokenAndPop(tokenPos, lexer::TokenType::RPAREN);
 
-        TNode condNode(type, line);
-        condNode.addChild(inner_left_cond.tNode);
-        condNode.addChild(inner_right_cond.tNode);
         logLine("success parseCondition");
-        return State(tokenPos, condNode);
+        return State(tokenPos, ast.addNode(type, line, { inner_left_cond.node, inner_right_cond.node }));
     }
     throw std::runtime_error("Failed to parse conditions");
 }
 
+int Parser::findClosingParen(int tokenPos) {
+    auto cached = closingParens.find(tokenPos);
+    if (cached != closingParens.end()) {
+        return cached->second;
+    }
+    // Every LPAREN passed on the way is matched too. Enclosing parens are looked up before the ones
+    // they enclose, so each token is only scanned once.
+    std::vector<int> openParens = { tokenPos };
+    for (int i = tokenPos + 1; !openParens.empty() && haveTokensLeft(i); i++) {
+        if (tokenTypeIs(i, lexer::TokenType::LPAREN)) {
+            openParens.push_back(i);
+        } else if (tokenTypeIs(i, lexer::TokenType::RPAREN)) {
+            closingParens[openParens.back()] = i;
+            openParens.pop_back();
+        }
+    }
+    for (int unmatched : openParens) {
+        closingParens[unmatched] = -1;
+    }
+    return closingParens[tokenPos];
+}
+
+void Parser::releaseTokensBefore(int tokenPos) {
+    tokens.release(tokenPos);
+    closingParens.erase(closingParens.begin(), closingParens.lower_bound(tokenPos));
+}
+
 // rel_expr: rel_factor ‘>’ rel_factor
 //          | rel_factor ‘>=’ rel_factor
 //          | rel_factor ‘<’ rel_factor
@@ -262,7 +383,7 @@ State Parser::parseCondition(int tokenPos) {
 //          | rel_factor ‘!=’ rel_factor
 State Parser::parseRelExpr(int tokenPos) {
     logLine("start parseRelExpr");
-    const State& left_rel_factor = parseRelFactor(tokenPos);
+    State left_rel_factor = parseRelFactor(tokenPos);
     tokenPos = left_rel_factor.tokenPos;
 
     int line;
@@ -291,14 +412,11 @@ State Parser::parseRelExpr(int tokenPos) {
                                  lexer::prettyPrintType(peekToken(tokenPos).type));
     }
 
-    const State& right_rel_factor = parseRelFactor(tokenPos);
+    State right_rel_factor = parseRelFactor(tokenPos);
     tokenPos = right_rel_factor.tokenPos;
 
-    TNode relExprNode(opType, line);
-    relExprNode.addChild(left_rel_factor.tNode);
-    relExprNode.addChild(right_rel_factor.tNode);
     logLine("success parseRelExpr");
-    return State(tokenPos, relExprNode);
+    return State(tokenPos, ast.addNode(opType, line, { left_rel_factor.node, right_rel_factor.node }));
 }
 
 // rel_factor: var_name | const_value | expr
@@ -319,9 +437,9 @@ State Parser::parseExpr(int tokenPos) {
         if (nextType != lexer::TokenType::PLUS && nextType != lexer::TokenType::MINUS) {
             break;
         }
-        auto operatorToken = assertTokenAndPop(tokenPos, nextType);
+        const lexer::SourceToken& operatorToken = assertTokenAndPop(tokenPos, nextType);
 
-        // Construct a new TNode as the result, like so:
+        // Construct a new node as the result, like so:
         //     newExpr: +
         //            /   \
         //        result   nextTerm
@@ -330,9 +448,7 @@ State Parser::parseExpr(int tokenPos) {
 
         // Create newExpr
         TNodeType newExprType = operatorToken.type == lexer::PLUS ? TNodeType::Plus : TNodeType::Minus;
-        TNode newExpr(newExprType);
-        newExpr.addChild(result.tNode);
-        newExpr.addChild(nextTermState.tNode);
+        NodeId newExpr = ast.addNode(newExprType, 0, { result.node, nextTermState.node });
 
         // Update the result;
         result = State(nextTermState.tokenPos, newExpr);
@@ -358,9 +474,9 @@ State Parser::parseTerm(int tokenPos) {
             nextType != lexer::TokenType::MOD) {
             break;
         }
-        auto operatorToken = assertTokenAndPop(tokenPos, nextType);
+        const lexer::SourceToken& operatorToken = assertTokenAndPop(tokenPos, nextType);
 
-        // Construct a new TNode as the result, like so:
+        // Construct a new node as the result, like so:
         //     newTerm: *
         //            /   \
         //        result   nextFactor
@@ -369,9 +485,7 @@ State Parser::parseTerm(int tokenPos) {
 
         // Create newExpr
         TNodeType newTermType = tokenTypeToTNodeType[operatorToken.type];
-        TNode newTerm(newTermType);
-        newTerm.addChild(result.tNode);
-        newTerm.addChild(nextFactorState.tNode);
+        NodeId newTerm = ast.addNode(newTermType, 0, { result.node, nextFactorState.node });
 
         // Update the result;
         result = State(nextFactorState.tokenPos, newTerm);
@@ -398,28 +512,24 @@ State Parser::parseFactor(int tokenPos) {
         tokenPos = res.tokenPos;
         assertTokenAndPop(tokenPos, lexer::TokenType::RPAREN);
         logLine("success parseFactor");
-        return State(tokenPos, res.tNode);
+        return State(tokenPos, res.node);
     }
 }
 
 // var_name, proc_name: NAME
 State Parser::parseVarName(int tokenPos) {
     logLine("start parseVarName");
-    const lexer::Token& t = assertTokenAndPop(tokenPos, lexer::TokenType::NAME);
-    TNode node(Variable, t.line);
-    node.name = t.nameValue;
+    const lexer::SourceToken& t = assertTokenAndPop(tokenPos, lexer::TokenType::NAME);
     logLine("success parseVarName");
-    return State(tokenPos, node);
+    return State(tokenPos, ast.addLeaf(Variable, t.line, internName(t)));
 }
 
 // const_value: INTEGER
 State Parser::parseConstValue(int tokenPos) {
     logLine("start parseConstValue");
-    const lexer::Token& t = assertTokenAndPop(tokenPos, lexer::TokenType::INTEGER);
-    TNode node(Constant, t.line);
-    node.constant = t.integerValue;
+    const lexer::SourceToken& t = assertTokenAndPop(tokenPos, lexer::TokenType::INTEGER);
     logLine("success parseConstValue");
-    return State(tokenPos, node);
+    return State(tokenPos, ast.addLeaf(Constant, t.line, internName(t)));
 }
 
 // assign: var_name ‘=’ expr ‘;’
@@ -428,61 +538,50 @@ State Parser::parseAssign(int tokenPos) {
 
     const State& lhsState = parseVarName(tokenPos);
     tokenPos = lhsState.tokenPos;
-    const TNode& lhsNode = lhsState.tNode;
 
     int eqLine = assertTokenAndPop(tokenPos, lexer::TokenType::SINGLE_EQ).line;
-    TNode assignNode(TNodeType::Assign, eqLine);
 
     const State& exprState = parseExpr(tokenPos);
     tokenPos = exprState.tokenPos;
-    assignNode.addChild(lhsNode);
-    assignNode.addChild(exprState.tNode);
 
     assertTokenAndPop(tokenPos, lexer::TokenType::SEMICOLON);
 
     logLine("success parseAssign");
-    return State(tokenPos, assignNode);
+    return State(tokenPos, ast.addNode(TNodeType::Assign, eqLine, { lhsState.node, exprState.node }));
 }
 
 // read: ‘read’ var_name’;’
 State Parser::parseRead(int tokenPos) {
-    const lexer::Token& token = assertNameTokenAndPop(tokenPos, constants::READ);
-    TNode readNode(Read, token.line);
+    const lexer::SourceToken& token = assertNameTokenAndPop(tokenPos, constants::READ);
 
     const State& varState = parseVarName(tokenPos);
     tokenPos = varState.tokenPos;
 
-    readNode.addChild(varState.tNode);
     assertTokenAndPop(tokenPos, lexer::TokenType::SEMICOLON);
-    return State(tokenPos, readNode);
+    return State(tokenPos, ast.addNode(Read, token.line, { varState.node }));
 }
 
 // print: ‘print’ var_name’;’
 State Parser::parsePrint(int tokenPos) {
-    const lexer::Token& token = assertNameTokenAndPop(tokenPos, constants::PRINT);
-    TNode printNode(Print, token.line);
+    const lexer::SourceToken& token = assertNameTokenAndPop(tokenPos, constants::PRINT);
 
     const State& varState = parseVarName(tokenPos);
     tokenPos = varState.tokenPos;
 
-    printNode.addChild(varState.tNode);
     assertTokenAndPop(tokenPos, lexer::TokenType::SEMICOLON);
-    return State(tokenPos, printNode);
+    return State(tokenPos, ast.addNode(Print, token.line, { varState.node }));
 }
 
 // call: ‘call’ proc_name ‘;’
 State Parser::parseCall(int tokenPos) {
-    const lexer::Token& token = assertNameTokenAndPop(tokenPos, constants::CALL);
-    TNode callNode(Call, token.line);
+    const lexer::SourceToken& token = assertNameTokenAndPop(tokenPos, constants::CALL);
 
     const State& varState = parseVarName(tokenPos);
     tokenPos = varState.tokenPos;
-    TNode callVar(std::move(varState.tNode));
-    callVar.isProcedureVar = true;
+    ast.setProcedureVar(varState.node);
 
-    callNode.addChild(callVar);
     assertTokenAndPop(tokenPos, lexer::TokenType::SEMICOLON);
-    return State(tokenPos, callNode);
+    return State(tokenPos, ast.addNode(Call, token.line, { varState.node }));
 }
 
 /**
@@ -492,14 +591,15 @@ State Parser::parseCall(int tokenPos) {
  */
 std::string Parser::parseExpr(const std::string& exprStr) {
     try {
-        std::istringstream iStr(exprStr);
         // If exprStr is invalid, tokenize will throw.
-        std::vector<lexer::Token> tokens = lexer::tokenize(iStr);
-
-        Parser parser(tokens);
+        Parser parser(lexer::tokenize(lexer::SourceBuffer::fromString(exprStr)));
         // If there is any issue with parsing tokens, parseExpr will throw.
         State s = parser.parseExpr(0);
-        return getExprString(s.tNode);
+        // The whole of exprStr must be one expression, e.g. "1 + 2 3" is invalid.
+        if (parser.haveTokensLeft(s.tokenPos)) {
+            return "";
+        }
+        return getExprString(parser.ast.toTNode(s.node));
     } catch (const std::exception& e) {
         return "";
     }
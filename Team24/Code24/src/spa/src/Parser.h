@@ -1,17 +1,21 @@
 #pragma once
 
+#include "FlatAST.h"
 #include "Lexer.h"
 #include "TNode.h"
 
 #include <list>
+#include <map>
+#include <memory>
+#include <utility>
 #include <vector>
 
 namespace backend {
 class State {
   public:
-    explicit State(int tokenPos, TNode tNode);
-    // Created tNode
-    TNode tNode;
+    explicit State(int tokenPos, NodeId node);
+    // Created node in the Parser's FlatAST
+    NodeId node;
     // ending position
     int tokenPos{ -1 };
 };
@@ -29,28 +33,52 @@ constexpr char ELSE[] = "else";
 
 class Parser {
   public:
-    explicit Parser(std::vector<lexer::Token> tokens);
-    // Generate AST from parser.
+    explicit Parser(const std::vector<lexer::Token>& tokens);
+    explicit Parser(lexer::TokenizedSource source);
+    // Lexes the buffer as the parser pulls its tokens, holding only a window of them at a time.
+    explicit Parser(std::shared_ptr<const lexer::SourceBuffer> buffer);
+    // Generate AST from parser. The AST is built as a FlatAST and converted to a TNode once.
     TNode parse();
+    /**
+     * Generate AST from parser, parsing the procedures of the program on several threads. The
+     * procedures are put into the Program node in source order, so the AST, and the statement numbers
+     * given to it, are the same as those of `parse`. If parsing fails, the program is parsed again
+     * by `parse` so that the same error is thrown.
+     * @param threadCount The maximum number of threads to use, or 0 to use one per hardware thread.
+     */
+    TNode parseInParallel(unsigned int threadCount = 0);
     /**
      * generate a precedent adhering expression string that is enforced by brackets.
      * @param exprStr - A raw expr string. E.g. 1+2*3.
-     * @return string with brackets to represent precedence. E.g. 1+2*3 -> (1+(2*3)).
+     * @return string with brackets to represent precedence. E.g. 1+2*3 -> (1+(2*3)). This is the
+     * canonical form that patterns are stored and matched in. Empty if exprStr is not an expr.
      */
     static std::string parseExpr(const std::string& exprStr);
 
-    std::vector<lexer::Token> tokens;
+    lexer::TokenStream tokens;
+    // Nodes created by the parse primitives.
+    FlatAST ast;
+    // Position of the RPAREN matching the LPAREN at a position, or -1. Filled as they are looked up.
+    std::map<int, int> closingParens;
     // -- Helpers --
 
     // Returns true if there are any tokens left in the
-    // Parser's vector of tokens. tokenPos is 0-indexed.
-    bool haveTokensLeft(int tokenPos) const;
+    // Parser's stream of tokens. tokenPos is 0-indexed.
+    bool haveTokensLeft(int tokenPos);
     bool tokenTypeIs(int tokenPos, lexer::TokenType);
     bool tokenHasName(int tokenPos, const std::string& name);
-    lexer::Token peekToken(int tokenPos);
-    lexer::Token assertTokenAndPop(int& tokenPos, lexer::TokenType);
+    const lexer::SourceToken& peekToken(int tokenPos);
+    const lexer::SourceToken& assertTokenAndPop(int& tokenPos, lexer::TokenType);
     void assertTokenIsOfType(int tokenPos, lexer::TokenType);
-    lexer::Token assertNameTokenAndPop(int& tokenPos, const std::string& name);
+    const lexer::SourceToken& assertNameTokenAndPop(int& tokenPos, const std::string& name);
+    NameId internName(const lexer::SourceToken& token);
+    // Returns the [first, last] token positions of every procedure, found by matching braces, or
+    // nothing if the tokens are not a sequence of procedures.
+    std::vector<std::pair<int, int>> findProcedureBounds();
+    // Returns the position of the RPAREN matching the LPAREN at tokenPos, or -1 if there is none.
+    int findClosingParen(int tokenPos);
+    // Tokens before tokenPos will not be looked at again.
+    void releaseTokensBefore(int tokenPos);
 
     // -- Parser primitives --
     State parseProgram(int tokenPos);
@@ -76,7 +104,6 @@ class Parser {
     State parseRead(int tokenPos);
     State parsePrint(int tokenPos);
     State parseCall(int tokenPos);
-    lexer::Token assertToken(int& tokenPos, lexer::TokenType type);
 
     static bool isValidExpr(const std::string& exprStr);
 };
@@ -0,0 +1,191 @@
+#include "PatternIndex.h"
+
+#include <cctype>
+#include <stdexcept>
+
+namespace backend {
+std::size_t ExpressionDAG::NodeHash::operator()(const Node& node) const {
+    std::size_t hash = static_cast<std::size_t>(node.type);
+    hash = hash * 31 + node.lhs;
+    hash = hash * 31 + node.rhs;
+    return hash;
+}
+
+ExprId ExpressionDAG::internLeaf(TNodeType type, const std::string& value) {
+    auto it = valueToId.find(value);
+    uint32_t valueId;
+    if (it != valueToId.end()) {
+        valueId = it->second;
+    } else {
+        valueId = static_cast<uint32_t>(valueToId.size());
+        valueToId.emplace(value, valueId);
+    }
+    return intern({ type, valueId, NO_EXPR });
+}
+
+ExprId ExpressionDAG::internOperator(TNodeType type, ExprId lhs, ExprId rhs) {
+    return intern({ type, lhs, rhs });
+}
+
+ExprId ExpressionDAG::intern(const Node& node) {
+    auto it = nodeToId.find(node);
+    if (it != nodeToId.end()) {
+        return it->second;
+    }
+    ExprId id = static_cast<ExprId>(nodes.size());
+    nodes.push_back(node);
+    nodeToId.emplace(node, id);
+    return id;
+}
+
+ExprId ExpressionDAG::find(const Node& node) const {
+    auto it = nodeToId.find(node);
+    return it == nodeToId.end() ? NO_EXPR : it->second;
+}
+
+namespace {
+TNodeType getOperatorType(char c) {
+    switch (c) {
+    case '+':
+        return Plus;
+    case '-':
+        return Minus;
+    case '*':
+        return Multiply;
+    case '/':
+        return Divide;
+    case '%':
+        return Modulo;
+    default:
+        return INVALID;
+    }
+}
+} // namespace
+
+// expr: NAME | INTEGER | '(' expr operator expr ')'
+ExprId ExpressionDAG::findCanonical(const std::string& canonicalExpr) const {
+    // The ids of the expressions and the types of the operators read so far, that are not yet part
+    // of a bracketed expression.
+    std::vector<ExprId> operands;
+    std::vector<TNodeType> operators;
+    size_t openBrackets = 0;
+    size_t pos = 0;
+    while (pos < canonicalExpr.size()) {
+        char c = canonicalExpr[pos];
+        if (c == '(') {
+            openBrackets++;
+            pos++;
+        } else if (c == ')') {
+            // A bracket closes `lhs operator rhs`.
+            if (openBrackets == 0 || operands.size() < 2 || operators.empty() ||
+                operands.size() != operators.size() + 1) {
+                return NO_EXPR;
+            }
+            ExprId rhs = operands.back();
+            operands.pop_back();
+            ExprId lhs = operands.back();
+            operands.pop_back();
+            ExprId id = find({ operators.back(), lhs, rhs });
+            operators.pop_back();
+            if (id == NO_EXPR) {
+                return NO_EXPR;
+            }
+            operands.push_back(id);
+            openBrackets--;
+            pos++;
+        } else if (getOperatorType(c) != INVALID) {
+            // An operator must follow its lhs, in brackets.
+            if (openBrackets == 0 || operands.size() != operators.size() + 1) {
+                return NO_EXPR;
+            }
+            operators.push_back(getOperatorType(c));
+            pos++;
+        } else {
+            // A name or integer runs until the next bracket or operator.
+            size_t end = canonicalExpr.find_first_of("()+-*/%", pos);
+            if (end == std::string::npos) {
+                end = canonicalExpr.size();
+            }
+            if (operands.size() != operators.size()) {
+                return NO_EXPR;
+            }
+            TNodeType type = std::isdigit(static_cast<unsigned char>(c)) ? Constant : Variable;
+            auto it = valueToId.find(canonicalExpr.substr(pos, end - pos));
+            if (it == valueToId.end()) {
+                return NO_EXPR;
+            }
+            ExprId id = find({ type, it->second, NO_EXPR });
+            if (id == NO_EXPR) {
+                return NO_EXPR;
+            }
+            operands.push_back(id);
+            pos = end;
+        }
+    }
+    if (openBrackets != 0 || operands.size() != 1 || !operators.empty()) {
+        return NO_EXPR;
+    }
+    return operands.back();
+}
+
+ExprId PatternIndex::addAssignment(const VARIABLE_NAME& assignee, STATEMENT_NUMBER statementNumber, const TNode& expr) {
+    // A post-order traversal with an explicit stack, as the operands of an operator must be interned
+    // before it. An operator is visited twice: first to visit its operands, then to intern it from
+    // their ids, which are on top of `operands`.
+    std::vector<std::pair<const TNode*, bool>> toVisit = { { &expr, false } };
+    std::vector<ExprId> operands;
+    while (!toVisit.empty()) {
+        const TNode* visiting = toVisit.back().first;
+        bool areOperandsInterned = toVisit.back().second;
+        toVisit.pop_back();
+
+        ExprId id;
+        if (visiting->type == Constant) {
+            id = expressions.internLeaf(Constant, visiting->constant);
+        } else if (visiting->type == Variable) {
+            id = expressions.internLeaf(Variable, visiting->name);
+        } else if (visiting->children.size() != 2) {
+            throw std::runtime_error("PatternIndex::addAssignment: leaf node should only be a constant or a "
+                                     "variable. Got: " +
+                                     getTNodeTypeString(visiting->type));
+        } else if (!areOperandsInterned) {
+            toVisit.emplace_back(visiting, true);
+            toVisit.emplace_back(&visiting->children[1], false);
+            toVisit.emplace_back(&visiting->children[0], false);
+            continue;
+        } else {
+            ExprId rhs = operands.back();
+            operands.pop_back();
+            ExprId lhs = operands.back();
+            operands.pop_back();
+            id = expressions.internOperator(visiting->type, lhs, rhs);
+        }
+
+        if (id >= postings.size()) {
+            postings.resize(id + 1);
+        }
+        postings[id].push_back({ assignee, statementNumber, visiting != &expr });
+        operands.push_back(id);
+    }
+    return operands.back();
+}
+
+const std::vector<PatternPosting>& PatternIndex::getPostings(const std::string& canonicalExpr) const {
+    static const std::vector<PatternPosting> noPostings;
+    ExprId id = expressions.findCanonical(canonicalExpr);
+    return id == NO_EXPR ? noPostings : postings[id];
+}
+
+STATEMENT_NUMBER_SET
+PatternIndex::match(const VARIABLE_NAME& assignee, const std::string& canonicalExpr, bool isSubExpr) const {
+    STATEMENT_NUMBER_SET result;
+    for (const PatternPosting& posting : getPostings(canonicalExpr)) {
+        // Skip results that have a different assignee, or that are sub expressions of an exact match.
+        if ((assignee != "_" && posting.assignee != assignee) || (!isSubExpr && posting.isSubExpr)) {
+            continue;
+        }
+        result.insert(posting.statementNumber);
+    }
+    return result;
+}
+} // namespace backend
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "PKB.h"
+#include "TNode.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace backend {
+typedef uint32_t ExprId;
+
+// Id of an expression that is not in the ExpressionDAG.
+const ExprId NO_EXPR = UINT32_MAX;
+
+/**
+ * Expressions hash-consed into a DAG. Structurally equal expressions get the same ExprId, so every
+ * distinct subexpression is stored once however often it occurs, and comparing two expressions is
+ * comparing two integers.
+ *
+ * An operator node refers to its operands by ExprId, which must be interned before the operator.
+ */
+class ExpressionDAG {
+  public:
+    // Interns a Variable or Constant.
+    ExprId internLeaf(TNodeType type, const std::string& value);
+    // Interns an operator (Plus, Minus, Multiply, Divide or Modulo) applied to two expressions.
+    ExprId internOperator(TNodeType type, ExprId lhs, ExprId rhs);
+
+    /**
+     * Finds an expression in the canonical form of Parser::parseExpr, e.g. "(x+(y*2))", without
+     * interning it.
+     * @return the id of the expression, or NO_EXPR if it is not in the DAG or is not canonical.
+     */
+    ExprId findCanonical(const std::string& canonicalExpr) const;
+
+    size_t size() const {
+        return nodes.size();
+    }
+
+  private:
+    struct Node {
+        TNodeType type;
+        // The operands of an operator. A leaf has its value's id in `lhs` and NO_EXPR in `rhs`.
+        uint32_t lhs;
+        uint32_t rhs;
+        bool operator==(const Node& other) const {
+            return type == other.type && lhs == other.lhs && rhs == other.rhs;
+        }
+    };
+    struct NodeHash {
+        std::size_t operator()(const Node& node) const;
+    };
+
+    std::vector<Node> nodes;
+    std::unordered_map<Node, ExprId, NodeHash> nodeToId;
+    std::unordered_map<std::string, uint32_t> valueToId;
+
+    ExprId intern(const Node& node);
+    ExprId find(const Node& node) const;
+};
+
+// An assignment statement in which an expression occurs.
+struct PatternPosting {
+    VARIABLE_NAME assignee;
+    STATEMENT_NUMBER statementNumber;
+    // Whether the expression is a proper subexpression of the assignment's expression.
+    bool isSubExpr;
+
+    bool operator==(const PatternPosting& other) const {
+        return assignee == other.assignee && statementNumber == other.statementNumber &&
+               isSubExpr == other.isSubExpr;
+    }
+};
+
+/**
+ * Index of the expressions of assignment statements, for pattern matching.
+ *
+ * Every subexpression of every assignment is interned into an ExpressionDAG, and is given a
+ * posting under its id. The index grows linearly with the total size of the expressions.
+ */
+class PatternIndex {
+  public:
+    // @return the id of the assignment's expression.
+    ExprId addAssignment(const VARIABLE_NAME& assignee, STATEMENT_NUMBER statementNumber, const TNode& expr);
+
+    // @return the postings of an expression in canonical form, in the order they were added.
+    const std::vector<PatternPosting>& getPostings(const std::string& canonicalExpr) const;
+
+    // @return the statements of the postings of canonicalExpr that have the assignee (unless it is
+    // "_"), and that are not subexpressions, unless isSubExpr.
+    STATEMENT_NUMBER_SET
+    match(const VARIABLE_NAME& assignee, const std::string& canonicalExpr, bool isSubExpr) const;
+
+    const ExpressionDAG& getExpressions() const {
+        return expressions;
+    }
+
+  private:
+    ExpressionDAG expressions;
+    // The postings of each ExprId.
+    std::vector<std::vector<PatternPosting>> postings;
+};
+} // namespace backend
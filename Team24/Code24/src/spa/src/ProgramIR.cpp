@@ -0,0 +1,34 @@
+#include "ProgramIR.h"
+
+namespace backend {
+STATEMENT_NUMBER ProgramIR::addStatement(const StatementIR& statement) {
+    if (statements.empty()) {
+        statements.emplace_back();
+    }
+    statements.push_back(statement);
+    return static_cast<STATEMENT_NUMBER>(statements.size()) - 1;
+}
+
+PROCEDURE_ID ProgramIR::addProcedure(const PROCEDURE_NAME& name) {
+    ProcedureIR procedure;
+    procedure.name = name;
+    procedures.push_back(procedure);
+    return static_cast<PROCEDURE_ID>(procedures.size()) - 1;
+}
+
+VARIABLE_ID ProgramIR::internVariable(const VARIABLE_NAME& name) {
+    auto it = variableIds.find(name);
+    if (it != variableIds.end()) {
+        return it->second;
+    }
+    VARIABLE_ID id = static_cast<VARIABLE_ID>(variableNames.size());
+    variableNames.push_back(name);
+    variableIds.emplace(name, id);
+    return id;
+}
+
+VARIABLE_ID ProgramIR::getVariableId(const VARIABLE_NAME& name) const {
+    auto it = variableIds.find(name);
+    return it == variableIds.end() ? NO_VARIABLE : it->second;
+}
+} // namespace backend
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "CompressedRelation.h"
+#include "PKB.h"
+#include "PatternIndex.h"
+#include "TNode.h"
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace backend {
+// Index of a variable name in a ProgramIR.
+typedef int VARIABLE_ID;
+// Index of a procedure in a ProgramIR, in the order the procedures are defined.
+typedef int PROCEDURE_ID;
+
+const VARIABLE_ID NO_VARIABLE = -1;
+const PROCEDURE_ID NO_PROCEDURE = -1;
+
+// A statement of the program, as the PKB keeps it once the AST is gone.
+struct StatementIR {
+    TNodeType type{ INVALID };
+    // The while or if statement that directly contains this statement, or 0 if there is none.
+    STATEMENT_NUMBER parent{ 0 };
+    PROCEDURE_ID procedure{ NO_PROCEDURE };
+    // The statement list that this statement is in, and its index in that list.
+    int statementList{ 0 };
+    int position{ 0 };
+    // The variable that an assign or read statement modifies.
+    VARIABLE_ID modifiedVariable{ NO_VARIABLE };
+    // The expression of an assign statement in the PatternIndex's ExpressionDAG.
+    ExprId expression{ NO_EXPR };
+    PROCEDURE_ID callee{ NO_PROCEDURE };
+};
+
+struct ProcedureIR {
+    PROCEDURE_NAME name;
+    // The statements of a procedure are numbered from firstStatement to lastStatement.
+    STATEMENT_NUMBER firstStatement{ 0 };
+    STATEMENT_NUMBER lastStatement{ 0 };
+};
+
+/**
+ * A compact, statement-indexed representation of a program. It holds no pointer into the AST, so
+ * the relations that the PKB computes lazily from it stay valid after the AST is freed.
+ */
+class ProgramIR {
+  public:
+    // @return the statement numbered s. s must be in [1, getStatementCount()].
+    const StatementIR& getStatement(STATEMENT_NUMBER s) const {
+        return statements[s];
+    }
+    StatementIR& getStatement(STATEMENT_NUMBER s) {
+        return statements[s];
+    }
+    bool isStatement(STATEMENT_NUMBER s) const {
+        return s > 0 && static_cast<size_t>(s) < statements.size();
+    }
+    int getStatementCount() const {
+        return statements.empty() ? 0 : static_cast<int>(statements.size()) - 1;
+    }
+    // Appends the statement numbered getStatementCount() + 1.
+    STATEMENT_NUMBER addStatement(const StatementIR& statement);
+
+    const std::vector<ProcedureIR>& getProcedures() const {
+        return procedures;
+    }
+    ProcedureIR& getProcedure(PROCEDURE_ID id) {
+        return procedures[id];
+    }
+    PROCEDURE_ID addProcedure(const PROCEDURE_NAME& name);
+
+    // @return the id of a variable, which is added if it is new.
+    VARIABLE_ID internVariable(const VARIABLE_NAME& name);
+    // @return the id of a variable, or NO_VARIABLE if the program has no such variable.
+    VARIABLE_ID getVariableId(const VARIABLE_NAME& name) const;
+    // @return every v in Modifies(s, v) or Uses(s, v), sorted. These count called procedures.
+    CompressedRelation::Range getModifiedVariables(STATEMENT_NUMBER s) const {
+        return modifies.get(s);
+    }
+    CompressedRelation::Range getUsedVariables(STATEMENT_NUMBER s) const {
+        return uses.get(s);
+    }
+    // Sets the Modifies and Uses relations, from statement numbers to variable ids.
+    void setModifiesAndUses(CompressedRelation modifiesRelation, CompressedRelation usesRelation) {
+        modifies = std::move(modifiesRelation);
+        uses = std::move(usesRelation);
+    }
+    const CompressedRelation& getModifies() const {
+        return modifies;
+    }
+    const CompressedRelation& getUses() const {
+        return uses;
+    }
+
+    const VARIABLE_NAME& getVariableName(VARIABLE_ID id) const {
+        return variableNames[id];
+    }
+    int getVariableCount() const {
+        return static_cast<int>(variableNames.size());
+    }
+
+  private:
+    // Indexed by statement number. Index 0 is unused.
+    std::vector<StatementIR> statements;
+    std::vector<ProcedureIR> procedures;
+    CompressedRelation modifies;
+    CompressedRelation uses;
+    std::vector<VARIABLE_NAME> variableNames;
+    std::unordered_map<VARIABLE_NAME, VARIABLE_ID> variableIds;
+};
+} // namespace backend
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <functional>
 #include <stdexcept>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 
@@ -284,6 +285,79 @@ bool SingleQueryEvaluator::evaluateClause(const backend::PKB* pkb, const CLAUSE&
     }
 }
 
+namespace {
+/**
+ * @return true if the sub-relation only holds between statements of the same procedure, so that
+ * pairs of statements from different procedures can be pruned without asking for the relation
+ */
+bool isWithinProcedure(SubRelationType subRelationType) {
+    switch (subRelationType) {
+    case PREFOLLOWS:
+    case POSTFOLLOWS:
+    case PREFOLLOWST:
+    case POSTFOLLOWST:
+    case PREPARENT:
+    case POSTPARENT:
+    case PREPARENTT:
+    case POSTPARENTT:
+    case PRENEXT:
+    case POSTNEXT:
+    case PRENEXTT:
+    case POSTNEXTT:
+    case PREAFFECTS:
+    case POSTAFFECTS:
+    case PREAFFECTST:
+    case POSTAFFECTST:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @param relation : set to the relation that PKB::getTransitivePairs answers for the sub-relation
+ * @param isReversed : set to whether the first synonym is the target of the relation
+ * @return false if the sub-relation is not answered with PKB::getTransitivePairs
+ */
+bool getTransitivePairsRelation(SubRelationType subRelationType,
+                                backend::TransitiveStatementRelation& relation,
+                                bool& isReversed) {
+    switch (subRelationType) {
+    case PRENEXTT:
+    case POSTNEXTT:
+        relation = backend::NextTransitive;
+        isReversed = subRelationType == POSTNEXTT;
+        return true;
+    case PREAFFECTST:
+    case POSTAFFECTST:
+        relation = backend::AffectsTransitive;
+        isReversed = subRelationType == POSTAFFECTST;
+        return true;
+    case PREPARENTT:
+    case POSTPARENTT:
+        relation = backend::ParentTransitive;
+        isReversed = subRelationType == POSTPARENTT;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @return whether the statement is related to itself by the relation, i.e. lies on a cycle of it
+ */
+bool isTransitiveToItself(const backend::PKB* pkb, backend::TransitiveStatementRelation relation, STATEMENT_NUMBER s) {
+    switch (relation) {
+    case backend::NextTransitive:
+        return pkb->isNextTransitive(s, s);
+    case backend::AffectsTransitive:
+        return pkb->isAffectsTransitive(s, s);
+    default:
+        return pkb->isParentTransitive(s, s);
+    }
+}
+} // namespace
+
 /**
  * evaluate the clause against a pair of synonyms
  * after evaluation, update two synonyms' candidate list
@@ -292,7 +366,7 @@ bool SingleQueryEvaluator::evaluateClause(const backend::PKB* pkb, const CLAUSE&
  * @param arg1 : the name of first synonym
  * @param arg2 : the name of second synonym
  * @param groupResultTable: the result table of the group the clause belongs to
- * @param patternStr: the pattern string
+ * @param patternStr: the pattern expression, in the canonical form stored by the QueryPreprocessor
  * @return : false if any synonym's candidate value list got empty. otherwise true
  */
 bool SingleQueryEvaluator::evaluateSynonymSynonym(const backend::PKB* pkb,
@@ -314,6 +388,9 @@ bool SingleQueryEvaluator::evaluateSynonymSynonym(const backend::PKB* pkb,
     // check all pairs
     std::unordered_set<std::string> singleEntity;
     std::unordered_set<std::vector<std::string>, StringVectorHash> pairs;
+    std::vector<std::vector<std::string>> distinctPairs;
+    backend::TransitiveStatementRelation transitiveRelation;
+    bool isReversed;
     if (subRelationType == WITH_SRT) {
         const std::string& attrName = arg1 + "_" + arg2;
         std::unordered_set<std::vector<std::string>, StringVectorHash> attrPairs1 =
@@ -328,6 +405,84 @@ bool SingleQueryEvaluator::evaluateSynonymSynonym(const backend::PKB* pkb,
         } else {
             rt1.updateSynonymValueTupleSet({ arg1, arg2 }, pairs);
         }
+    } else if (isSelfRelation && getTransitivePairsRelation(subRelationType, transitiveRelation, isReversed)) {
+        // Only the pairs of a statement with itself are kept, so each candidate is checked on its
+        // own instead of searching for all pairs and dropping the rest.
+        for (const auto& c1 : candidates_1) {
+            if (isTransitiveToItself(pkb, transitiveRelation, std::stoi(c1))) {
+                singleEntity.insert(c1);
+            }
+        }
+    } else if (!isSelfRelation && getTransitivePairsRelation(subRelationType, transitiveRelation, isReversed)) {
+        // All candidates are searched from at once, instead of one PKB call per candidate. The
+        // candidates are split by procedure, and the procedures without candidates for both
+        // synonyms are left out. Statements are numbered in order of procedure, so sorting the
+        // candidates also groups the sources that the search handles together by procedure.
+        std::unordered_map<PROCEDURE_NAME, int> procedureCandidates;
+        std::vector<STATEMENT_NUMBER> statements_2;
+        for (const auto& c2 : candidates_2) {
+            statements_2.push_back(std::stoi(c2));
+            procedureCandidates[pkb->getProcedureOfStatement(statements_2.back())] |= 2;
+        }
+        std::vector<STATEMENT_NUMBER> statements_1;
+        for (const auto& c1 : candidates_1) {
+            STATEMENT_NUMBER s1 = std::stoi(c1);
+            auto procedure = procedureCandidates.find(pkb->getProcedureOfStatement(s1));
+            if (procedure != procedureCandidates.end()) {
+                procedure->second |= 1;
+                statements_1.push_back(s1);
+            }
+        }
+        auto isUnmatched = [&](STATEMENT_NUMBER s2) {
+            return procedureCandidates[pkb->getProcedureOfStatement(s2)] != 3;
+        };
+        statements_2.erase(std::remove_if(statements_2.begin(), statements_2.end(), isUnmatched),
+                           statements_2.end());
+        std::sort(statements_1.begin(), statements_1.end());
+        std::sort(statements_2.begin(), statements_2.end());
+        STATEMENT_NUMBER_PAIR_LIST statementPairs =
+        isReversed ? pkb->getTransitivePairs(transitiveRelation, statements_2, statements_1) :
+                     pkb->getTransitivePairs(transitiveRelation, statements_1, statements_2);
+        // The search gives each pair once, so the pairs go into the table without being hashed.
+        distinctPairs.reserve(statementPairs.size());
+        for (const auto& statementPair : statementPairs) {
+            STATEMENT_NUMBER s1 = isReversed ? statementPair.second : statementPair.first;
+            STATEMENT_NUMBER s2 = isReversed ? statementPair.first : statementPair.second;
+            distinctPairs.push_back({ std::to_string(s1), std::to_string(s2) });
+        }
+    } else if (!isSelfRelation && (subRelationType == PRECALLST || subRelationType == POSTCALLST)) {
+        // Calls* is searched from all candidates at once as well, over the procedure ids.
+        bool isCallerSecond = subRelationType == POSTCALLST;
+        PROCEDURE_NAME_PAIR_LIST procedurePairs = isCallerSecond ?
+                                                  pkb->getTransitiveCallPairs(candidates_2, candidates_1) :
+                                                  pkb->getTransitiveCallPairs(candidates_1, candidates_2);
+        for (auto& procedurePair : procedurePairs) {
+            if (isCallerSecond) {
+                pairs.insert({ std::move(procedurePair.second), std::move(procedurePair.first) });
+            } else {
+                pairs.insert({ std::move(procedurePair.first), std::move(procedurePair.second) });
+            }
+        }
+    } else if (!isSelfRelation && isWithinProcedure(subRelationType)) {
+        // Both domains are split by procedure once. A candidate of the first synonym is only looked
+        // up if its procedure has candidates of the second synonym, and is only paired with those.
+        std::unordered_map<PROCEDURE_NAME, std::vector<std::string>> procedureCandidates_2;
+        for (const auto& c2 : candidates_2) {
+            procedureCandidates_2[pkb->getProcedureOfStatement(std::stoi(c2))].push_back(c2);
+        }
+        for (const auto& c1 : candidates_1) {
+            auto sameProcedure = procedureCandidates_2.find(pkb->getProcedureOfStatement(std::stoi(c1)));
+            if (sameProcedure == procedureCandidates_2.end()) {
+                continue;
+            }
+            std::vector<std::string> c1_result =
+            inquirePKBForRelationOrPattern(pkb, subRelationType, c1, patternStr);
+            for (const auto& c2 : sameProcedure->second) {
+                if (isFoundInVector<std::string>(c1_result, c2)) {
+                    pairs.insert({ c1, c2 });
+                }
+            }
+        }
     } else {
         for (const auto& c1 : candidates_1) {
             std::vector<std::string> c1_result;
@@ -350,6 +505,9 @@ bool SingleQueryEvaluator::evaluateSynonymSynonym(const backend::PKB* pkb,
     if (isSelfRelation) {
         ResultTable newRT(arg1, singleEntity);
         groupResultTable.mergeTable(std::move(newRT));
+    } else if (!distinctPairs.empty()) {
+        ResultTable newRT({ arg1, arg2 }, std::move(distinctPairs));
+        groupResultTable.mergeTable(std::move(newRT));
     } else {
         ResultTable newRT({ arg1, arg2 }, pairs);
         groupResultTable.mergeTable(std::move(newRT));
@@ -367,7 +525,7 @@ bool SingleQueryEvaluator::evaluateSynonymSynonym(const backend::PKB* pkb,
  * @param arg1 : an entity--stetment number or procedure name or variable name
  * @param arg2 : the name of a synonym
  * @param groupResultTable: the IRT table of the group the clause belongs to
- * @param patternStr : the pattern string
+ * @param patternStr : the pattern expression, in the canonical form stored by the QueryPreprocessor
  * @return false if no candidates of synonym makes the relation hold, otherwise true
  */
 bool SingleQueryEvaluator::evaluateEntitySynonym(const backend::PKB* pkb,
@@ -414,6 +572,34 @@ bool SingleQueryEvaluator::evaluateEntityEntity(const backend::PKB* pkb,
     if (subRelationType == WITH_SRT) {
         return arg1 == arg2;
     }
+    if (isWithinProcedure(subRelationType)) {
+        STATEMENT_NUMBER s1 = std::stoi(arg1);
+        STATEMENT_NUMBER s2 = std::stoi(arg2);
+        if (!pkb->isInSameProcedure(s1, s2)) {
+            return false;
+        }
+        // The transitive relations are checked for the pair, without the statements related to arg1.
+        switch (subRelationType) {
+        case PREFOLLOWST:
+            return pkb->isFollowsTransitive(s1, s2);
+        case POSTFOLLOWST:
+            return pkb->isFollowsTransitive(s2, s1);
+        case PREPARENTT:
+            return pkb->isParentTransitive(s1, s2);
+        case POSTPARENTT:
+            return pkb->isParentTransitive(s2, s1);
+        case PRENEXTT:
+            return pkb->isNextTransitive(s1, s2);
+        case POSTNEXTT:
+            return pkb->isNextTransitive(s2, s1);
+        case PREAFFECTST:
+            return pkb->isAffectsTransitive(s1, s2);
+        case POSTAFFECTST:
+            return pkb->isAffectsTransitive(s2, s1);
+        default:
+            break;
+        }
+    }
     std::vector<std::string> arg1_result = inquirePKBForRelationOrPattern(pkb, subRelationType, arg1, "");
     return isFoundInVector<std::string>(arg1_result, arg2);
 }
@@ -505,12 +691,10 @@ std::vector<std::string> SingleQueryEvaluator::inquirePKBForRelationOrPattern(co
         result = castToStrVector<>(stmts);
         break;
     case PREFOLLOWST:
-        stmts = pkb->getStatementsThatFollows(std::stoi(arg));
-        result = castToStrVector<>(stmts);
+        result = castToStrVector<>(pkb->getStatementsThatFollowAsList(std::stoi(arg)));
         break;
     case POSTFOLLOWST:
-        stmts = pkb->getStatementsFollowedBy(std::stoi(arg));
-        result = castToStrVector<>(stmts);
+        result = castToStrVector<>(pkb->getStatementsFollowedByAsList(std::stoi(arg)));
         break;
     case PREPARENT:
         stmts = pkb->getChildren(std::stoi(arg));
@@ -521,8 +705,7 @@ std::vector<std::string> SingleQueryEvaluator::inquirePKBForRelationOrPattern(co
         result = castToStrVector<>(stmts);
         break;
     case PREPARENTT:
-        stmts = pkb->getDescendants(std::stoi(arg));
-        result = castToStrVector<>(stmts);
+        result = castToStrVector<>(pkb->getDescendantsAsList(std::stoi(arg)));
         break;
     case POSTPARENTT:
         stmts = pkb->getAncestors(std::stoi(arg));
@@ -667,17 +850,17 @@ std::vector<std::string> SingleQueryEvaluator::inquirePKBForRelationOrPattern(co
         break;
     }
     case ASSIGN_PATTERN_EXACT_SRT: {
-        stmts = pkb->getAllAssignmentStatementsThatMatch(arg, patternStr, false);
+        stmts = pkb->getAllAssignmentStatementsThatMatchCanonical(arg, patternStr, false);
         result = castToStrVector<>(stmts);
         break;
     }
     case ASSIGN_PATTERN_SUBEXPR_SRT: {
-        stmts = pkb->getAllAssignmentStatementsThatMatch(arg, patternStr, true);
+        stmts = pkb->getAllAssignmentStatementsThatMatchCanonical(arg, patternStr, true);
         result = castToStrVector<>(stmts);
         break;
     }
     case ASSIGN_PATTERN_WILDCARD_SRT: {
-        stmts = pkb->getAllAssignmentStatementsThatMatch(arg, "", true);
+        stmts = pkb->getAllAssignmentStatementsThatMatchCanonical(arg, "", true);
         result = castToStrVector<>(stmts);
         break;
     }
@@ -785,17 +968,17 @@ std::vector<std::string> SingleQueryEvaluator::inquirePKBForRelationWildcard(con
         result = std::vector<PROCEDURE_NAME>(procs.begin(), procs.end());
         break;
     case ASSIGN_PATTERN_EXACT_SRT: {
-        stmts = pkb->getAllAssignmentStatementsThatMatch("_", patternStr, false);
+        stmts = pkb->getAllAssignmentStatementsThatMatchCanonical("_", patternStr, false);
         result = castToStrVector<>(stmts);
         break;
     }
     case ASSIGN_PATTERN_SUBEXPR_SRT: {
-        stmts = pkb->getAllAssignmentStatementsThatMatch("_", patternStr, true);
+        stmts = pkb->getAllAssignmentStatementsThatMatchCanonical("_", patternStr, true);
         result = castToStrVector<>(stmts);
         break;
     }
     case ASSIGN_PATTERN_WILDCARD_SRT: {
-        stmts = pkb->getAllAssignmentStatementsThatMatch("_", "", true);
+        stmts = pkb->getAllAssignmentStatementsThatMatchCanonical("_", "", true);
         result = castToStrVector<>(stmts);
         break;
     }
@@ -7,7 +7,9 @@
 #include "Query.h"
 
 #include <algorithm> // std::find_if
+#include <functional>
 #include <sstream>
+#include <stdexcept>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -33,7 +35,7 @@ typedef std::tuple<State, qpbackend::EntityType, bool> STATE_ENTITY_RESULT_STATU
 typedef std::tuple<State, qpbackend::ArgType, qpbackend::ReturnType, std::string /*synonym*/, bool> STATE_ARGTYPE_RETURNTYPE_SYNSTRING_STATUS;
 typedef std::tuple<State, qpbackend::ReturnType, bool> STATE_RETURN_TYPE_STATUS;
 void throwIfTokenDoesNotHaveExpectedTokenType(backend::lexer::TokenType expectedTokenType, const TOKEN& token);
-static qpbackend::EntityType getEntityTypeFromToken(const TOKEN& token);
+static qpbackend::EntityType getEntityTypeFromToken(const TOKEN& token, const std::string& name);
 State parseSelect(State state);
 State parseDeclarations(State state);
 STATESTATUSPAIR parseSingleDeclaration(State state);
@@ -85,11 +87,55 @@ void throwIfTokenDoesNotHaveExpectedTokenType(backend::lexer::TokenType expected
     }
 }
 
-qpbackend::EntityType getEntityTypeFromToken(const TOKEN& token) {
+qpbackend::EntityType getEntityTypeFromToken(const TOKEN& token, const std::string& name) {
     throwIfTokenDoesNotHaveExpectedTokenType(backend::lexer::TokenType::NAME, token);
-    return qpbackend::entityTypeFromString(token.nameValue);
+    return qpbackend::entityTypeFromString(name);
 }
 
+/**
+ * The Query being built by one parse, shared by all of its States.
+ *
+ * Every change to the Query is recorded with a way to undo it. A State remembers how many changes
+ * it has seen, so when the parser backtracks to an earlier State, the changes made since are undone
+ * the next time that State uses the Query.
+ */
+class QueryJournal {
+  public:
+    qpbackend::Query query;
+
+    size_t size() const {
+        return changes.size();
+    }
+
+    // Records a change that was just made to the query. Returns the serial number of the change.
+    unsigned long record(std::function<void(qpbackend::Query&)> undo) {
+        changes.push_back({ ++lastSerial, std::move(undo) });
+        return lastSerial;
+    }
+
+    /**
+     * Undoes the changes after the first `changeCount`, the last of which must have the serial number
+     * `lastChangeSerial`. A State can only go back to a State it was copied from, never forward.
+     */
+    void rollBack(size_t changeCount, unsigned long lastChangeSerial) {
+        if (changeCount > changes.size() || (changeCount > 0 && changes[changeCount - 1].serial != lastChangeSerial)) {
+            throw std::logic_error(kQppErrorPrefix + "QueryJournal::rollBack: State was backtracked from.");
+        }
+        while (changes.size() > changeCount) {
+            changes.back().undo(query);
+            changes.pop_back();
+        }
+    }
+
+  private:
+    struct Change {
+        unsigned long serial;
+        std::function<void(qpbackend::Query&)> undo;
+    };
+    std::vector<Change> changes;
+    unsigned long lastSerial{ 0 };
+};
+
 /**
  * Encapsulates the state of the parser.
  *
@@ -117,17 +163,39 @@ qpbackend::EntityType getEntityTypeFromToken(const TOKEN& token) {
  * State abstracts away all the logic in manipulating the QPL query tokens and Query struct
  * directly. The State will also throw errors or exceptions once it has detected that it is in an
  * invalid state.
+ *
+ * A State is a cursor: a position in the shared tokens and a position in the shared QueryJournal,
+ * so saving and restoring a State to backtrack copies neither the tokens nor the Query.
  */
 class State {
   private:
-    qpbackend::Query query;
-    TOKENS tokens;
+    // Not owned; both outlive the State for the duration of parseTokens.
+    const backend::lexer::TokenizedSource* source{ nullptr };
+    QueryJournal* journal{ nullptr };
     unsigned int tokenPos{ 0 };
+    // The changes to the Query made up to this State.
+    size_t changeCount{ 0 };
+    unsigned long lastChangeSerial{ 0 };
+
+    // Returns the Query as of this State, undoing the changes made by States that were backtracked from.
+    qpbackend::Query& query() {
+        if (journal == nullptr) {
+            throw std::logic_error(kQppErrorPrefix + "State::query: State is not parsing a query.");
+        }
+        journal->rollBack(changeCount, lastChangeSerial);
+        return journal->query;
+    }
+
+    void recordChange(std::function<void(qpbackend::Query&)> undo) {
+        lastChangeSerial = journal->record(std::move(undo));
+        changeCount = journal->size();
+    }
+
     void logTokenAt(unsigned int tokenPos, std::string methodName) {
         std::stringstream s;
-        const TOKEN& token = tokens.at(tokenPos);
+        const TOKEN& token = (*source)[tokenPos];
         s << kQppLogInfoPrefix << methodName << " Token Position: " << std::to_string(tokenPos)
-          << "| value:" << token.nameValue << token.integerValue
+          << "| value:" << text(token)
           << " type:" << backend::lexer::prettyPrintType(token.type);
         logLine(s.str());
     }
@@ -135,59 +203,71 @@ class State {
 
   public:
     State() = default;
-    explicit State(const TOKENS& tokens) {
-        this->tokens = tokens;
+    State(const backend::lexer::TokenizedSource& source, QueryJournal& journal)
+    : source(&source), journal(&journal) {
     }
 
     // Query struct computed properties
 
     bool hasInvalidQueryDeclarationMap() {
-        return std::find_if(query.declarationMap.begin(), query.declarationMap.end(),
+        const qpbackend::DECLARATION_MAP& declarationMap = query().declarationMap;
+        return std::find_if(declarationMap.begin(), declarationMap.end(),
                             [](const std::pair<std::string, qpbackend::EntityType>& e) {
                                 return e.second == qpbackend::INVALID_ENTITY_TYPE;
-                            }) != query.declarationMap.end();
+                            }) != declarationMap.end();
     }
 
     qpbackend::EntityType getEntityType(const std::string& name) {
-        auto iterator = query.declarationMap.find(name);
-        if (iterator == query.declarationMap.end()) {
+        const qpbackend::DECLARATION_MAP& declarationMap = query().declarationMap;
+        auto iterator = declarationMap.find(name);
+        if (iterator == declarationMap.end()) {
             return qpbackend::INVALID_ENTITY_TYPE;
         }
         return iterator->second;
     }
 
-    // Copy getter(s)
+    // Getter(s)
 
-    qpbackend::Query getQuery() {
-        return query;
+    // A State that is not parsing a query, e.g. one returned for an invalid query, has an empty Query.
+    const qpbackend::Query& getQuery() {
+        static const qpbackend::Query emptyQuery;
+        return journal == nullptr ? emptyQuery : query();
     }
 
     // Tokens manipulation
 
+    std::string text(const TOKEN& token) const {
+        return source->text(token);
+    }
+
+    bool textEquals(const TOKEN& token, const std::string& value) const {
+        return source->textEquals(token, value);
+    }
+
     TOKEN peekToken() {
         if (!hasTokensLeftToParse()) {
             throw std::runtime_error(kQppErrorPrefix +
                                      "State::peekToken: There are no more tokens left to peek.");
         }
         logTokenAt(tokenPos, "peekToken");
-        return tokens[tokenPos];
+        return (*source)[tokenPos];
     }
 
-    backend::lexer::Token popToken() {
+    TOKEN popToken() {
         if (!hasTokensLeftToParse()) {
             throw std::runtime_error(kQppErrorPrefix +
                                      "State::popToken: QueryPreprocessor has "
                                      "not successfully parsed a Query yet, "
                                      "but has run out of tokens to parse.\n" +
-                                     query.toString());
+                                     query().toString());
         }
-        TOKEN tokenToReturn = tokens[tokenPos];
+        TOKEN tokenToReturn = (*source)[tokenPos];
         logTokenAt(tokenPos, "popToken");
         tokenPos += 1;
         return tokenToReturn;
     }
 
-    backend::lexer::Token popUntilNonWhitespaceToken() {
+    TOKEN popUntilNonWhitespaceToken() {
         TOKEN token = popToken();
         while (token.type == backend::lexer::WHITESPACE) {
             token = popToken();
@@ -214,13 +294,14 @@ class State {
     }
 
     bool hasTokensLeftToParse() {
-        return tokenPos < tokens.size();
+        return tokenPos < source->size();
     }
 
     // Query arg extraction
     qpbackend::ARG getArgFromSynonymString(const std::string& synonymString) {
-        auto iterator = query.declarationMap.find(synonymString);
-        if (iterator == query.declarationMap.end()) {
+        const qpbackend::DECLARATION_MAP& declarationMap = query().declarationMap;
+        auto iterator = declarationMap.find(synonymString);
+        if (iterator == declarationMap.end()) {
             logLine(kQppErrorPrefix + "getArgFromSynonymString: declarationMap does not contain synonym: " + synonymString);
             return qpbackend::ARG(qpbackend::ArgType::INVALID_ARG, synonymString);
         }
@@ -256,31 +337,42 @@ class State {
 
     void addSynonymToQueryDeclarationMap(qpbackend::EntityType entityType, const TOKEN& token) {
         throwIfTokenDoesNotHaveExpectedTokenType(backend::lexer::TokenType::NAME, token);
-        if (query.declarationMap.find(token.nameValue) != query.declarationMap.end()) {
-            query.declarationMap[token.nameValue] = qpbackend::INVALID_ENTITY_TYPE;
+        const std::string& name = text(token);
+        qpbackend::DECLARATION_MAP& declarationMap = query().declarationMap;
+        auto declaration = declarationMap.find(name);
+        if (declaration != declarationMap.end()) {
+            qpbackend::EntityType previousEntityType = declaration->second;
+            declaration->second = qpbackend::INVALID_ENTITY_TYPE;
+            recordChange([name, previousEntityType](qpbackend::Query& query) {
+                query.declarationMap[name] = previousEntityType;
+            });
             throw std::runtime_error(kQppErrorPrefix + "State::addSynonymToQueryDeclarationMap: Synonym " +
-                                     token.nameValue + " has already been declared.");
+                                     name + " has already been declared.");
         }
 
-        query.declarationMap.insert(std::pair<std::string, qpbackend::EntityType>(token.nameValue, entityType));
+        declarationMap.insert(std::pair<std::string, qpbackend::EntityType>(name, entityType));
+        recordChange([name](qpbackend::Query& query) { query.declarationMap.erase(name); });
     }
 
     void addSynonymToReturn(const TOKEN& token) {
         throwIfTokenDoesNotHaveExpectedTokenType(backend::lexer::TokenType::NAME, token);
-        addAttrRefToReturn(qpbackend::DEFAULT_VAL, token.nameValue);
+        addAttrRefToReturn(qpbackend::DEFAULT_VAL, text(token));
     }
 
     void addAttrRefToReturn(qpbackend::ReturnType returnType, const std::string& synString) {
+        qpbackend::Query& query = this->query();
         if (query.declarationMap.find(synString) == query.declarationMap.end()) {
             logLine(kQppLogWarnPrefix + "State::addSynonymToReturn: Cannot return values for synonym " +
                     synString + " as it has not been declared.");
             returnType = qpbackend::INVALID_RETURN_TYPE;
         }
         query.returnCandidates.emplace_back(returnType, synString);
+        recordChange([](qpbackend::Query& query) { query.returnCandidates.pop_back(); });
     }
 
     void addSuchThatClause(qpbackend::ClauseType relationType, const qpbackend::ARG& arg1, const qpbackend::ARG& arg2) {
-        query.suchThatClauses.emplace_back(relationType, arg1, arg2);
+        query().suchThatClauses.emplace_back(relationType, arg1, arg2);
+        recordChange([](qpbackend::Query& query) { query.suchThatClauses.pop_back(); });
     }
 
     void addPatternClause(qpbackend::ClauseType patternType,
@@ -292,8 +384,9 @@ class State {
                 " " + qpbackend::prettyPrintArg(synonym) + " " +
                 qpbackend::prettyPrintArg(variableName) + " " + expressionSpec);
         qpbackend::ARG invalidSyn = { qpbackend::INVALID_ARG, synonym.second };
+        const qpbackend::DECLARATION_MAP& declarationMap = query().declarationMap;
         // Validate synonym is declared
-        if (query.declarationMap.find(synonym.second) == query.declarationMap.end()) {
+        if (declarationMap.find(synonym.second) == declarationMap.end()) {
             addPatternClauseUnchecked(patternType, invalidSyn, variableName, expressionSpec);
             return;
         }
@@ -302,20 +395,20 @@ class State {
         case qpbackend::ASSIGN_PATTERN_WILDCARD:
         case qpbackend::ASSIGN_PATTERN_EXACT:
         case qpbackend::ASSIGN_PATTERN_SUB_EXPR: {
-            if (query.declarationMap.at(synonym.second) != qpbackend::ASSIGN) {
+            if (declarationMap.at(synonym.second) != qpbackend::ASSIGN) {
                 break;
             }
             addPatternClauseUnchecked(patternType, synonym, variableName, expressionSpec);
             return;
         }
         case qpbackend::IF_PATTERN:
-            if (query.declarationMap.at(synonym.second) != qpbackend::IF || expressionSpec != "_") {
+            if (declarationMap.at(synonym.second) != qpbackend::IF || expressionSpec != "_") {
                 break;
             }
             addPatternClauseUnchecked(patternType, synonym, variableName, expressionSpec);
             return;
         case qpbackend::WHILE_PATTERN:
-            if (query.declarationMap.at(synonym.second) != qpbackend::WHILE || expressionSpec != "_") {
+            if (declarationMap.at(synonym.second) != qpbackend::WHILE || expressionSpec != "_") {
                 break;
             }
             addPatternClauseUnchecked(patternType, synonym, variableName, expressionSpec);
@@ -344,7 +437,8 @@ class State {
     }
 
     void addWithClause(qpbackend::ATTR_ARG attrArg1, qpbackend::ATTR_ARG attrArg2) {
-        query.withClauses.emplace_back(attrArg1, attrArg2);
+        query().withClauses.emplace_back(attrArg1, attrArg2);
+        recordChange([](qpbackend::Query& query) { query.withClauses.pop_back(); });
     }
 
 
@@ -352,12 +446,17 @@ class State {
                                    const qpbackend::ARG& assignmentSynonym,
                                    const qpbackend::ARG& variableName,
                                    const std::string& expressionSpec) {
-        query.patternClauses.emplace_back(patternType, assignmentSynonym, variableName, expressionSpec);
+        query().patternClauses.emplace_back(patternType, assignmentSynonym, variableName, expressionSpec);
+        recordChange([](qpbackend::Query& query) { query.patternClauses.pop_back(); });
     }
 
 
     void setReturnValueToBoolean() {
-        query.returnCandidates = { { qpbackend::ReturnType::BOOLEAN, "BOOLEAN" } };
+        qpbackend::RETURN_CANDIDATE_LIST previousReturnCandidates = query().returnCandidates;
+        query().returnCandidates = { { qpbackend::ReturnType::BOOLEAN, "BOOLEAN" } };
+        recordChange([previousReturnCandidates](qpbackend::Query& query) {
+            query.returnCandidates = previousReturnCandidates;
+        });
     }
 
 
@@ -374,13 +473,13 @@ State parseSelect(State state) {
     logLine(kQppLogInfoPrefix + "parseSelect: Query state after parsing declaration*" +
             state.getQuery().toString());
     const TOKEN& selectToken = state.popUntilNonWhitespaceToken();
-    if (selectToken.type != backend::lexer::NAME || selectToken.nameValue != "Select") {
+    if (selectToken.type != backend::lexer::NAME || !state.textEquals(selectToken, "Select")) {
         // Irrecoverable syntax error, only 'Select' tokens come after declaration*. There is no
         // way to backtrack.
         throw std::runtime_error(kQppErrorPrefix +
                                  "parseSelect: Encountered "
                                  "\"" +
-                                 selectToken.nameValue +
+                                 state.text(selectToken) +
                                  "\""
                                  " while parsing, when \"Select\" is expected instead.");
     }
@@ -425,12 +524,12 @@ STATE_ENTITY_RESULT_STATUS_TRIPLE parseDesignEntity(State state) {
         return { state, qpbackend::INVALID_ENTITY_TYPE, false };
     }
 
-    if (qpbackend::isEntityString(designEntity.nameValue)) {
-        qpbackend::EntityType entityType = getEntityTypeFromToken(designEntity);
+    if (qpbackend::isEntityString(state.text(designEntity))) {
+        qpbackend::EntityType entityType = getEntityTypeFromToken(designEntity, state.text(designEntity));
         return { state, entityType, entityType != qpbackend::INVALID_ENTITY_TYPE };
     }
 
-    if (designEntity.nameValue != "prog") {
+    if (!state.textEquals(designEntity, "prog")) {
         return { state, qpbackend::INVALID_ENTITY_TYPE, false };
     }
 
@@ -442,7 +541,7 @@ STATE_ENTITY_RESULT_STATUS_TRIPLE parseDesignEntity(State state) {
         return { state, qpbackend::INVALID_ENTITY_TYPE, false };
     }
     const TOKEN& line = state.popToken();
-    if (line.type != backend::lexer::NAME || line.nameValue != "line" || !state.hasTokensLeftToParse()) {
+    if (line.type != backend::lexer::NAME || !state.textEquals(line, "line") || !state.hasTokensLeftToParse()) {
         return { state, qpbackend::INVALID_ENTITY_TYPE, false };
     }
     return { state, qpbackend::PROG_LINE, true };
@@ -465,7 +564,7 @@ STATESTATUSPAIR parseSingleDeclaration(State state) {
     state = tempState;
     TOKEN synonym = state.popUntilNonWhitespaceToken();
     TOKEN delimiter = state.popUntilNonWhitespaceToken();
-    logLine(kQppLogInfoPrefix + "parseSingleDeclaration:\n Synonym: " + synonym.nameValue +
+    logLine(kQppLogInfoPrefix + "parseSingleDeclaration:\n Synonym: " + state.text(synonym) +
             "\nDelimiter type:" + backend::lexer::prettyPrintType(delimiter.type));
     // Handles (‘,’ synonym)* ‘;’
     while (isValidDeclarationDelimiter(delimiter)) {
@@ -506,8 +605,8 @@ STATESTATUSPAIR parseResultClause(State state) {
     State backupState = state;
     // Parse terminal 'BOOLEAN'
     TOKEN returnValueToken = state.popUntilNonWhitespaceToken();
-    qpbackend::DECLARATION_MAP declarationMap = state.getQuery().declarationMap;
-    if (returnValueToken.type == backend::lexer::NAME && returnValueToken.nameValue == "BOOLEAN" &&
+    const qpbackend::DECLARATION_MAP& declarationMap = state.getQuery().declarationMap;
+    if (returnValueToken.type == backend::lexer::NAME && state.textEquals(returnValueToken, "BOOLEAN") &&
         declarationMap.find("BOOLEAN") == declarationMap.end()) {
         state.setReturnValueToBoolean();
         return { state, true };
@@ -590,7 +689,7 @@ STATE_ARGTYPE_RETURNTYPE_SYNSTRING_STATUS parseElem(State state) {
     if (synonymToken.type != backend::lexer::NAME) {
         return { state, qpbackend::INVALID_ARG, qpbackend::INVALID_RETURN_TYPE, "", false };
     }
-    qpbackend::ARG arg = state.getArgFromSynonymString(synonymToken.nameValue);
+    qpbackend::ARG arg = state.getArgFromSynonymString(state.text(synonymToken));
     return { state, arg.first, qpbackend::DEFAULT_VAL, arg.second, true };
 }
 
@@ -637,8 +736,8 @@ STATE_ARGTYPE_RETURNTYPE_SYNSTRING_STATUS parseAttrRef(State state) {
     if (!isValid) {
         return { state, qpbackend::INVALID_ARG, qpbackend::INVALID_RETURN_TYPE, "", false };
     }
-    qpbackend::ARG arg = state.getArgFromSynonymString(synonym.nameValue);
-    return { state, arg.first, returnType, synonym.nameValue, true };
+    qpbackend::ARG arg = state.getArgFromSynonymString(state.text(synonym));
+    return { state, arg.first, returnType, state.text(synonym), true };
 }
 
 /**
@@ -649,13 +748,13 @@ STATE_RETURN_TYPE_STATUS parseAttrName(State state) {
     if (token.type != backend::lexer::NAME) {
         return { state, qpbackend::INVALID_RETURN_TYPE, false };
     }
-    if (token.nameValue == "procName") {
+    if (state.textEquals(token, "procName")) {
         return { state, qpbackend::PROC_NAME, true };
-    } else if (token.nameValue == "varName") {
+    } else if (state.textEquals(token, "varName")) {
         return { state, qpbackend::VAR_NAME, true };
-    } else if (token.nameValue == "value") {
+    } else if (state.textEquals(token, "value")) {
         return { state, qpbackend::CONST_VALUE, true };
-    } else if (token.nameValue == "stmt" && state.hasTokensLeftToParse()) {
+    } else if (state.textEquals(token, "stmt") && state.hasTokensLeftToParse()) {
         TOKEN hash = state.popToken();
         if (hash.type != backend::lexer::HASH) {
             return { state, qpbackend::INVALID_RETURN_TYPE, false };
@@ -719,10 +818,10 @@ STATESTATUSPAIR chainClauseWithAnd(const SINGLE_CLAUSE_PARSER& firstClauseParser
         state = newState;
         newState.popToNextNonWhitespaceToken();
         if (!newState.hasTokensLeftToParse() || newState.peekToken().type != backend::lexer::NAME ||
-            newState.peekToken().nameValue != "and") {
+            !newState.textEquals(newState.peekToken(), "and")) {
             if (newState.hasTokensLeftToParse()) {
                 logLine(kQppLogInfoPrefix +
-                        "chainClauseWithAnd: exiting on token: " + newState.peekToken().nameValue);
+                        "chainClauseWithAnd: exiting on token: " + newState.text(newState.peekToken()));
             } else {
                 logLine(kQppLogInfoPrefix + "chainClauseWithAnd: ran out of tokens, exiting");
             };
@@ -761,7 +860,7 @@ STATE_ARG_RESULT_STATUS_TRIPLE parseIdent(State state) {
                 backend::lexer::prettyPrintType(closingDoubleQuoteToken.type));
         return STATE_ARG_RESULT_STATUS_TRIPLE(state, qpbackend::ARG(qpbackend::INVALID_ARG, ""), false);
     }
-    return STATE_ARG_RESULT_STATUS_TRIPLE(state, qpbackend::ARG(qpbackend::NAME_ENTITY, identToken.nameValue), true);
+    return STATE_ARG_RESULT_STATUS_TRIPLE(state, qpbackend::ARG(qpbackend::NAME_ENTITY, state.text(identToken)), true);
 }
 
 /**
@@ -778,7 +877,7 @@ STATE_ARGTYPE_RETURNTYPE_SYNSTRING_STATUS parseRef(State state) {
     }
     case backend::lexer::INTEGER: {
         state.popToken();
-        return { state, qpbackend::ArgType::NUM_ENTITY, qpbackend::DEFAULT_VAL, firstToken.integerValue, true };
+        return { state, qpbackend::ArgType::NUM_ENTITY, qpbackend::DEFAULT_VAL, state.text(firstToken), true };
     }
     case backend::lexer::DOUBLE_QUOTE: {
         qpbackend::ARG arg;
@@ -860,7 +959,7 @@ STATESTATUSPAIR parseSingleWithClause(State state) {
     state.popToNextNonWhitespaceToken();
     if (!state.hasTokensLeftToParse()) return STATESTATUSPAIR(state, false);
     TOKEN with = state.popUntilNonWhitespaceToken();
-    if (with.type != backend::lexer::NAME || with.nameValue != "with") {
+    if (with.type != backend::lexer::NAME || !state.textEquals(with, "with")) {
         return { state, false };
     }
     return parseAttrCompare(state);
@@ -874,11 +973,11 @@ STATESTATUSPAIR parseSingleSuchThatClause(State state) {
     state.popToNextNonWhitespaceToken();
     if (!state.hasTokensLeftToParse()) return STATESTATUSPAIR(state, false);
     TOKEN suchToken = state.popUntilNonWhitespaceToken();
-    if (suchToken.type != backend::lexer::NAME || suchToken.nameValue != "such") {
+    if (suchToken.type != backend::lexer::NAME || !state.textEquals(suchToken, "such")) {
         return STATESTATUSPAIR(state, false);
     }
     TOKEN thatToken = state.popUntilNonWhitespaceToken();
-    if (thatToken.type != backend::lexer::NAME || thatToken.nameValue != "that") {
+    if (thatToken.type != backend::lexer::NAME || !state.textEquals(thatToken, "that")) {
         return STATESTATUSPAIR(state, false);
     }
     return parseRelRef(state);
@@ -895,7 +994,7 @@ STATESTATUSPAIR parseRelRef(State state) {
     if (keywordToken.type != backend::lexer::NAME) {
         return STATESTATUSPAIR(state, false);
     }
-    stringstream << keywordToken.nameValue;
+    stringstream << state.text(keywordToken);
     // A "*" may immediately follow the keyword
     if (state.peekToken().type == backend::lexer::TokenType::MULT) {
         state.popToken();
@@ -1001,11 +1100,11 @@ STATESTATUSPAIR parseRelationStmtStmtOrLineLine(State state, qpbackend::ClauseTy
 qpbackend::ARG extractArgFromStmtRefOrLineRefToken(const TOKEN& token, State& state) {
     switch (token.type) {
     case backend::lexer::INTEGER:
-        return { qpbackend::ArgType::NUM_ENTITY, token.integerValue };
+        return { qpbackend::ArgType::NUM_ENTITY, state.text(token) };
     case backend::lexer::UNDERSCORE:
         return { qpbackend::ArgType::WILDCARD, "_" };
     case backend::lexer::NAME:
-        return state.getArgFromSynonymString(token.nameValue);
+        return state.getArgFromSynonymString(state.text(token));
     default:
         throw std::invalid_argument(kQppErrorPrefix + "extractArgFromStmtRefOrLineRefToken: A non StmtRef or LineRef token is supplied of type:" +
                                     backend::lexer::prettyPrintType(token.type));
@@ -1172,7 +1271,7 @@ STATE_ARG_RESULT_STATUS_TRIPLE parseEntRef(State state) {
     switch (firstToken.type) {
     case backend::lexer::NAME: {
         state.popToken();
-        qpbackend::ARG arg = state.getArgFromSynonymString(firstToken.nameValue);
+        qpbackend::ARG arg = state.getArgFromSynonymString(state.text(firstToken));
         return STATE_ARG_RESULT_STATUS_TRIPLE(state, arg, true);
     }
     case backend::lexer::UNDERSCORE: {
@@ -1269,7 +1368,7 @@ STATESTATUSPAIR parseIfPatternCond(State state) {
     }
 
     state.addPatternClause(qpbackend::IF_PATTERN,
-                           state.getArgFromSynonymString(synIfToken.nameValue), entRefArg, "_");
+                           state.getArgFromSynonymString(state.text(synIfToken)), entRefArg, "_");
     state.popIfCurrentTokenIsWhitespaceToken();
     logLine(kQppLogInfoPrefix + "parseSinglePatternIfClause: Success End");
     return STATESTATUSPAIR(state, true);
@@ -1320,7 +1419,7 @@ STATESTATUSPAIR parseAssignOrWhilePatternCond(State state) {
         return STATESTATUSPAIR(state, false);
     }
 
-    state.addPatternClause(clauseType, state.getArgFromSynonymString(synAssignToken.nameValue),
+    state.addPatternClause(clauseType, state.getArgFromSynonymString(state.text(synAssignToken)),
                            entRefArg, expressionSpec);
     logLine(kQppLogInfoPrefix + "parseAssignOrWhilePatternCond: Success End");
     return STATESTATUSPAIR(state, true);
@@ -1340,7 +1439,7 @@ STATESTATUSPAIR parseSinglePatternClause(State state) {
 
     TOKEN patternToken = state.popUntilNonWhitespaceToken();
     state.popIfCurrentTokenIsWhitespaceToken();
-    if (patternToken.type != backend::lexer::NAME || patternToken.nameValue != kPatternKeyword ||
+    if (patternToken.type != backend::lexer::NAME || !state.textEquals(patternToken, kPatternKeyword) ||
         !state.hasTokensLeftToParse()) {
         return STATESTATUSPAIR(state, false);
     }
@@ -1381,7 +1480,7 @@ bool isSynAssignToken(const TOKEN& token, State& state) {
         return false;
     }
     const std::unordered_map<std::string, qpbackend::EntityType>& declarationMap = state.getQuery().declarationMap;
-    auto declaration = declarationMap.find(token.nameValue);
+    auto declaration = declarationMap.find(state.text(token));
     if (declaration == declarationMap.end()) {
         return false;
     }
@@ -1415,7 +1514,7 @@ STATE_STRING_RESULT_CLAUSE_TYPE_STATUS_QUADRUPLE parseExpressionSpec(State state
     } else if (firstToken.type == backend::lexer::UNDERSCORE && secondToken.type == backend::lexer::DOUBLE_QUOTE) {
         isSubExpression = true;
     } else if (firstToken.type == backend::lexer::UNDERSCORE) {
-        qpbackend::EntityType synEntityType = state.getEntityType(synToken.nameValue);
+        qpbackend::EntityType synEntityType = state.getEntityType(state.text(synToken));
 
         if (synEntityType == qpbackend::ASSIGN) {
             return STATE_STRING_RESULT_CLAUSE_TYPE_STATUS_QUADRUPLE(state, "_", qpbackend::ASSIGN_PATTERN_WILDCARD,
@@ -1437,10 +1536,10 @@ STATE_STRING_RESULT_CLAUSE_TYPE_STATUS_QUADRUPLE parseExpressionSpec(State state
         }
         switch (currToken.type) {
         case backend::lexer::NAME:
-            expressionSpec += currToken.nameValue;
+            expressionSpec += state.text(currToken);
             break;
         case backend::lexer::INTEGER:
-            expressionSpec += currToken.integerValue;
+            expressionSpec += state.text(currToken);
             break;
         case backend::lexer::LPAREN:
             expressionSpec += '(';
@@ -1476,7 +1575,10 @@ STATE_STRING_RESULT_CLAUSE_TYPE_STATUS_QUADRUPLE parseExpressionSpec(State state
         }
     }
 
-    if (!backend::Parser::isValidExpr(expressionSpec)) {
+    // Compile the expression into its canonical form once, so that evaluating the clause does not
+    // have to parse it again for every candidate.
+    std::string canonicalExpressionSpec = backend::Parser::parseExpr(expressionSpec);
+    if (canonicalExpressionSpec.empty()) {
         return STATE_STRING_RESULT_CLAUSE_TYPE_STATUS_QUADRUPLE(state, "", qpbackend::INVALID_CLAUSE_TYPE, false);
     };
 
@@ -1497,7 +1599,7 @@ STATE_STRING_RESULT_CLAUSE_TYPE_STATUS_QUADRUPLE parseExpressionSpec(State state
     }
 
     qpbackend::ClauseType clauseType;
-    if (state.getEntityType(synToken.nameValue) != qpbackend::ASSIGN) {
+    if (state.getEntityType(state.text(synToken)) != qpbackend::ASSIGN) {
         clauseType = qpbackend::INVALID_CLAUSE_TYPE;
     } else if (isSubExpression) {
         clauseType = qpbackend::ASSIGN_PATTERN_SUB_EXPR;
@@ -1506,7 +1608,7 @@ STATE_STRING_RESULT_CLAUSE_TYPE_STATUS_QUADRUPLE parseExpressionSpec(State state
     }
 
     state.popIfCurrentTokenIsWhitespaceToken();
-    return STATE_STRING_RESULT_CLAUSE_TYPE_STATUS_QUADRUPLE(state, expressionSpec, clauseType, true);
+    return STATE_STRING_RESULT_CLAUSE_TYPE_STATUS_QUADRUPLE(state, canonicalExpressionSpec, clauseType, true);
 }
 
 // QueryPreprocessor API definitions.
@@ -1518,7 +1620,12 @@ STATE_STRING_RESULT_CLAUSE_TYPE_STATUS_QUADRUPLE parseExpressionSpec(State state
  * return an empty Query struct.
  */
 qpbackend::Query parseTokens(const TOKENS& tokens) {
-    State initialState = State(tokens);
+    return parseTokens(backend::lexer::TokenizedSource::fromTokens(tokens));
+}
+
+qpbackend::Query parseTokens(const backend::lexer::TokenizedSource& source) {
+    QueryJournal journal;
+    State initialState = State(source, journal);
     try {
         State completedState = parseSelect(initialState);
         logLine(kQppLogInfoPrefix + "parseTokens: completed parsing.\n" + completedState.getQuery().toString());
@@ -1531,4 +1638,23 @@ qpbackend::Query parseTokens(const TOKENS& tokens) {
     return qpbackend::Query();
 }
 
+qpbackend::Query ParsedQueryCache::parse(const std::string& query) {
+    backend::lexer::TokenizedSource source = backend::lexer::tokenize(backend::lexer::SourceBuffer::fromString(query));
+    // Tokens never contain spaces, so separating them with one keeps distinct token streams apart.
+    std::string normalisedQuery;
+    normalisedQuery.reserve(query.size());
+    for (size_t i = 0; i < source.size(); i++) {
+        normalisedQuery += source.text(source[i]);
+        normalisedQuery += ' ';
+    }
+
+    auto cached = queries.find(normalisedQuery);
+    if (cached != queries.end()) {
+        return cached->second;
+    }
+    qpbackend::Query parsedQuery = parseTokens(source);
+    queries.emplace(std::move(normalisedQuery), parsedQuery);
+    return parsedQuery;
+}
+
 } // namespace querypreprocessor
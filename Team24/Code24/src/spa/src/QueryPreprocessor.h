@@ -3,12 +3,14 @@
 #include "Lexer.h"
 #include "Query.h"
 
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace querypreprocessor {
 
-typedef backend::lexer::Token TOKEN;
-typedef std::vector<TOKEN> TOKENS;
+typedef backend::lexer::SourceToken TOKEN;
+typedef std::vector<backend::lexer::Token> TOKENS;
 
 /**
  * Parses tokens of a QPL query into a Query struct for easier processing.
@@ -17,5 +19,27 @@ typedef std::vector<TOKEN> TOKENS;
  * empty Query struct.
  */
 qpbackend::Query parseTokens(const TOKENS& tokens);
+qpbackend::Query parseTokens(const backend::lexer::TokenizedSource& source);
+
+/**
+ * Parses query strings, reusing the Query parsed for an earlier query with the same tokens.
+ *
+ * Queries are normalised to their tokens, so queries that only differ in whitespace share a Query.
+ */
+class ParsedQueryCache {
+  public:
+    /**
+     * @return the Query that parseTokens returns for the tokens of the query.
+     * @throws std::runtime_error if the query cannot be tokenized.
+     */
+    qpbackend::Query parse(const std::string& query);
+
+    size_t size() const {
+        return queries.size();
+    }
+
+  private:
+    std::unordered_map<std::string, qpbackend::Query> queries;
+};
 
 } // namespace querypreprocessor
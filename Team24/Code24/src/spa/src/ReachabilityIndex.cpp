@@ -0,0 +1,212 @@
+#include "ReachabilityIndex.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+
+namespace backend {
+namespace {
+const size_t WORD_BITS = 64;
+
+void setBit(std::vector<uint64_t>& bitsets, size_t word, int bit) {
+    bitsets[word + bit / WORD_BITS] |= uint64_t(1) << (bit % WORD_BITS);
+}
+
+void unionInto(std::vector<uint64_t>& bitsets, size_t to, size_t from, size_t words) {
+    for (size_t i = 0; i < words; ++i) {
+        bitsets[to + i] |= bitsets[from + i];
+    }
+}
+
+// Tarjan's algorithm, without recursion, over the nodes [first, last] of a relation.
+// @return the component of each node, numbered so that every pair between two components goes
+// from a higher-numbered one to a lower-numbered one, and the number of components.
+std::pair<std::vector<int>, int> findComponents(const CompressedRelation& relation, int first, int last) {
+    int size = last - first + 1;
+    std::vector<int> component(size, -1);
+    std::vector<int> index(size, -1);
+    std::vector<int> lowLink(size, 0);
+    std::vector<bool> onStack(size, false);
+    std::vector<int> stack;
+    // Each node being visited, with how many of its successors have been visited.
+    std::vector<std::pair<int, size_t>> visiting;
+    int nextIndex = 0;
+    int componentCount = 0;
+
+    for (int root = 0; root < size; ++root) {
+        if (index[root] != -1) {
+            continue;
+        }
+        visiting.emplace_back(root, 0);
+        index[root] = lowLink[root] = nextIndex++;
+        stack.push_back(root);
+        onStack[root] = true;
+        while (!visiting.empty()) {
+            int node = visiting.back().first;
+            CompressedRelation::Range successors = relation.get(node + first);
+            if (visiting.back().second < successors.size()) {
+                int successor = successors.begin()[visiting.back().second++] - first;
+                if (successor < 0 || successor >= size) {
+                    continue;
+                }
+                if (index[successor] == -1) {
+                    index[successor] = lowLink[successor] = nextIndex++;
+                    stack.push_back(successor);
+                    onStack[successor] = true;
+                    visiting.emplace_back(successor, 0);
+                } else if (onStack[successor]) {
+                    lowLink[node] = std::min(lowLink[node], index[successor]);
+                }
+                continue;
+            }
+            visiting.pop_back();
+            if (!visiting.empty()) {
+                int parent = visiting.back().first;
+                lowLink[parent] = std::min(lowLink[parent], lowLink[node]);
+            }
+            if (lowLink[node] == index[node]) {
+                int member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    onStack[member] = false;
+                    component[member] = componentCount;
+                } while (member != node);
+                componentCount++;
+            }
+        }
+    }
+    return { component, componentCount };
+}
+} // namespace
+
+ReachabilityIndex::ReachabilityIndex(const CompressedRelation& relation,
+                                     const std::vector<std::pair<int, int>>& regionRanges,
+                                     unsigned int threadCount) {
+    int nodeCount = static_cast<int>(relation.sourceCount());
+    for (const std::pair<int, int>& range : regionRanges) {
+        nodeCount = std::max(nodeCount, range.second + 1);
+    }
+    regionOf.assign(nodeCount, -1);
+    componentOf.assign(nodeCount, -1);
+    for (const std::pair<int, int>& range : regionRanges) {
+        if (range.first > range.second) {
+            continue;
+        }
+        Region region;
+        region.first = range.first;
+        region.last = range.second;
+        for (int node = region.first; node <= region.last; ++node) {
+            regionOf[node] = static_cast<int>(regions.size());
+        }
+        regions.push_back(std::move(region));
+    }
+
+    // Regions share no nodes, so no two threads write to the same element.
+    parallelFor(regions.size(), threadCount, [&](size_t i) { indexRegion(relation, regions[i]); });
+}
+
+void ReachabilityIndex::indexRegion(const CompressedRelation& relation, Region& region) {
+    int size = region.last - region.first + 1;
+    region.words = (size + WORD_BITS - 1) / WORD_BITS;
+
+    std::pair<std::vector<int>, int> components = findComponents(relation, region.first, region.last);
+    const std::vector<int>& component = components.first;
+    int componentCount = components.second;
+    for (int node = 0; node < size; ++node) {
+        componentOf[node + region.first] = component[node];
+    }
+
+    // The members of each component, in order of component.
+    std::vector<int> memberOffsets(componentCount + 1, 0);
+    for (int node = 0; node < size; ++node) {
+        memberOffsets[component[node] + 1]++;
+    }
+    for (int c = 0; c < componentCount; ++c) {
+        memberOffsets[c + 1] += memberOffsets[c];
+    }
+    std::vector<int> members(size);
+    std::vector<int> filled(memberOffsets.begin(), memberOffsets.end() - 1);
+    for (int node = 0; node < size; ++node) {
+        members[filled[component[node]]++] = node;
+    }
+
+    // A pair inside a component means that the component is a cycle, so that each of its
+    // members reaches, and is reached by, every member.
+    region.forward.assign(componentCount * region.words, 0);
+    region.backward.assign(componentCount * region.words, 0);
+    for (int c = 0; c < componentCount; ++c) {
+        for (int i = memberOffsets[c]; i < memberOffsets[c + 1]; ++i) {
+            for (int successor : relation.get(members[i] + region.first)) {
+                successor -= region.first;
+                if (successor < 0 || successor >= size) {
+                    continue;
+                }
+                if (component[successor] == c) {
+                    setBit(region.forward, c * region.words, successor);
+                    setBit(region.backward, c * region.words, members[i]);
+                } else {
+                    // The successor's component is lower-numbered, so it is complete.
+                    setBit(region.forward, c * region.words, successor);
+                    unionInto(region.forward, c * region.words, component[successor] * region.words, region.words);
+                }
+            }
+        }
+    }
+    // The components that reach c are higher-numbered, so c is complete when it is visited.
+    for (int c = componentCount - 1; c >= 0; --c) {
+        for (int i = memberOffsets[c]; i < memberOffsets[c + 1]; ++i) {
+            for (int successor : relation.get(members[i] + region.first)) {
+                successor -= region.first;
+                if (successor < 0 || successor >= size || component[successor] == c) {
+                    continue;
+                }
+                setBit(region.backward, component[successor] * region.words, members[i]);
+                unionInto(region.backward, component[successor] * region.words, c * region.words, region.words);
+            }
+        }
+    }
+}
+
+bool ReachabilityIndex::reaches(int source, int target) const {
+    if (source < 0 || target < 0 || static_cast<size_t>(source) >= regionOf.size() ||
+        static_cast<size_t>(target) >= regionOf.size() || regionOf[source] == -1 ||
+        regionOf[source] != regionOf[target]) {
+        return false;
+    }
+    const Region& region = regions[regionOf[source]];
+    int bit = target - region.first;
+    uint64_t word = region.forward[componentOf[source] * region.words + bit / WORD_BITS];
+    return (word >> (bit % WORD_BITS)) & 1;
+}
+
+std::vector<int> ReachabilityIndex::getReachable(int source) const {
+    if (source < 0 || static_cast<size_t>(source) >= regionOf.size() || regionOf[source] == -1) {
+        return {};
+    }
+    const Region& region = regions[regionOf[source]];
+    return getNodes(region, region.forward, source);
+}
+
+std::vector<int> ReachabilityIndex::getReaching(int target) const {
+    if (target < 0 || static_cast<size_t>(target) >= regionOf.size() || regionOf[target] == -1) {
+        return {};
+    }
+    const Region& region = regions[regionOf[target]];
+    return getNodes(region, region.backward, target);
+}
+
+std::vector<int> ReachabilityIndex::getNodes(const Region& region, const std::vector<uint64_t>& bitsets, int node) const {
+    std::vector<int> nodes;
+    size_t start = componentOf[node] * region.words;
+    for (size_t i = 0; i < region.words; ++i) {
+        uint64_t word = bitsets[start + i];
+        for (int bit = 0; word != 0; ++bit, word >>= 1) {
+            if (word & 1) {
+                nodes.push_back(region.first + static_cast<int>(i * WORD_BITS) + bit);
+            }
+        }
+    }
+    return nodes;
+}
+} // namespace backend
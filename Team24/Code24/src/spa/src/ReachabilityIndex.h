@@ -0,0 +1,57 @@
+#pragma once
+
+#include "CompressedRelation.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace backend {
+/**
+ * The transitive closure of a relation whose nodes are split into regions of consecutive numbers,
+ * with no pair between two regions, such as Next over the statements of each procedure.
+ *
+ * In each region, the strongly connected components (the while loops, for Next) are condensed,
+ * and every component gets a bitset of the nodes it reaches, and one of the nodes that reach it.
+ * The bitsets are filled in topological order of the condensed DAG. A point check is then one bit
+ * test, and the nodes reachable from a node are read off a bitset without a graph traversal.
+ */
+class ReachabilityIndex {
+  public:
+    ReachabilityIndex() = default;
+    // Each region is the range [first, last] of its nodes. Nodes that are in no region reach, and
+    // are reached by, nothing.
+    // @param threadCount The maximum number of threads that index regions, or 0 to use one per
+    // hardware thread.
+    ReachabilityIndex(const CompressedRelation& relation,
+                      const std::vector<std::pair<int, int>>& regions,
+                      unsigned int threadCount = 1);
+
+    // @return whether target can be reached from source through one or more pairs.
+    bool reaches(int source, int target) const;
+    // @return the nodes reachable from source, or that can reach target, in increasing order.
+    std::vector<int> getReachable(int source) const;
+    std::vector<int> getReaching(int target) const;
+
+  private:
+    struct Region {
+        int first{ 0 };
+        int last{ 0 };
+        // The number of 64-bit words in a bitset over the nodes of the region.
+        size_t words{ 0 };
+        // The bitsets of component c start at word c * words.
+        std::vector<uint64_t> forward;
+        std::vector<uint64_t> backward;
+    };
+
+    // Indexed by node. -1 for nodes in no region.
+    std::vector<int> regionOf;
+    // The component of each node, numbered within its region.
+    std::vector<int> componentOf;
+    std::vector<Region> regions;
+
+    // Fills the bitsets of a region, and the components of its nodes.
+    void indexRegion(const CompressedRelation& relation, Region& region);
+    std::vector<int> getNodes(const Region& region, const std::vector<uint64_t>& bitsets, int node) const;
+};
+} // namespace backend
@@ -1,6 +1,7 @@
 #include "ResultTable.h"
 
 #include <algorithm>
+#include <iterator>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -15,6 +16,7 @@ ResultTable::ResultTable(const std::string& synName, const std::unordered_set<st
     colNum = 1;
     colIndexTable[synName] = 0;
     isInitialized = true;
+    hasDuplicateRows = false;
 }
 
 void ResultTable::DeleteColumn(const std::string& synonym) {
@@ -24,6 +26,7 @@ void ResultTable::DeleteColumn(const std::string& synonym) {
     colNum--;
     int index = colIndexTable.at(synonym);
     colIndexTable.erase(synonym);
+    hasDuplicateRows = true;
 
     for (auto& vec : table) {
         vec.erase(vec.begin() + index);
@@ -36,23 +39,21 @@ void ResultTable::DeleteColumn(const std::string& synonym) {
 }
 
 void ResultTable::FlushTable() {
+    if (!hasDuplicateRows) {
+        return;
+    }
     bool non_empty = rowNum > 0;
-    std::unordered_set<std::string> seen;
+    std::unordered_set<std::vector<std::string>, StringVectorHash> seen;
     std::vector<std::vector<std::string>> newTable;
-    for (const auto& row : table) {
-        const char* const delim = "&";
-
-        std::ostringstream imploded;
-        std::copy(row.begin(), row.end(), std::ostream_iterator<std::string>(imploded, delim));
-        std::string h = imploded.str();
-        if (h.empty() || seen.find(h) != seen.end()) {
+    for (auto& row : table) {
+        if (row.empty() || !seen.insert(row).second) {
             rowNum--;
             continue;
         }
-        seen.insert(h);
-        newTable.push_back(row);
+        newTable.push_back(std::move(row));
     }
     table = std::move(newTable);
+    hasDuplicateRows = false;
 
     if (non_empty && rowNum == 0) {
         isInitialized = false;
@@ -80,6 +81,18 @@ ResultTable::ResultTable(const std::vector<std::string>& synNames,
     rowNum = listOfTuples.size();
 
     isInitialized = true;
+    hasDuplicateRows = false;
+}
+
+ResultTable::ResultTable(const std::vector<std::string>& synNames, std::vector<std::vector<std::string>>&& listOfTuples)
+: ResultTable(synNames, std::unordered_set<std::vector<std::string>, StringVectorHash>()) {
+    for (const auto& row : listOfTuples) {
+        if (row.size() != synNames.size()) {
+            handleError("The table shape does not match the table header provided");
+        }
+    }
+    table = std::move(listOfTuples);
+    rowNum = table.size();
 }
 
 bool ResultTable::isEmpty() const {
@@ -101,6 +114,7 @@ bool ResultTable::mergeTable(ResultTable&& other) {
         colIndexTable = std::move(other.colIndexTable);
         table = std::move(other.table);
         isInitialized = true;
+        hasDuplicateRows = other.hasDuplicateRows;
         return rowNum > 0;
     }
 
@@ -160,6 +174,7 @@ bool ResultTable::mergeTable(ResultTable&& other) {
     }
     table = std::move(tmpTable);
     rowNum = table.size();
+    hasDuplicateRows = hasDuplicateRows || other.hasDuplicateRows;
 
     return rowNum > 0;
 }
@@ -219,6 +234,26 @@ bool ResultTable::updateSynonymValueTupleSet(const std::vector<std::string>& syn
 
 bool ResultTable::updateSynonymValueTupleVector(const std::vector<std::string>& synonymNames,
                                                 std::vector<std::vector<std::string>>& result) const {
+    // Distinct rows stay distinct when every column is kept, so they are copied without a set.
+    std::unordered_set<std::string> uniqueNames(synonymNames.begin(), synonymNames.end());
+    if (!hasDuplicateRows && !synonymNames.empty() && (int)uniqueNames.size() == colNum &&
+        std::all_of(synonymNames.begin(), synonymNames.end(),
+                    [this](const std::string& synName) { return isSynonymContained(synName); })) {
+        std::vector<int> indices;
+        for (const auto& synName : synonymNames) {
+            indices.push_back(colIndexTable.at(synName));
+        }
+        result.clear();
+        result.reserve(table.size());
+        for (const auto& row : table) {
+            result.emplace_back();
+            for (int idx : indices) {
+                result.back().push_back(row[idx]);
+            }
+        }
+        return true;
+    }
+
     std::unordered_set<std::vector<std::string>, StringVectorHash> setResult;
     if (updateSynonymValueTupleSet(synonymNames, setResult)) {
         result.clear();
@@ -43,11 +43,15 @@ struct CompareStrVec {
  */
 class ResultTable {
   public:
-    ResultTable() : colNum(0), rowNum(0), isInitialized(false) {
+    ResultTable() : colNum(0), rowNum(0), isInitialized(false), hasDuplicateRows(false) {
     }
     ResultTable(const std::string& synName, const std::unordered_set<std::string>& vals);
     ResultTable(const std::vector<std::string>& synNames,
                 const std::unordered_set<std::vector<std::string>, StringVectorHash>& listOfTuples);
+    /**
+     * @param listOfTuples : tuples that are known to be distinct, moved into the table as its rows
+     */
+    ResultTable(const std::vector<std::string>& synNames, std::vector<std::vector<std::string>>&& listOfTuples);
 
     bool isEmpty() const;
 
@@ -96,6 +100,7 @@ class ResultTable {
     int colNum;
     int rowNum;
     bool isInitialized;
+    bool hasDuplicateRows; // rows can only repeat after a column is deleted, until the table is flushed
     std::unordered_map<std::string, int> colIndexTable; // table to store mapping between table and column index
     std::vector<std::vector<std::string>> table; // the main table
 
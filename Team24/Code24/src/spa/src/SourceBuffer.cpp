@@ -0,0 +1,69 @@
+#include "SourceBuffer.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace backend {
+namespace lexer {
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromFile(const std::string& filename) {
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("SourceBuffer: Unable to open file: " + filename);
+    }
+    struct stat fileStat;
+    // Only regular, non-empty files can be mapped. Anything else is read instead.
+    if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0) {
+        size_t size = static_cast<size_t>(fileStat.st_size);
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            close(fd);
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            std::shared_ptr<SourceBuffer> buffer(new SourceBuffer());
+            buffer->mapping = mapping;
+            buffer->begin = static_cast<const char*>(mapping);
+            buffer->length = size;
+            return buffer;
+        }
+    }
+    close(fd);
+#endif
+    std::ifstream stream(filename, std::ios::binary);
+    if (!stream.is_open()) {
+        throw std::runtime_error("SourceBuffer: Unable to open file: " + filename);
+    }
+    return fromStream(stream);
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromStream(std::istream& stream) {
+    return fromString(std::string((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>()));
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromString(std::string text) {
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer());
+    buffer->ownedText = std::move(text);
+    buffer->begin = buffer->ownedText.data();
+    buffer->length = buffer->ownedText.size();
+    return buffer;
+}
+
+SourceBuffer::~SourceBuffer() {
+#ifndef _WIN32
+    if (mapping != nullptr) {
+        munmap(mapping, length);
+    }
+#endif
+}
+
+} // namespace lexer
+} // namespace backend
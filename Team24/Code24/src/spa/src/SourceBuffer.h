@@ -0,0 +1,47 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace backend {
+namespace lexer {
+/**
+ * Read-only, contiguous view of a whole source text.
+ *
+ * Files are memory mapped where the platform allows it, so lexing a SIMPLE program does not copy
+ * the file into the heap. Tokens refer to their text by offset into this buffer.
+ */
+class SourceBuffer {
+  public:
+    /**
+     * Maps the file into memory, falling back to reading it when it cannot be mapped.
+     * @throws std::runtime_error if the file cannot be opened.
+     */
+    static std::shared_ptr<const SourceBuffer> fromFile(const std::string& filename);
+    static std::shared_ptr<const SourceBuffer> fromStream(std::istream& stream);
+    static std::shared_ptr<const SourceBuffer> fromString(std::string text);
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    ~SourceBuffer();
+
+    const char* data() const {
+        return begin;
+    }
+    size_t size() const {
+        return length;
+    }
+
+  private:
+    SourceBuffer() = default;
+
+    const char* begin{ nullptr };
+    size_t length{ 0 };
+    // Set only when the buffer is memory mapped.
+    void* mapping{ nullptr };
+    // Holds the text when the buffer is not memory mapped.
+    std::string ownedText;
+};
+} // namespace lexer
+} // namespace backend
@@ -0,0 +1,266 @@
+#include "SsaForm.h"
+
+#include <utility>
+
+namespace backend {
+namespace {
+const int NO_BLOCK = -1;
+
+// @return the immediate dominator of every block. The first block of a procedure, and any block
+// that it does not reach, is its own immediate dominator.
+std::vector<int> getImmediateDominators(const ProgramIR& program, const ControlFlowGraph& cfg) {
+    const int blockCount = cfg.getBlockCount();
+    const std::vector<int>& order = cfg.getReversePostorder();
+    std::vector<int> positionOf(blockCount);
+    for (int position = 0; position < blockCount; ++position) {
+        positionOf[order[position]] = position;
+    }
+
+    std::vector<int> dominator(blockCount, NO_BLOCK);
+    for (const ProcedureIR& procedure : program.getProcedures()) {
+        if (procedure.firstStatement != 0) {
+            int entry = cfg.getBlock(procedure.firstStatement);
+            dominator[entry] = entry;
+        }
+    }
+    auto intersect = [&](int first, int second) {
+        while (first != second) {
+            while (positionOf[first] > positionOf[second]) {
+                first = dominator[first];
+            }
+            while (positionOf[second] > positionOf[first]) {
+                second = dominator[second];
+            }
+        }
+        return first;
+    };
+
+    bool isChanged = true;
+    while (isChanged) {
+        isChanged = false;
+        for (int block : order) {
+            if (dominator[block] == block) {
+                continue;
+            }
+            int newDominator = NO_BLOCK;
+            for (int predecessor : cfg.getPredecessors().get(block)) {
+                if (dominator[predecessor] == NO_BLOCK) {
+                    continue;
+                }
+                newDominator = newDominator == NO_BLOCK ? predecessor : intersect(predecessor, newDominator);
+            }
+            if (newDominator == NO_BLOCK) {
+                // No path from the start of its procedure reaches the block.
+                newDominator = block;
+            }
+            if (dominator[block] != newDominator) {
+                dominator[block] = newDominator;
+                isChanged = true;
+            }
+        }
+    }
+    return dominator;
+}
+
+// @return the dominance frontier of every block: the blocks where the blocks that it dominates
+// join the rest of the procedure.
+CompressedRelation getDominanceFrontiers(const ControlFlowGraph& cfg, const std::vector<int>& dominator) {
+    std::vector<std::pair<int, int>> edges;
+    for (int block = 0; block < cfg.getBlockCount(); ++block) {
+        CompressedRelation::Range predecessors = cfg.getPredecessors().get(block);
+        // The first block of a procedure is also entered from the start of the procedure, which
+        // dominates every block of the procedure, so a loop back to it is a join.
+        bool isEntry = dominator[block] == block;
+        if (predecessors.size() + (isEntry ? 1 : 0) < 2) {
+            continue;
+        }
+        for (int runner : predecessors) {
+            while (isEntry || runner != dominator[block]) {
+                edges.emplace_back(runner, block);
+                if (dominator[runner] == runner) {
+                    break;
+                }
+                runner = dominator[runner];
+            }
+        }
+    }
+    return CompressedRelation::fromEdges(std::move(edges));
+}
+
+bool isDefinition(TNodeType type) {
+    return type == Assign || type == Read || type == Call;
+}
+} // namespace
+
+SsaForm::SsaForm(const ProgramIR& program, const ControlFlowGraph& cfg) {
+    const int blockCount = cfg.getBlockCount();
+    const int variableCount = program.getVariableCount();
+    values.push_back({ EntryValue, 0 });
+    phiOperands.emplace_back();
+
+    std::vector<int> dominator = getImmediateDominators(program, cfg);
+    CompressedRelation frontiers = getDominanceFrontiers(cfg, dominator);
+
+    // The blocks in which each variable is defined.
+    std::vector<std::pair<int, int>> definitionEdges;
+    for (int block = 0; block < blockCount; ++block) {
+        for (STATEMENT_NUMBER statement : cfg.getStatements(block)) {
+            if (isDefinition(program.getStatement(statement).type)) {
+                for (VARIABLE_ID variable : program.getModifiedVariables(statement)) {
+                    definitionEdges.emplace_back(variable, block);
+                }
+            }
+        }
+    }
+    CompressedRelation definitionBlocks = CompressedRelation::fromEdges(std::move(definitionEdges));
+
+    // A variable gets a phi on the iterated dominance frontier of the blocks that define it.
+    std::vector<std::vector<std::pair<VARIABLE_ID, int>>> blockPhis(blockCount);
+    std::vector<VARIABLE_ID> hasPhi(blockCount, NO_VARIABLE);
+    std::vector<VARIABLE_ID> isQueued(blockCount, NO_VARIABLE);
+    std::vector<int> worklist;
+    for (VARIABLE_ID variable = 0; variable < variableCount; ++variable) {
+        for (int block : definitionBlocks.get(variable)) {
+            isQueued[block] = variable;
+            worklist.push_back(block);
+        }
+        while (!worklist.empty()) {
+            int block = worklist.back();
+            worklist.pop_back();
+            for (int frontier : frontiers.get(block)) {
+                if (hasPhi[frontier] == variable) {
+                    continue;
+                }
+                hasPhi[frontier] = variable;
+                blockPhis[frontier].emplace_back(variable, static_cast<int>(values.size()));
+                values.push_back({ PhiValue, 0 });
+                phiOperands.emplace_back();
+                if (isQueued[frontier] != variable) {
+                    isQueued[frontier] = variable;
+                    worklist.push_back(frontier);
+                }
+            }
+        }
+    }
+
+    // Name the values with a walk of the dominator tree, without recursion. The current value of
+    // each variable is at the top of its stack, and `pushed` records the variables whose stacks
+    // were pushed, so that they can be popped when the walk leaves a block.
+    std::vector<std::pair<int, int>> treeEdges;
+    std::vector<int> roots;
+    for (int block = 0; block < blockCount; ++block) {
+        if (dominator[block] == block) {
+            roots.push_back(block);
+        } else {
+            treeEdges.emplace_back(dominator[block], block);
+        }
+    }
+    CompressedRelation dominatorTree = CompressedRelation::fromEdges(std::move(treeEdges));
+    std::vector<std::vector<int>> currentValues(variableCount);
+    auto getCurrentValue = [&currentValues](VARIABLE_ID variable) {
+        return currentValues[variable].empty() ? 0 : currentValues[variable].back();
+    };
+    std::vector<VARIABLE_ID> pushed;
+    // Each block being visited, with the size of `pushed` when the walk entered it, or -1 if the
+    // walk has not entered it yet.
+    std::vector<std::pair<int, int>> visiting;
+    for (int root : roots) {
+        visiting.emplace_back(root, -1);
+        while (!visiting.empty()) {
+            int block = visiting.back().first;
+            if (visiting.back().second != -1) {
+                for (size_t i = visiting.back().second; i < pushed.size(); ++i) {
+                    currentValues[pushed[i]].pop_back();
+                }
+                pushed.resize(visiting.back().second);
+                visiting.pop_back();
+                continue;
+            }
+            visiting.back().second = static_cast<int>(pushed.size());
+
+            for (const std::pair<VARIABLE_ID, int>& phi : blockPhis[block]) {
+                currentValues[phi.first].push_back(phi.second);
+                pushed.push_back(phi.first);
+            }
+            for (STATEMENT_NUMBER statement : cfg.getStatements(block)) {
+                TNodeType type = program.getStatement(statement).type;
+                if (type == Assign) {
+                    for (VARIABLE_ID variable : program.getUsedVariables(statement)) {
+                        uses.push_back({ statement, getCurrentValue(variable) });
+                    }
+                }
+                if (!isDefinition(type)) {
+                    continue;
+                }
+                for (VARIABLE_ID variable : program.getModifiedVariables(statement)) {
+                    currentValues[variable].push_back(static_cast<int>(values.size()));
+                    pushed.push_back(variable);
+                    values.push_back({ type == Assign ? AssignValue : KillValue, statement });
+                    phiOperands.emplace_back();
+                }
+            }
+            for (int successor : cfg.getSuccessors().get(block)) {
+                for (const std::pair<VARIABLE_ID, int>& phi : blockPhis[successor]) {
+                    phiOperands[phi.second].push_back(getCurrentValue(phi.first));
+                }
+            }
+            for (int child : dominatorTree.get(block)) {
+                visiting.emplace_back(child, -1);
+            }
+        }
+    }
+}
+
+std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> SsaForm::getAffectsMapping() const {
+    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> affectsMapping;
+    // The assignments that define each value that is used, through phis. A value is searched once
+    // however many assignments use it.
+    std::unordered_map<int, std::vector<STATEMENT_NUMBER>> definitionsOf;
+    // The value whose search last reached each value.
+    std::vector<int> visitedBy(values.size(), -1);
+    std::vector<int> toVisit;
+    for (const Use& use : uses) {
+        auto inserted = definitionsOf.emplace(use.value, std::vector<STATEMENT_NUMBER>());
+        std::vector<STATEMENT_NUMBER>& definitions = inserted.first->second;
+        if (inserted.second) {
+            toVisit.push_back(use.value);
+            while (!toVisit.empty()) {
+                int value = toVisit.back();
+                toVisit.pop_back();
+                if (visitedBy[value] == use.value) {
+                    continue;
+                }
+                visitedBy[value] = use.value;
+                if (values[value].kind == AssignValue) {
+                    definitions.push_back(values[value].statement);
+                } else if (values[value].kind == PhiValue) {
+                    toVisit.insert(toVisit.end(), phiOperands[value].begin(), phiOperands[value].end());
+                }
+            }
+        }
+        for (STATEMENT_NUMBER definition : definitions) {
+            affectsMapping[definition].insert(use.statement);
+        }
+    }
+    return affectsMapping;
+}
+
+size_t SsaForm::getPhiCount() const {
+    size_t phiCount = 0;
+    for (const Value& value : values) {
+        if (value.kind == PhiValue) {
+            phiCount++;
+        }
+    }
+    return phiCount;
+}
+
+size_t SsaForm::getSizeInBytes() const {
+    size_t bytes = values.capacity() * sizeof(Value) + uses.capacity() * sizeof(Use) +
+                   phiOperands.capacity() * sizeof(std::vector<int>);
+    for (const std::vector<int>& operands : phiOperands) {
+        bytes += operands.capacity() * sizeof(int);
+    }
+    return bytes;
+}
+} // namespace backend
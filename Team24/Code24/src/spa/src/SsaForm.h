@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CompressedRelation.h"
+#include "ControlFlowGraph.h"
+#include "PKB.h"
+#include "ProgramIR.h"
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace backend {
+/**
+ * A program in static single assignment form. Every assignment, read and call defines a new value
+ * of each variable that it modifies, and a phi value merges the values of a variable where control
+ * flow joins, after if statements and at while statements. Each use of a variable by an assignment
+ * refers to the one value that reaches it.
+ *
+ * The phis are placed on the iterated dominance frontiers of the definitions, with the dominator
+ * tree computed by the iterative algorithm of Cooper, Harvey and Kennedy. Values are then named by
+ * a walk of the dominator tree.
+ */
+class SsaForm {
+  public:
+    SsaForm(const ProgramIR& program, const ControlFlowGraph& cfg);
+
+    /**
+     * Affects(a1, a2) holds if a2 uses a value that is defined by a1, either directly or through
+     * phis. Values defined by reads and calls, or that a procedure starts with, affect nothing.
+     * @return the same mapping as extractor::getAffectsMapping.
+     */
+    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> getAffectsMapping() const;
+
+    // @return the number of values, including phis, and the bytes that the form takes.
+    size_t getValueCount() const {
+        return values.size();
+    }
+    size_t getPhiCount() const;
+    size_t getSizeInBytes() const;
+
+  private:
+    enum ValueKind { EntryValue, AssignValue, KillValue, PhiValue };
+    struct Value {
+        ValueKind kind;
+        // The statement that defines the value, or 0 for phis and the entry value.
+        STATEMENT_NUMBER statement;
+    };
+    // A use of a variable by an assignment.
+    struct Use {
+        STATEMENT_NUMBER statement;
+        int value;
+    };
+
+    // Value 0 is the value of every variable at the start of a procedure.
+    std::vector<Value> values;
+    // The values merged by each phi, indexed by value. Empty for other values.
+    std::vector<std::vector<int>> phiOperands;
+    std::vector<Use> uses;
+};
+} // namespace backend
@@ -2,7 +2,6 @@
 
 #include "Logger.h"
 
-#include <set>
 #include <sstream>
 
 namespace backend {
@@ -101,58 +100,112 @@ std::string getOperatorStringFromTNodeType(TNodeType t) {
     };
 }
 
-std::string TNode::toString() const {
-    return toStringHelper(0);
+TNode::TNode(const TNode& other) {
+    copyFieldsFrom(other);
+    std::vector<std::pair<const TNode*, TNode*>> toCopy = { { &other, this } };
+    while (!toCopy.empty()) {
+        const TNode* source = toCopy.back().first;
+        TNode* copy = toCopy.back().second;
+        toCopy.pop_back();
+        // Reserve first, so that the children do not move while their own children are copied.
+        copy->children.reserve(source->children.size());
+        for (const TNode& sourceChild : source->children) {
+            copy->children.emplace_back();
+            copy->children.back().copyFieldsFrom(sourceChild);
+            toCopy.emplace_back(&sourceChild, &copy->children.back());
+        }
+    }
 }
 
-std::string TNode::toShortString() const {
-    std::string typeString = getTNodeTypeString(type);
-    std::ostringstream stringStream;
-    stringStream << typeString << " " << name;
-    stringStream << " @ " << line;
-    return stringStream.str();
+TNode& TNode::operator=(const TNode& other) {
+    if (this != &other) {
+        *this = TNode(other);
+    }
+    return *this;
 }
 
-std::string TNode::toStringHelper(int tabs) const {
-    std::string nodeName = getTNodeTypeString(type);
-    std::ostringstream stringStream;
+TNode::~TNode() {
+    // Take the descendants out of the tree one at a time, so that each TNode is destroyed with no
+    // children.
+    std::vector<TNode> toDestroy = std::move(children);
+    while (!toDestroy.empty()) {
+        TNode node = std::move(toDestroy.back());
+        toDestroy.pop_back();
+        for (TNode& child : node.children) {
+            toDestroy.push_back(std::move(child));
+        }
+        node.children.clear();
+    }
+}
+
+void TNode::copyFieldsFrom(const TNode& other) {
+    type = other.type;
+    hashInteger = other.hashInteger;
+    line = other.line;
+    name = other.name;
+    constant = other.constant;
+    isProcedureVar = other.isProcedureVar;
+}
 
-    for (int i = 0; i < tabs; ++i)
-        stringStream << " ";
-    stringStream << nodeName;
-    stringStream << " @ " << line << "(" << name << ", " << constant << ")";
-    stringStream << " : [\n";
+std::string TNode::toString() const {
+    std::ostringstream stringStream;
+    // Each TNode is visited twice: once to print its opening line and children, then to close it.
+    std::vector<std::pair<const TNode*, bool>> toVisit = { { this, false } };
+    int tabs = 0;
+    while (!toVisit.empty()) {
+        const TNode* node = toVisit.back().first;
+        bool isClosing = toVisit.back().second;
+        toVisit.pop_back();
+        if (isClosing) {
+            tabs--;
+            stringStream << std::string(tabs, ' ') << "]\n";
+            continue;
+        }
 
-    for (const auto& child : children) {
-        stringStream << child.toStringHelper(tabs + 1);
+        stringStream << std::string(tabs, ' ') << getTNodeTypeString(node->type);
+        stringStream << " @ " << node->line << "(" << node->name << ", " << node->constant << ")";
+        stringStream << " : [\n";
+        tabs++;
+        toVisit.emplace_back(node, true);
+        for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+            toVisit.emplace_back(&*it, false);
+        }
     }
+    return stringStream.str();
+}
 
-    for (int i = 0; i < tabs; ++i)
-        stringStream << " ";
-    stringStream << "]\n";
+std::string TNode::toShortString() const {
+    std::string typeString = getTNodeTypeString(type);
+    std::ostringstream stringStream;
+    stringStream << typeString << " " << name;
+    stringStream << " @ " << line;
     return stringStream.str();
 }
 
 bool TNode::operator==(const TNode& rhs) const {
-    if (type != rhs.type || line != rhs.line || name != rhs.name || constant != rhs.constant) {
-        // Helpful to resolve test.
-        logLine("type not equal: " + getTNodeTypeString(type) + " : " + getTNodeTypeString(rhs.type),
-                type != rhs.type);
-        logLine("type line not equal: " + std::to_string(line) + " : " + std::to_string(rhs.line),
-                line != rhs.line);
-        logLine("name not equal: " + name + " : " + rhs.name, name != rhs.name);
-        logLine("constant not equal: " + constant + " : " + rhs.constant, constant != rhs.constant);
-        logLine();
-        return false;
-    }
-    if (children.size() != rhs.children.size()) {
-        return false;
-    }
-    for (int i = 0; i < children.size(); ++i) {
-        if (children[i] == rhs.children[i]) {
-            continue;
+    std::vector<std::pair<const TNode*, const TNode*>> toCompare = { { this, &rhs } };
+    while (!toCompare.empty()) {
+        const TNode& left = *toCompare.back().first;
+        const TNode& right = *toCompare.back().second;
+        toCompare.pop_back();
+        if (left.type != right.type || left.line != right.line || left.name != right.name ||
+            left.constant != right.constant) {
+            // Helpful to resolve test.
+            logLine("type not equal: " + getTNodeTypeString(left.type) + " : " + getTNodeTypeString(right.type),
+                    left.type != right.type);
+            logLine("type line not equal: " + std::to_string(left.line) + " : " + std::to_string(right.line),
+                    left.line != right.line);
+            logLine("name not equal: " + left.name + " : " + right.name, left.name != right.name);
+            logLine("constant not equal: " + left.constant + " : " + right.constant, left.constant != right.constant);
+            logLine();
+            return false;
+        }
+        if (left.children.size() != right.children.size()) {
+            return false;
+        }
+        for (size_t i = left.children.size(); i-- > 0;) {
+            toCompare.emplace_back(&left.children[i], &right.children[i]);
         }
-        return false;
     }
     return true;
 }
@@ -161,18 +214,27 @@ void TNode::addChild(const TNode& c) {
     children.emplace_back(c);
 }
 
+void TNode::addChild(TNode&& c) {
+    children.emplace_back(std::move(c));
+}
+
 bool TNode::isStatementNode() const {
-    std::set<TNodeType> statementTypes{
-        TNodeType::Assign, TNodeType::Call, TNodeType::IfElse,
-        TNodeType::Print,  TNodeType::Read, TNodeType::While,
-    };
-    return statementTypes.count(type);
+    switch (type) {
+    case TNodeType::Assign:
+    case TNodeType::Call:
+    case TNodeType::IfElse:
+    case TNodeType::Print:
+    case TNodeType::Read:
+    case TNodeType::While:
+        return true;
+    default:
+        return false;
+    }
 }
 
-int TNode::uniqueIdentifier = 0;
+std::atomic<int> TNode::uniqueIdentifier(0);
 int TNode::getNewUniqueIdentifier() {
-    TNode::uniqueIdentifier += 1;
-    return TNode::uniqueIdentifier;
+    return ++TNode::uniqueIdentifier;
 }
 
 std::ostream& operator<<(std::ostream& os, const TNode& t) {
@@ -182,27 +244,38 @@ std::ostream& operator<<(std::ostream& os, const TNode& t) {
 
 // Precondition: tNode is an operator (+, -, *, /, %) or a const/var.
 std::string getExprString(const TNode& tNode) {
-    if (tNode.children.size() == 0) {
-        // By validity of AST, if `visiting` is leaf node, it must be a const or a var.
-        if (tNode.type == Constant) {
-            return tNode.constant;
-        } else if (tNode.type == TNodeType::Variable) {
-            return tNode.name;
+    std::string result;
+    // Each operator is visited twice: once to open its bracket and print its lhs, then to print its
+    // operator and rhs and close the bracket.
+    std::vector<std::pair<const TNode*, bool>> toVisit = { { &tNode, false } };
+    while (!toVisit.empty()) {
+        const TNode* visiting = toVisit.back().first;
+        bool isLhsDone = toVisit.back().second;
+        toVisit.pop_back();
+        if (visiting == nullptr) {
+            result += ')';
+        } else if (isLhsDone) {
+            result += getOperatorStringFromTNodeType(visiting->type);
+            toVisit.emplace_back(nullptr, false);
+            toVisit.emplace_back(&visiting->children.at(1), false);
+        } else if (visiting->children.size() == 0) {
+            // By validity of AST, if `visiting` is leaf node, it must be a const or a var.
+            if (visiting->type == Constant) {
+                result += visiting->constant;
+            } else if (visiting->type == TNodeType::Variable) {
+                result += visiting->name;
+            } else {
+                throw std::runtime_error(
+                "getExprString: leaf node should only be a constant or a variable. Got: " +
+                getTNodeTypeString(visiting->type));
+            }
         } else {
-            throw std::runtime_error(
-            "getExprString: leaf node should only be a constant or a variable. Got: " +
-            getTNodeTypeString(tNode.type));
+            // there should be 2 children for any operator.
+            result += '(';
+            toVisit.emplace_back(visiting, true);
+            toVisit.emplace_back(&visiting->children.at(0), false);
         }
     }
-    // there should be 2 children for any operator.
-    const TNode& lhs = tNode.children.at(0);
-    const TNode& rhs = tNode.children.at(1);
-
-    std::string lhsString = getExprString(lhs);
-    std::string rhsString = getExprString(rhs);
-    std::string opString = getOperatorStringFromTNodeType(tNode.type);
-
-    std::string result = "(" + lhsString + opString + rhsString + ")";
     return result;
 }
 } // namespace backend
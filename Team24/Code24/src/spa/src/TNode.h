@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <sstream>
 #include <string>
@@ -62,6 +63,12 @@ class TNode {
     // Some TNode don't need line number.
     explicit TNode(TNodeType type, int line = 0) : type(type), line(line) {
     }
+    // Copying and destroying use an explicit stack, so that a deep AST cannot overflow the call stack.
+    TNode(const TNode& other);
+    TNode(TNode&& other) = default;
+    TNode& operator=(const TNode& other);
+    TNode& operator=(TNode&& other) = default;
+    ~TNode();
 
     TNodeType type{ TNodeType::INVALID };
     std::vector<TNode> children;
@@ -72,6 +79,7 @@ class TNode {
     std::string name;
 
     void addChild(const TNode& c);
+    void addChild(TNode&& c);
     std::string toString() const;
     std::string toShortString() const;
     bool operator==(const TNode& s) const;
@@ -84,10 +92,12 @@ class TNode {
     friend std::ostream& operator<<(std::ostream& os, const backend::TNode& t);
 
   private:
-    // Used to generate a Unique ID for a new AST. Used for hashing.
-    static int uniqueIdentifier;
+    // Used to generate a Unique ID for a new AST. Used for hashing. Atomic, as procedures can be
+    // parsed on several threads.
+    static std::atomic<int> uniqueIdentifier;
     static int getNewUniqueIdentifier();
-    std::string toStringHelper(int tabs) const;
+    // Copies every field except the children.
+    void copyFieldsFrom(const TNode& other);
 };
 
 std::string getTNodeTypeString(TNodeType t);
@@ -96,7 +106,7 @@ std::string getExprString(const TNode& tNode);
 } // namespace backend
 
 namespace std {
-template <> struct std::hash<backend::TNode> {
+template <> struct hash<backend::TNode> {
     std::size_t operator()(backend::TNode const& tNode) const noexcept {
         return std::hash<long long>{}(tNode.hashInteger);
     }
@@ -0,0 +1,126 @@
+#include "CompressedRelation.h"
+#include "catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace backend {
+namespace testcompressedrelation {
+
+std::vector<int> toVector(CompressedRelation::Range range) {
+    return { range.begin(), range.end() };
+}
+
+TEST_CASE("Test CompressedRelation stores sorted targets per source") {
+    CompressedRelation relation = CompressedRelation::fromEdges({ { 3, 1 }, { 1, 4 }, { 1, 2 }, { 3, 1 }, { 5, 5 } });
+
+    REQUIRE(toVector(relation.get(1)) == std::vector<int>{ 2, 4 });
+    REQUIRE(toVector(relation.get(3)) == std::vector<int>{ 1 });
+    REQUIRE(toVector(relation.get(5)) == std::vector<int>{ 5 });
+    REQUIRE(relation.get(0).empty());
+    REQUIRE(relation.get(2).empty());
+    REQUIRE(relation.get(6).empty());
+    REQUIRE(relation.get(-1).empty());
+    REQUIRE(relation.edgeCount() == 4);
+    REQUIRE(relation.getSources() == std::vector<int>{ 1, 3, 5 });
+
+    REQUIRE(relation.contains(1, 4));
+    REQUIRE_FALSE(relation.contains(1, 3));
+    REQUIRE_FALSE(relation.contains(100, 1));
+
+    CompressedRelation reversed = relation.reversed();
+    REQUIRE(toVector(reversed.get(1)) == std::vector<int>{ 3 });
+    REQUIRE(toVector(reversed.get(2)) == std::vector<int>{ 1 });
+    REQUIRE(toVector(reversed.get(5)) == std::vector<int>{ 5 });
+}
+
+TEST_CASE("Test CompressedRelation getReachable") {
+    // 1 -> 2 -> 3 -> 2, 3 -> 4
+    CompressedRelation relation = CompressedRelation::fromMap(
+    std::unordered_map<int, std::unordered_set<int>>{ { 1, { 2 } }, { 2, { 3 } }, { 3, { 2, 4 } } });
+
+    std::vector<int> reachable = relation.getReachable(1);
+    std::sort(reachable.begin(), reachable.end());
+    REQUIRE(reachable == std::vector<int>{ 2, 3, 4 });
+
+    reachable = relation.getReachable(3);
+    std::sort(reachable.begin(), reachable.end());
+    REQUIRE(reachable == std::vector<int>{ 2, 3, 4 });
+
+    REQUIRE(relation.getReachable(4).empty());
+}
+
+// A chain 1 -> 2 -> ... -> size, with loops back from every tenth node.
+CompressedRelation generateLoopedChain(int size) {
+    std::vector<std::pair<int, int>> edges;
+    for (int node = 1; node < size; ++node) {
+        edges.emplace_back(node, node + 1);
+        if (node % 10 == 0) {
+            edges.emplace_back(node, node - 7);
+        }
+    }
+    return CompressedRelation::fromEdges(edges);
+}
+
+TEST_CASE("Test CompressedRelation getReachablePairs agrees with getReachable") {
+    // More than 64 sources, so that the sources are searched in several batches.
+    CompressedRelation relation = generateLoopedChain(150);
+    std::vector<int> sources;
+    for (int node = 150; node >= -1; node -= 2) {
+        sources.push_back(node);
+    }
+    std::vector<int> targets;
+    for (int node = 0; node <= 152; node += 3) {
+        targets.push_back(node);
+    }
+
+    std::vector<std::pair<int, int>> expected;
+    for (int source : sources) {
+        for (int target : relation.getReachable(source)) {
+            if (std::find(targets.begin(), targets.end(), target) != targets.end()) {
+                expected.emplace_back(source, target);
+            }
+        }
+    }
+    std::vector<std::pair<int, int>> pairs = relation.getReachablePairs(sources, targets);
+    std::sort(expected.begin(), expected.end());
+    std::sort(pairs.begin(), pairs.end());
+    REQUIRE_FALSE(pairs.empty());
+    REQUIRE(pairs == expected);
+
+    REQUIRE(relation.getReachablePairs({ 10 }, { 3, 10 }) == std::vector<std::pair<int, int>>{ { 10, 3 }, { 10, 10 } });
+    REQUIRE(relation.getReachablePairs({ 150 }, { 149 }).empty());
+    REQUIRE(relation.getReachablePairs({}, { 4 }).empty());
+}
+
+TEST_CASE("CompressedRelation getReachablePairs against a search per source", "[.benchmark]") {
+    for (int size = 1000; size <= 16000; size *= 2) {
+        CompressedRelation relation = generateLoopedChain(size);
+        std::vector<int> nodes;
+        for (int node = 1; node <= size; ++node) {
+            nodes.push_back(node);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        size_t pairCount = 0;
+        std::vector<bool> isTarget(size + 1, true);
+        for (int source : nodes) {
+            for (int target : relation.getReachable(source)) {
+                pairCount += isTarget[target] ? 1 : 0;
+            }
+        }
+        std::chrono::duration<double, std::milli> perSource = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        size_t batchedCount = relation.getReachablePairs(nodes, nodes).size();
+        std::chrono::duration<double, std::milli> batched = std::chrono::steady_clock::now() - start;
+        std::cout << size << " nodes, " << pairCount << " pairs: search per source " << perSource.count()
+                  << " ms, batched " << batched.count() << " ms (" << batchedCount << " pairs)\n";
+    }
+}
+
+} // namespace testcompressedrelation
+} // namespace backend
@@ -0,0 +1,98 @@
+#include "CompressedRelation.h"
+#include "ControlFlowGraph.h"
+#include "DesignExtractor.h"
+#include "TestParserHelpers.h"
+#include "catch.hpp"
+
+#include <vector>
+
+namespace backend {
+namespace testcontrolflowgraph {
+
+std::vector<int> toVector(CompressedRelation::Range range) {
+    return { range.begin(), range.end() };
+}
+
+ControlFlowGraph buildControlFlowGraph(const char* program) {
+    TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+    extractor::DesignTables tables = extractor::extractDesign(ast);
+    CompressedRelation next = CompressedRelation::fromMap(
+    extractor::getNextRelationship(tables.tNodeTypeToTNodes, tables.tNodeToStatementNumber));
+    return ControlFlowGraph(tables.program, next, next.reversed());
+}
+
+TEST_CASE("Test ControlFlowGraph splits statements into basic blocks") {
+    ControlFlowGraph cfg = buildControlFlowGraph("procedure a {"
+                                                 "x = 1;" // 1
+                                                 "y = 2;" // 2
+                                                 "while (x < y) {" // 3
+                                                 "  x = x + 1;" // 4
+                                                 "  if (x == 2) then {" // 5
+                                                 "    y = 1;" // 6
+                                                 "  } else {"
+                                                 "    y = 2;" // 7
+                                                 "    z = 3;" // 8
+                                                 "  }"
+                                                 "}"
+                                                 "print y;" // 9
+                                                 "}"
+                                                 "procedure b {"
+                                                 "while (z > 0) {" // 10
+                                                 "  z = z - 1;" // 11
+                                                 "}"
+                                                 "}");
+
+    REQUIRE(cfg.getBlockCount() == 7);
+    REQUIRE(toVector(cfg.getStatements(0)) == std::vector<int>{ 1, 2 });
+    REQUIRE(toVector(cfg.getStatements(1)) == std::vector<int>{ 3 });
+    REQUIRE(toVector(cfg.getStatements(2)) == std::vector<int>{ 4, 5 });
+    REQUIRE(toVector(cfg.getStatements(3)) == std::vector<int>{ 6 });
+    REQUIRE(toVector(cfg.getStatements(4)) == std::vector<int>{ 7, 8 });
+    REQUIRE(toVector(cfg.getStatements(5)) == std::vector<int>{ 9 });
+    // The loop of procedure b has no way out, so it is a single block that is its own successor.
+    REQUIRE(toVector(cfg.getStatements(6)) == std::vector<int>{ 10, 11 });
+    REQUIRE(cfg.getBlock(8) == 4);
+    REQUIRE(cfg.getOffset(8) == 1);
+    REQUIRE(cfg.getOffset(9) == 0);
+    REQUIRE(cfg.getOffset(11) == 1);
+    REQUIRE(cfg.getBlock(0) == -1);
+    REQUIRE(cfg.getBlock(12) == -1);
+
+    REQUIRE(toVector(cfg.getSuccessors().get(1)) == std::vector<int>{ 2, 5 });
+    REQUIRE(toVector(cfg.getSuccessors().get(2)) == std::vector<int>{ 3, 4 });
+    REQUIRE(toVector(cfg.getPredecessors().get(1)) == std::vector<int>{ 0, 3, 4 });
+    REQUIRE(toVector(cfg.getPredecessors().get(6)) == std::vector<int>{ 6 });
+    REQUIRE(cfg.getSuccessors().get(5).empty());
+
+    // Each block comes before its successors, except along the edges back to a while statement.
+    const std::vector<int>& order = cfg.getReversePostorder();
+    REQUIRE(order.size() == 7);
+    std::vector<int> positionOf(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        positionOf[order[i]] = static_cast<int>(i);
+    }
+    for (int block = 0; block < cfg.getBlockCount(); ++block) {
+        for (int successor : cfg.getSuccessors().get(block)) {
+            if (successor != 1 && successor != 6) {
+                REQUIRE(positionOf[block] < positionOf[successor]);
+            }
+        }
+    }
+}
+
+TEST_CASE("Test ControlFlowGraph does not extend a block into the start of a procedure") {
+    ControlFlowGraph cfg = buildControlFlowGraph("procedure a {"
+                                                 "x = 1;" // 1
+                                                 "}"
+                                                 "procedure b {"
+                                                 "y = 1;" // 2
+                                                 "}");
+
+    REQUIRE(cfg.getBlockCount() == 2);
+    REQUIRE(toVector(cfg.getStatements(0)) == std::vector<int>{ 1 });
+    REQUIRE(toVector(cfg.getStatements(1)) == std::vector<int>{ 2 });
+    REQUIRE(cfg.getSuccessors().edgeCount() == 0);
+}
+
+} // namespace testcontrolflowgraph
+} // namespace backend
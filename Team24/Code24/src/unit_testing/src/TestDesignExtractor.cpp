@@ -4,6 +4,12 @@
 #include "TestParserHelpers.h"
 #include "catch.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
 namespace backend {
 namespace testextractor {
 
@@ -559,6 +565,11 @@ TEST_CASE("Test getParentRelationship") {
                                                              actualChildParent.end());
     std::vector<std::pair<int, STATEMENT_NUMBER_SET>> actualParentChildrenVector(
     actualParentChildren.begin(), actualParentChildren.end());
+    // Iteration order of unordered_map is unspecified.
+    std::sort(actualChildParentVector.begin(), actualChildParentVector.end());
+    std::sort(actualParentChildrenVector.begin(), actualParentChildrenVector.end(),
+              [](const std::pair<int, STATEMENT_NUMBER_SET>& a,
+                 const std::pair<int, STATEMENT_NUMBER_SET>& b) { return a.first < b.first; });
 
     std::vector<std::pair<int, STATEMENT_NUMBER_SET>> expectedParentChildren = { { 1, { 2 } },
                                                                                  { 3, { 4, 5 } } };
@@ -568,27 +579,27 @@ TEST_CASE("Test getParentRelationship") {
     REQUIRE(actualChildParentVector == expectedChildParent);
 }
 
-TEST_CASE("Test getPatternsMap multiple assigns") {
+TEST_CASE("Test getPatternIndex multiple assigns") {
     Parser parser = testhelpers::GenerateParserFromTokens(STRUCTURED_STATEMENT);
     TNode ast(parser.parse());
 
     std::vector<const TNode*> assignTNodes = extractor::getTNodeTypeToTNodes(ast)[Assign];
     auto tNodeToStatementNumber = extractor::getTNodeToStatementNumber(ast);
-    auto result = extractor::getPatternsMap(assignTNodes, tNodeToStatementNumber);
-
-    std::vector<std::tuple<std::string, int, bool>> result_c7 = { { "armani", 4, false } };
-    REQUIRE(result["7"] == result_c7);
-    std::vector<std::tuple<std::string, int, bool>> result_c1 = { { "apple", 5, false }, { "gucci", 2, false } };
-    REQUIRE(result["1"] == result_c1);
-    std::vector<std::tuple<std::string, int, bool>> result_23_plus_another_var = { { "some_var", 6, false } };
-    REQUIRE(result["(23+another_var)"] == result_23_plus_another_var);
-    std::vector<std::tuple<std::string, int, bool>> result_another_var = { { "some_var", 6, true } };
-    REQUIRE(result["another_var"] == result_another_var);
-    std::vector<std::tuple<std::string, int, bool>> result_23 = { { "some_var", 6, true } };
-    REQUIRE(result["23"] == result_23);
+    auto result = extractor::getPatternIndex(assignTNodes, tNodeToStatementNumber);
+
+    std::vector<PatternPosting> result_c7 = { { "armani", 4, false } };
+    REQUIRE(result.getPostings("7") == result_c7);
+    std::vector<PatternPosting> result_c1 = { { "apple", 5, false }, { "gucci", 2, false } };
+    REQUIRE(result.getPostings("1") == result_c1);
+    std::vector<PatternPosting> result_23_plus_another_var = { { "some_var", 6, false } };
+    REQUIRE(result.getPostings("(23+another_var)") == result_23_plus_another_var);
+    std::vector<PatternPosting> result_another_var = { { "some_var", 6, true } };
+    REQUIRE(result.getPostings("another_var") == result_another_var);
+    std::vector<PatternPosting> result_23 = { { "some_var", 6, true } };
+    REQUIRE(result.getPostings("23") == result_23);
 }
 
-TEST_CASE("Test getPatternsMap check precedence 1") {
+TEST_CASE("Test getPatternIndex check precedence 1") {
     const char EXPR_STMT_PROG[] = "procedure p {"
                                   "x = 1 + 2 * 3;"
                                   "}";
@@ -597,21 +608,21 @@ TEST_CASE("Test getPatternsMap check precedence 1") {
 
     std::vector<const TNode*> assignTNodes = extractor::getTNodeTypeToTNodes(ast)[Assign];
     auto tNodeToStatementNumber = extractor::getTNodeToStatementNumber(ast);
-    auto result = extractor::getPatternsMap(assignTNodes, tNodeToStatementNumber);
-
-    std::vector<std::tuple<std::string, int, bool>> result_two_plus_three = { { "x", 1, true } };
-    REQUIRE(result["(2*3)"] == result_two_plus_three);
-    std::vector<std::tuple<std::string, int, bool>> result_three = { { "x", 1, true } };
-    REQUIRE(result["3"] == result_three);
-    std::vector<std::tuple<std::string, int, bool>> result_two = { { "x", 1, true } };
-    REQUIRE(result["2"] == result_two);
-    std::vector<std::tuple<std::string, int, bool>> result_expr = { { "x", 1, false } };
-    REQUIRE(result["(1+(2*3))"] == result_expr);
-    std::vector<std::tuple<std::string, int, bool>> result_one = { { "x", 1, true } };
-    REQUIRE(result["1"] == result_one);
+    auto result = extractor::getPatternIndex(assignTNodes, tNodeToStatementNumber);
+
+    std::vector<PatternPosting> result_two_plus_three = { { "x", 1, true } };
+    REQUIRE(result.getPostings("(2*3)") == result_two_plus_three);
+    std::vector<PatternPosting> result_three = { { "x", 1, true } };
+    REQUIRE(result.getPostings("3") == result_three);
+    std::vector<PatternPosting> result_two = { { "x", 1, true } };
+    REQUIRE(result.getPostings("2") == result_two);
+    std::vector<PatternPosting> result_expr = { { "x", 1, false } };
+    REQUIRE(result.getPostings("(1+(2*3))") == result_expr);
+    std::vector<PatternPosting> result_one = { { "x", 1, true } };
+    REQUIRE(result.getPostings("1") == result_one);
 }
 
-TEST_CASE("Test getPatternsMap check precedence 2") {
+TEST_CASE("Test getPatternIndex check precedence 2") {
     const char EXPR_STMT_PROG[] = "procedure p {"
                                   "x = (1 + 2) * 3;"
                                   "}";
@@ -620,21 +631,21 @@ TEST_CASE("Test getPatternsMap check precedence 2") {
 
     std::vector<const TNode*> assignTNodes = extractor::getTNodeTypeToTNodes(ast)[Assign];
     auto tNodeToStatementNumber = extractor::getTNodeToStatementNumber(ast);
-    auto result = extractor::getPatternsMap(assignTNodes, tNodeToStatementNumber);
-
-    std::vector<std::tuple<std::string, int, bool>> result_1_plus_2 = { { "x", 1, true } };
-    REQUIRE(result["(1+2)"] == result_1_plus_2);
-    std::vector<std::tuple<std::string, int, bool>> result_three = { { "x", 1, true } };
-    REQUIRE(result["3"] == result_three);
-    std::vector<std::tuple<std::string, int, bool>> result_two = { { "x", 1, true } };
-    REQUIRE(result["2"] == result_two);
-    std::vector<std::tuple<std::string, int, bool>> result_expr = { { "x", 1, false } };
-    REQUIRE(result["((1+2)*3)"] == result_expr);
-    std::vector<std::tuple<std::string, int, bool>> result_one = { { "x", 1, true } };
-    REQUIRE(result["1"] == result_one);
+    auto result = extractor::getPatternIndex(assignTNodes, tNodeToStatementNumber);
+
+    std::vector<PatternPosting> result_1_plus_2 = { { "x", 1, true } };
+    REQUIRE(result.getPostings("(1+2)") == result_1_plus_2);
+    std::vector<PatternPosting> result_three = { { "x", 1, true } };
+    REQUIRE(result.getPostings("3") == result_three);
+    std::vector<PatternPosting> result_two = { { "x", 1, true } };
+    REQUIRE(result.getPostings("2") == result_two);
+    std::vector<PatternPosting> result_expr = { { "x", 1, false } };
+    REQUIRE(result.getPostings("((1+2)*3)") == result_expr);
+    std::vector<PatternPosting> result_one = { { "x", 1, true } };
+    REQUIRE(result.getPostings("1") == result_one);
 }
 
-TEST_CASE("Test getPatternsMap check precedence complicated") {
+TEST_CASE("Test getPatternIndex check precedence complicated") {
     const char EXPR_STMT_PROG[] = "procedure p {"
                                   "x = (1 + 2) * x + y / (z - 3);"
                                   "}";
@@ -643,33 +654,33 @@ TEST_CASE("Test getPatternsMap check precedence complicated") {
 
     std::vector<const TNode*> assignTNodes = extractor::getTNodeTypeToTNodes(ast)[Assign];
     auto tNodeToStatementNumber = extractor::getTNodeToStatementNumber(ast);
-    auto result = extractor::getPatternsMap(assignTNodes, tNodeToStatementNumber);
-
-    std::vector<std::tuple<std::string, int, bool>> result_three = { { "x", 1, true } };
-    REQUIRE(result["3"] == result_three);
-    std::vector<std::tuple<std::string, int, bool>> result_two = { { "x", 1, true } };
-    REQUIRE(result["2"] == result_two);
-    std::vector<std::tuple<std::string, int, bool>> result_one = { { "x", 1, true } };
-    REQUIRE(result["1"] == result_one);
-    std::vector<std::tuple<std::string, int, bool>> result_x = { { "x", 1, true } };
-    REQUIRE(result["x"] == result_x);
-    std::vector<std::tuple<std::string, int, bool>> result_y = { { "x", 1, true } };
-    REQUIRE(result["y"] == result_y);
-    std::vector<std::tuple<std::string, int, bool>> result_z = { { "x", 1, true } };
-    REQUIRE(result["z"] == result_z);
-
-    std::vector<std::tuple<std::string, int, bool>> result_y_div_z_minus_three = { { "x", 1, true } };
-    REQUIRE(result["(y/(z-3))"] == result_y_div_z_minus_three);
-    std::vector<std::tuple<std::string, int, bool>> result_z_minus_three = { { "x", 1, true } };
-    REQUIRE(result["(z-3)"] == result_z_minus_three);
-
-    std::vector<std::tuple<std::string, int, bool>> result_one_plus_two_times_x = { { "x", 1, true } };
-    REQUIRE(result["((1+2)*x)"] == result_one_plus_two_times_x);
-    std::vector<std::tuple<std::string, int, bool>> result_one_plus_two = { { "x", 1, true } };
-    REQUIRE(result["(1+2)"] == result_one_plus_two);
-
-    std::vector<std::tuple<std::string, int, bool>> result_expr = { { "x", 1, false } };
-    REQUIRE(result["(((1+2)*x)+(y/(z-3)))"] == result_expr);
+    auto result = extractor::getPatternIndex(assignTNodes, tNodeToStatementNumber);
+
+    std::vector<PatternPosting> result_three = { { "x", 1, true } };
+    REQUIRE(result.getPostings("3") == result_three);
+    std::vector<PatternPosting> result_two = { { "x", 1, true } };
+    REQUIRE(result.getPostings("2") == result_two);
+    std::vector<PatternPosting> result_one = { { "x", 1, true } };
+    REQUIRE(result.getPostings("1") == result_one);
+    std::vector<PatternPosting> result_x = { { "x", 1, true } };
+    REQUIRE(result.getPostings("x") == result_x);
+    std::vector<PatternPosting> result_y = { { "x", 1, true } };
+    REQUIRE(result.getPostings("y") == result_y);
+    std::vector<PatternPosting> result_z = { { "x", 1, true } };
+    REQUIRE(result.getPostings("z") == result_z);
+
+    std::vector<PatternPosting> result_y_div_z_minus_three = { { "x", 1, true } };
+    REQUIRE(result.getPostings("(y/(z-3))") == result_y_div_z_minus_three);
+    std::vector<PatternPosting> result_z_minus_three = { { "x", 1, true } };
+    REQUIRE(result.getPostings("(z-3)") == result_z_minus_three);
+
+    std::vector<PatternPosting> result_one_plus_two_times_x = { { "x", 1, true } };
+    REQUIRE(result.getPostings("((1+2)*x)") == result_one_plus_two_times_x);
+    std::vector<PatternPosting> result_one_plus_two = { { "x", 1, true } };
+    REQUIRE(result.getPostings("(1+2)") == result_one_plus_two);
+
+    std::vector<PatternPosting> result_expr = { { "x", 1, false } };
+    REQUIRE(result.getPostings("(((1+2)*x)+(y/(z-3)))") == result_expr);
 }
 
 TEST_CASE("Test getStatementNumberToTNodeTypeMap") {
@@ -741,6 +752,124 @@ TEST_CASE("isValidSimpleProgram: Acyclic calls are valid") {
     REQUIRE(extractor::isValidSimpleProgram(ast) == true);
 }
 
+TEST_CASE("Test extractDesign gives the same tables as the separate extractor functions") {
+    const char program[] = "procedure main {"
+                           "  read x;"
+                           "  while (x > y + 1) {"
+                           "    if (z == 0) then {"
+                           "      call helper;"
+                           "    } else {"
+                           "      x = x - (y * z);"
+                           "      while (a < b) { call leaf; }"
+                           "    }"
+                           "    print x;"
+                           "  }"
+                           "  call leaf;"
+                           "}"
+                           "procedure helper {"
+                           "  if (h != 1) then { call leaf; } else { h = 2; }"
+                           "}"
+                           "procedure leaf {"
+                           "  leafVar = leafVar + 10;"
+                           "  read unused;"
+                           "}"
+                           "procedure empty { print nothing; }";
+    Parser parser = testhelpers::GenerateParserFromTokens(program);
+    TNode ast(parser.parse());
+    extractor::DesignTables tables = extractor::extractDesign(ast);
+
+    auto tNodeTypeToTNodes = extractor::getTNodeTypeToTNodes(ast);
+    auto tNodeToStatementNumber = extractor::getTNodeToStatementNumber(ast);
+    REQUIRE(tables.tNodeToStatementNumber == tNodeToStatementNumber);
+    REQUIRE(tables.tNodeTypeToTNodes.size() == tNodeTypeToTNodes.size());
+    for (auto& p : tNodeTypeToTNodes) {
+        std::vector<const TNode*> actual = tables.tNodeTypeToTNodes.at(p.first);
+        std::sort(actual.begin(), actual.end());
+        std::sort(p.second.begin(), p.second.end());
+        REQUIRE(actual == p.second);
+    }
+    REQUIRE(tables.procedureToCallees == extractor::getProcedureToCallees(tNodeTypeToTNodes));
+
+    auto follows = extractor::getFollowRelationship(ast);
+    REQUIRE(tables.followFollowedRelation == follows.first);
+    REQUIRE(tables.followedFollowRelation == follows.second);
+    auto parents = extractor::getParentRelationship(ast);
+    REQUIRE(tables.childrenParentRelation == parents.first);
+    REQUIRE(tables.parentChildrenRelation == parents.second);
+
+    PatternIndex patternIndex = extractor::getPatternIndex(tNodeTypeToTNodes[Assign], tNodeToStatementNumber);
+    REQUIRE(tables.patternIndex.getPostings("(y*z)") == patternIndex.getPostings("(y*z)"));
+    REQUIRE(tables.patternIndex.getPostings("leafVar") == patternIndex.getPostings("leafVar"));
+    REQUIRE(tables.conditionVariablesToStatementNumbers ==
+            extractor::getConditionVariablesToStatementNumbers(
+            extractor::getStatementNumberToTNode(tNodeToStatementNumber)));
+
+    REQUIRE(tables.usesMapping == extractor::getUsesMapping(tNodeTypeToTNodes));
+    REQUIRE(tables.modifiesMapping == extractor::getModifiesMapping(tNodeTypeToTNodes));
+}
+
+TEST_CASE("Test extractDesign builds the ProgramIR") {
+    const char program[] = "procedure p {"
+                           "  x = y + 1;" // 1
+                           "  while (x > 0) {" // 2
+                           "    read y;" // 3
+                           "    call q;" // 4
+                           "  }"
+                           "}"
+                           "procedure q {"
+                           "  z = x;" // 5
+                           "}";
+    Parser parser = testhelpers::GenerateParserFromTokens(program);
+    TNode ast(parser.parse());
+    extractor::DesignTables tables = extractor::extractDesign(ast);
+    const ProgramIR& ir = tables.program;
+
+    REQUIRE(ir.getStatementCount() == 5);
+    REQUIRE(ir.getProcedures().size() == 2);
+    REQUIRE(ir.getProcedures()[0].name == "p");
+    REQUIRE(ir.getProcedures()[0].firstStatement == 1);
+    REQUIRE(ir.getProcedures()[0].lastStatement == 4);
+    REQUIRE(ir.getProcedures()[1].firstStatement == 5);
+    REQUIRE(ir.getProcedures()[1].lastStatement == 5);
+
+    const StatementIR& assign = ir.getStatement(1);
+    REQUIRE(assign.type == Assign);
+    REQUIRE(assign.parent == 0);
+    REQUIRE(assign.position == 0);
+    REQUIRE(ir.getVariableName(assign.modifiedVariable) == "x");
+    REQUIRE(std::vector<VARIABLE_ID>(ir.getUsedVariables(1).begin(), ir.getUsedVariables(1).end()) ==
+            std::vector<VARIABLE_ID>{ ir.getVariableId("y") });
+    REQUIRE(assign.expression == tables.patternIndex.getExpressions().findCanonical("(y+1)"));
+
+    REQUIRE(ir.getStatement(2).position == 1);
+    REQUIRE(ir.getStatement(3).parent == 2);
+    REQUIRE(ir.getStatement(3).statementList == ir.getStatement(4).statementList);
+    REQUIRE(ir.getStatement(3).statementList != ir.getStatement(1).statementList);
+    REQUIRE(ir.getStatement(4).position == 1);
+
+    const StatementIR& call = ir.getStatement(4);
+    REQUIRE(call.callee == 1);
+    REQUIRE(ir.getModifies().contains(4, ir.getVariableId("z")));
+    REQUIRE(ir.getModifiedVariables(4).size() == 1);
+    REQUIRE(ir.getUses().contains(4, ir.getVariableId("x")));
+    REQUIRE(ir.getUsedVariables(4).size() == 1);
+    REQUIRE(ir.getStatement(5).procedure == 1);
+}
+
+TEST_CASE("Test extractDesign rejects invalid programs") {
+    const char* programs[] = {
+        "procedure p {x=1;} procedure p{y=1;}",
+        "procedure p {call q;}",
+        "procedure p {call p;}",
+        "procedure p {call q;} procedure q {call r;} procedure r {call p;}",
+    };
+    for (const char* program : programs) {
+        Parser parser = testhelpers::GenerateParserFromTokens(program);
+        TNode ast(parser.parse());
+        REQUIRE_THROWS_AS(extractor::extractDesign(ast), std::runtime_error);
+    }
+}
+
 TEST_CASE("Test getNextRelationship double jump") {
     const char STRUCTURED_STATEMENT[] = "procedure MySpecialProc {"
                                         "  while (y == 3) {" // 1
@@ -1036,11 +1165,9 @@ TEST_CASE("Test getAffectsMapping on a linear path ") {
     auto tNodeTypeToTNodes = extractor::getTNodeTypeToTNodes(ast);
     auto nextRelationship = extractor::getNextRelationship(tNodeTypeToTNodes, tNodeToStatementNumber);
     auto actual =
-    extractor::getAffectsMapping(tNodeTypeToTNodes, tNodeToStatementNumber,
-                                 extractor::getStatementNumberToTNode(tNodeToStatementNumber),
-                                 nextRelationship, extractor::getPreviousRelationship(nextRelationship),
-                                 extractor::getUsesMapping(tNodeTypeToTNodes),
-                                 extractor::getModifiesMapping(tNodeTypeToTNodes));
+    extractor::getAffectsMapping(extractor::extractDesign(ast).program,
+                                 CompressedRelation::fromMap(nextRelationship),
+                                 CompressedRelation::fromMap(extractor::getPreviousRelationship(nextRelationship)));
 
     std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> expected = { { 1, { 2, 3, 4 } },
                                                                             { 2, { 3 } },
@@ -1070,11 +1197,9 @@ TEST_CASE("Test getAffectsMapping on a if/else ") {
     auto tNodeTypeToTNodes = extractor::getTNodeTypeToTNodes(ast);
     auto nextRelationship = extractor::getNextRelationship(tNodeTypeToTNodes, tNodeToStatementNumber);
     auto actual =
-    extractor::getAffectsMapping(tNodeTypeToTNodes, tNodeToStatementNumber,
-                                 extractor::getStatementNumberToTNode(tNodeToStatementNumber),
-                                 nextRelationship, extractor::getPreviousRelationship(nextRelationship),
-                                 extractor::getUsesMapping(tNodeTypeToTNodes),
-                                 extractor::getModifiesMapping(tNodeTypeToTNodes));
+    extractor::getAffectsMapping(extractor::extractDesign(ast).program,
+                                 CompressedRelation::fromMap(nextRelationship),
+                                 CompressedRelation::fromMap(extractor::getPreviousRelationship(nextRelationship)));
 
     std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> expected = {
         { 1, { 4, 8 } },
@@ -1109,11 +1234,9 @@ TEST_CASE("Test getAffectsMapping on a while") {
     auto tNodeTypeToTNodes = extractor::getTNodeTypeToTNodes(ast);
     auto nextRelationship = extractor::getNextRelationship(tNodeTypeToTNodes, tNodeToStatementNumber);
     auto actual =
-    extractor::getAffectsMapping(tNodeTypeToTNodes, tNodeToStatementNumber,
-                                 extractor::getStatementNumberToTNode(tNodeToStatementNumber),
-                                 nextRelationship, extractor::getPreviousRelationship(nextRelationship),
-                                 extractor::getUsesMapping(tNodeTypeToTNodes),
-                                 extractor::getModifiesMapping(tNodeTypeToTNodes));
+    extractor::getAffectsMapping(extractor::extractDesign(ast).program,
+                                 CompressedRelation::fromMap(nextRelationship),
+                                 CompressedRelation::fromMap(extractor::getPreviousRelationship(nextRelationship)));
 
     std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> expected = {
         { 1, { 9 } }, // the statements in the while looop may not execute, allowing 1 to affect 9
@@ -1152,11 +1275,9 @@ TEST_CASE("Test getAffectsMapping on code 5") {
     auto tNodeTypeToTNodes = extractor::getTNodeTypeToTNodes(ast);
     auto nextRelationship = extractor::getNextRelationship(tNodeTypeToTNodes, tNodeToStatementNumber);
     auto actual =
-    extractor::getAffectsMapping(tNodeTypeToTNodes, tNodeToStatementNumber,
-                                 extractor::getStatementNumberToTNode(tNodeToStatementNumber),
-                                 nextRelationship, extractor::getPreviousRelationship(nextRelationship),
-                                 extractor::getUsesMapping(tNodeTypeToTNodes),
-                                 extractor::getModifiesMapping(tNodeTypeToTNodes));
+    extractor::getAffectsMapping(extractor::extractDesign(ast).program,
+                                 CompressedRelation::fromMap(nextRelationship),
+                                 CompressedRelation::fromMap(extractor::getPreviousRelationship(nextRelationship)));
 
     // The Wiki misses out on some relationships (because they only list examples.)
     // The full set of Affects relationships are defined here.
@@ -1182,11 +1303,9 @@ TEST_CASE("Test getAffectedMapping") {
     auto tNodeTypeToTNodes = extractor::getTNodeTypeToTNodes(ast);
     auto nextRelationship = extractor::getNextRelationship(tNodeTypeToTNodes, tNodeToStatementNumber);
     auto affectsMapping =
-    extractor::getAffectsMapping(tNodeTypeToTNodes, tNodeToStatementNumber,
-                                 extractor::getStatementNumberToTNode(tNodeToStatementNumber),
-                                 nextRelationship, extractor::getPreviousRelationship(nextRelationship),
-                                 extractor::getUsesMapping(tNodeTypeToTNodes),
-                                 extractor::getModifiesMapping(tNodeTypeToTNodes));
+    extractor::getAffectsMapping(extractor::extractDesign(ast).program,
+                                 CompressedRelation::fromMap(nextRelationship),
+                                 CompressedRelation::fromMap(extractor::getPreviousRelationship(nextRelationship)));
 
     auto actual = extractor::getAffectedMapping(affectsMapping);
     std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> expected = { { 2, { 1 } },
@@ -1216,11 +1335,9 @@ TEST_CASE("Test getAffectsMapping blocked by non-assignment modification") {
     auto tNodeTypeToTNodes = extractor::getTNodeTypeToTNodes(ast);
     auto nextRelationship = extractor::getNextRelationship(tNodeTypeToTNodes, tNodeToStatementNumber);
     auto actual =
-    extractor::getAffectsMapping(tNodeTypeToTNodes, tNodeToStatementNumber,
-                                 extractor::getStatementNumberToTNode(tNodeToStatementNumber),
-                                 nextRelationship, extractor::getPreviousRelationship(nextRelationship),
-                                 extractor::getUsesMapping(tNodeTypeToTNodes),
-                                 extractor::getModifiesMapping(tNodeTypeToTNodes));
+    extractor::getAffectsMapping(extractor::extractDesign(ast).program,
+                                 CompressedRelation::fromMap(nextRelationship),
+                                 CompressedRelation::fromMap(extractor::getPreviousRelationship(nextRelationship)));
 
     // assignment to x (line 1) does not affect 4, 5.
     // assignment to z (line 5) does not affect 7.
@@ -1770,5 +1887,215 @@ TEST_CASE("Test getPreviousBipRelationship") {
     REQUIRE(previousBipRelationship == expected);
 }
 
+// A procedure of `loops` while loops, each nesting another loop and an if statement, over a few
+// variables that are assigned and used throughout.
+std::string generateLoopHeavyProcedure(int loops, const std::string& name = "p") {
+    std::string program = "procedure " + name + " { a = 0; b = 0; c = 0;";
+    for (int i = 0; i < loops; i++) {
+        program += "while (a < " + std::to_string(i) + ") {"
+                   "  b = a + c; a = b * 2;"
+                   "  while (c > b) { c = c - a; if (c == 0) then { read a; b = c; } else { c = b + a; } }"
+                   "  a = a + b + c;"
+                   "}";
+    }
+    return program + "print c; }";
+}
+
+TEST_CASE("Test getAffectsMapping engines agree") {
+    const char program[] = "procedure Proc { "
+                           "while (x > 0) {" // 1
+                           "  y = x;" // 2
+                           "  x = 1;" // 3
+                           "}"
+                           "a = x + y;" // 4
+                           "if (a == 1) then {" // 5
+                           "  read x;" // 6
+                           "  b = x;" // 7
+                           "} else {"
+                           "  call Other;" // 8
+                           "  b = y;" // 9
+                           "}"
+                           "c = a + b + x + y;" // 10
+                           "}"
+                           "procedure Other {"
+                           "while (y > 0) {" // 11
+                           "  y = y - 1;" // 12
+                           "}"
+                           "}";
+    TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+    extractor::DesignTables tables = extractor::extractDesign(ast);
+    CompressedRelation next = CompressedRelation::fromMap(
+    extractor::getNextRelationship(tables.tNodeTypeToTNodes, tables.tNodeToStatementNumber));
+    CompressedRelation previous = next.reversed();
+
+    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> expected = {
+        { 2, { 4, 10 } }, { 3, { 2, 4, 10 } }, { 4, { 10 } }, { 7, { 10 } }, { 9, { 10 } }, { 12, { 12 } }
+    };
+    REQUIRE(extractor::getAffectsMapping(tables.program, next, previous, extractor::ReachingDefinitionsEngine) == expected);
+    REQUIRE(extractor::getAffectsMapping(tables.program, next, previous, extractor::SsaEngine) == expected);
+}
+
+// Writes random programs over a few variables, with nested loops and branches, reads and calls.
+// Each procedure only calls the procedures after it, so the calls are acyclic.
+class RandomProgramGenerator {
+  public:
+    explicit RandomProgramGenerator(unsigned int seed) : random(seed) {
+    }
+
+    std::string generate(int procedureCount) {
+        std::string program;
+        for (int procedure = 0; procedure < procedureCount; procedure++) {
+            program += "procedure p" + std::to_string(procedure) + " {";
+            program += generateStatementList(procedure, procedureCount, 0);
+            program += "}";
+        }
+        return program;
+    }
+
+  private:
+    std::mt19937 random;
+
+    int next(int bound) {
+        return static_cast<int>(random() % bound);
+    }
+
+    std::string generateVariable() {
+        static const char* const variables[] = { "a", "b", "c", "d", "e" };
+        return variables[next(5)];
+    }
+
+    std::string generateFactor() {
+        return next(4) == 0 ? std::to_string(next(10)) : generateVariable();
+    }
+
+    std::string generateAssignment() {
+        static const char* const operators[] = { " + ", " - ", " * " };
+        std::string assignment = generateVariable() + " = " + generateFactor();
+        for (int terms = next(3); terms > 0; terms--) {
+            assignment += operators[next(3)] + generateFactor();
+        }
+        return assignment + ";";
+    }
+
+    std::string generateStatementList(int procedure, int procedureCount, int depth) {
+        std::string statements;
+        for (int count = 1 + next(4); count > 0; count--) {
+            statements += generateStatement(procedure, procedureCount, depth);
+        }
+        return statements;
+    }
+
+    std::string generateStatement(int procedure, int procedureCount, int depth) {
+        switch (next(depth < 3 ? 9 : 6)) {
+        case 0:
+            return "read " + generateVariable() + ";";
+        case 1:
+            return "print " + generateVariable() + ";";
+        case 2:
+            // The last procedure has nothing to call.
+            if (procedure + 1 < procedureCount) {
+                return "call p" + std::to_string(procedure + 1 + next(procedureCount - procedure - 1)) + ";";
+            }
+            return generateAssignment();
+        case 3:
+        case 4:
+        case 5:
+            return generateAssignment();
+        case 6:
+            return "while (" + generateVariable() + " < " + generateFactor() + ") {" +
+                   generateStatementList(procedure, procedureCount, depth + 1) + "}";
+        default:
+            return "if (" + generateVariable() + " == " + generateFactor() + ") then {" +
+                   generateStatementList(procedure, procedureCount, depth + 1) + "} else {" +
+                   generateStatementList(procedure, procedureCount, depth + 1) + "}";
+        }
+    }
+};
+
+TEST_CASE("Test getAffectsMapping engines agree on random programs") {
+    size_t affectsPairCount = 0;
+    for (unsigned int seed = 0; seed < 300; seed++) {
+        std::string program = RandomProgramGenerator(seed).generate(1 + seed % 4);
+        INFO("seed " << seed << ": " << program);
+        TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+        extractor::DesignTables tables = extractor::extractDesign(ast);
+        CompressedRelation next = CompressedRelation::fromMap(
+        extractor::getNextRelationship(tables.tNodeTypeToTNodes, tables.tNodeToStatementNumber));
+        CompressedRelation previous = next.reversed();
+
+        std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> expected =
+        extractor::getAffectsMapping(tables.program, next, previous, extractor::ReachingDefinitionsEngine);
+        REQUIRE(extractor::getAffectsMapping(tables.program, next, previous, extractor::SsaEngine) == expected);
+        for (const auto& affected : expected) {
+            affectsPairCount += affected.second.size();
+        }
+    }
+    // The programs are not so sparse that both engines agree by finding nothing.
+    REQUIRE(affectsPairCount > 1000);
+}
+
+TEST_CASE("Test getAffectsMapping is the same when procedures are analysed in parallel") {
+    std::string program;
+    for (int i = 0; i < 20; i++) {
+        program += generateLoopHeavyProcedure(i % 4, "p" + std::to_string(i));
+    }
+    TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+    extractor::DesignTables tables = extractor::extractDesign(ast);
+    CompressedRelation next = CompressedRelation::fromMap(
+    extractor::getNextRelationship(tables.tNodeTypeToTNodes, tables.tNodeToStatementNumber));
+    CompressedRelation previous = next.reversed();
+
+    std::unordered_map<STATEMENT_NUMBER, STATEMENT_NUMBER_SET> expected =
+    extractor::getAffectsMapping(tables.program, next, previous, extractor::SsaEngine);
+    REQUIRE_FALSE(expected.empty());
+    for (unsigned int threadCount : { 1u, 4u, 0u }) {
+        REQUIRE(extractor::getAffectsMapping(tables.program, next, previous, extractor::ReachingDefinitionsEngine,
+                                             nullptr, threadCount) == expected);
+    }
+}
+
+TEST_CASE("getAffectsMapping on loop-heavy procedures", "[.benchmark]") {
+    for (int loops = 25; loops <= 400; loops *= 2) {
+        TNode ast = testhelpers::GenerateParserFromTokens(generateLoopHeavyProcedure(loops)).parse();
+        extractor::DesignTables tables = extractor::extractDesign(ast);
+        CompressedRelation next = CompressedRelation::fromMap(
+        extractor::getNextRelationship(tables.tNodeTypeToTNodes, tables.tNodeToStatementNumber));
+        CompressedRelation previous = next.reversed();
+
+        std::cout << tables.program.getStatementCount() << " statements:";
+        for (extractor::AffectsEngine engine : { extractor::ReachingDefinitionsEngine, extractor::SsaEngine }) {
+            size_t bytes = 0;
+            auto start = std::chrono::steady_clock::now();
+            auto affects = extractor::getAffectsMapping(tables.program, next, previous, engine, &bytes);
+            std::chrono::duration<double, std::milli> millis = std::chrono::steady_clock::now() - start;
+            std::cout << (engine == extractor::SsaEngine ? " ssa " : " reaching definitions ") << millis.count()
+                      << " ms, " << bytes / 1024 << " KiB;";
+        }
+        std::cout << "\n";
+    }
+}
+
+TEST_CASE("getAffectsMapping on hundreds of procedures", "[.benchmark]") {
+    std::string program;
+    for (int i = 0; i < 400; i++) {
+        program += generateLoopHeavyProcedure(10, "p" + std::to_string(i));
+    }
+    TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+    extractor::DesignTables tables = extractor::extractDesign(ast);
+    CompressedRelation next = CompressedRelation::fromMap(
+    extractor::getNextRelationship(tables.tNodeTypeToTNodes, tables.tNodeToStatementNumber));
+    CompressedRelation previous = next.reversed();
+
+    std::cout << tables.program.getStatementCount() << " statements:";
+    for (unsigned int threadCount : { 1u, 2u, 4u, 8u }) {
+        auto start = std::chrono::steady_clock::now();
+        auto affects = extractor::getAffectsMapping(tables.program, next, previous, extractor::ReachingDefinitionsEngine,
+                                                    nullptr, threadCount);
+        std::chrono::duration<double, std::milli> millis = std::chrono::steady_clock::now() - start;
+        std::cout << " " << threadCount << " threads " << millis.count() << " ms;";
+    }
+    std::cout << "\n";
+}
+
 } // namespace testextractor
 } // namespace backend
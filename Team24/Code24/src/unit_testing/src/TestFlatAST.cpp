@@ -0,0 +1,93 @@
+#include "FlatAST.h"
+#include "TestParserHelpers.h"
+#include "catch.hpp"
+
+#include <string>
+
+namespace backend {
+namespace testflatast {
+
+TEST_CASE("Test FlatAST interns names") {
+    FlatAST ast;
+    NameId x = ast.internName("x");
+    REQUIRE(ast.internName("y") != x);
+    REQUIRE(ast.internName("x") == x);
+}
+
+TEST_CASE("Test FlatAST to TNode") {
+    // call p; x = x + 1;
+    FlatAST ast;
+    NodeId callee = ast.addLeaf(Variable, 1, ast.internName("p"));
+    ast.setProcedureVar(callee);
+    NodeId call = ast.addNode(Call, 1, { callee });
+    NodeId lhs = ast.addLeaf(Variable, 2, ast.internName("x"));
+    NodeId rhs = ast.addNode(Plus, 0, { ast.addLeaf(Variable, 2, ast.internName("x")),
+                                        ast.addLeaf(Constant, 2, ast.internName("1")) });
+    NodeId assign = ast.addNode(Assign, 2, { lhs, rhs });
+    NodeId statementList = ast.addNode(StatementList, 1, { call, assign });
+
+    REQUIRE(ast[statementList].childCount == 2);
+    REQUIRE(ast.child(ast[statementList], 1) == assign);
+    REQUIRE(ast.nameOf(ast[lhs]) == "x");
+
+    TNode expectedCallee(Variable, 1);
+    expectedCallee.name = "p";
+    expectedCallee.isProcedureVar = true;
+    TNode expectedCall(Call, 1);
+    expectedCall.addChild(expectedCallee);
+    TNode x(Variable, 2);
+    x.name = "x";
+    TNode one(Constant, 2);
+    one.constant = "1";
+    TNode plus(Plus);
+    plus.addChild(x);
+    plus.addChild(one);
+    TNode expectedAssign(Assign, 2);
+    expectedAssign.addChild(x);
+    expectedAssign.addChild(plus);
+    TNode expected(StatementList, 1);
+    expected.addChild(expectedCall);
+    expected.addChild(expectedAssign);
+
+    TNode result = ast.toTNode(statementList);
+    REQUIRE(result == expected);
+    REQUIRE(result.children[0].children[0].isProcedureVar);
+    REQUIRE_FALSE(result.children[1].children[0].isProcedureVar);
+}
+
+TEST_CASE("Test Parser builds FlatAST bottom up") {
+    Parser parser = testhelpers::GenerateParserFromTokens("procedure p{ while (x < 1) { read x; } }");
+    TNode program = parser.parse();
+
+    // Children are added before their parent, so the program is the last node.
+    const FlatNode& programNode = parser.ast[static_cast<NodeId>(parser.ast.size() - 1)];
+    REQUIRE(programNode.type == Program);
+    const FlatNode& procedureNode = parser.ast[parser.ast.child(programNode, 0)];
+    REQUIRE(procedureNode.type == Procedure);
+    REQUIRE(parser.ast.nameOf(procedureNode) == "p");
+    REQUIRE(program == parser.ast.toTNode(static_cast<NodeId>(parser.ast.size() - 1)));
+}
+
+TEST_CASE("Test deeply nested statements") {
+    std::string program = "procedure p{";
+    int depth = 2000;
+    for (int i = 0; i < depth; i++) {
+        program += "while (x < 1) {";
+    }
+    program += "read x;";
+    for (int i = 0; i < depth; i++) {
+        program += "}";
+    }
+    program += "}";
+
+    TNode result = testhelpers::GenerateParserFromTokens(program).parse();
+    const TNode* node = &result.children[0].children[0];
+    int whileCount = 0;
+    while (!node->children.empty() && node->children[0].type == While) {
+        node = &node->children[0].children[1];
+        whileCount++;
+    }
+    REQUIRE(whileCount == depth);
+}
+} // namespace testflatast
+} // namespace backend
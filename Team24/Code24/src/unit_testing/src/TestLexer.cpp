@@ -1,7 +1,12 @@
 #include "Lexer.h"
 #include "catch.hpp"
 
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -310,3 +315,223 @@ TEST_CASE("Test HASH") {
     REQUIRE(expectedTokensWithWhitespace == prettyTypeStr(tokensWithWhitespace));
     REQUIRE(expectedTokensWithoutWhitespace == prettyTypeStr(tokensWithoutWhitespace));
 }
+
+bool isSameTokenStream(const std::vector<backend::lexer::Token>& actual,
+                       const std::vector<backend::lexer::Token>& expected) {
+    if (actual.size() != expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < actual.size(); i++) {
+        if (actual[i].type != expected[i].type || actual[i].line != expected[i].line ||
+            actual[i].linePosition != expected[i].linePosition ||
+            actual[i].nameValue != expected[i].nameValue || actual[i].integerValue != expected[i].integerValue) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Lexes the input with both the scanner and the regex reference lexer, with and without whitespace.
+void requireSameAsRegexLexer(const std::string& input) {
+    for (bool withWhitespace : { true, false }) {
+        std::stringstream regexStream(input);
+        std::stringstream scannerStream(input);
+        std::vector<backend::lexer::Token> expected =
+        backend::lexer::tokenizeWithRegex(regexStream, withWhitespace);
+        std::vector<backend::lexer::Token> actual = withWhitespace ?
+                                                    backend::lexer::tokenizeWithWhitespace(scannerStream) :
+                                                    backend::lexer::tokenize(scannerStream);
+        REQUIRE(isSameTokenStream(actual, expected));
+    }
+}
+
+// Returns the error message of the lexer, or an empty string if it did not throw.
+std::string getLexerError(const std::string& input, bool useRegexLexer) {
+    std::stringstream stream(input);
+    try {
+        if (useRegexLexer) {
+            backend::lexer::tokenizeWithRegex(stream, true);
+        } else {
+            backend::lexer::tokenizeWithWhitespace(stream);
+        }
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+    return "";
+}
+
+std::string generateSimpleProgram(int numberOfProcedures) {
+    std::string program;
+    for (int i = 0; i < numberOfProcedures; i++) {
+        std::string index = std::to_string(i);
+        program += "procedure proc" + index + " {\n"
+                   "    read x" + index + ";\n"
+                   "    while ((x" + index + " != 0) && !(y >= 10)) {\n"
+                   "        x" + index + " = x" + index + " - 1 * (y % 3) / z;\n"
+                   "        if (x" + index + " == y) then {\n"
+                   "            print y; } else {\r\n"
+                   "\t\tcall proc" + std::to_string(i + 1) + "; }\n"
+                   "    }\n"
+                   "}\n";
+    }
+    return program;
+}
+
+TEST_CASE("Lexer produces the same tokens as the regex lexer") {
+    requireSameAsRegexLexer("");
+    requireSameAsRegexLexer("\n");
+    requireSameAsRegexLexer("\n\n  \n");
+    requireSameAsRegexLexer("a\n");
+    requireSameAsRegexLexer("  leading whitespace\t\r\n\n trailing  \n");
+    requireSameAsRegexLexer("x1_a2 = 12abc + 0 * a_ - b__1 / (c % d);");
+    requireSameAsRegexLexer("while (!(a != b) && (c == d) || (e >= f) && (g <= h) || (i > j) && (k < l))");
+    requireSameAsRegexLexer("!! == = != >> <<= ;;");
+    requireSameAsRegexLexer("Select <a.stmt#, v.varName> such that Follows*(_, a) pattern a(_, _\"x+1\"_)");
+    requireSameAsRegexLexer("\v\fa\v\fb\r\r");
+    requireSameAsRegexLexer(generateSimpleProgram(5));
+}
+
+TEST_CASE("Lexer throws the same errors as the regex lexer") {
+    std::vector<std::string> invalidInputs = {
+        "007", "x = 01;", "a & b", "a | b", "x\n y = $z;", "valid;\n\n@", "a &&& b", "c ||| d", "\xe9t\xe9",
+    };
+    for (const auto& input : invalidInputs) {
+        std::string expectedError = getLexerError(input, true);
+        REQUIRE_FALSE(expectedError.empty());
+        REQUIRE(getLexerError(input, false) == expectedError);
+    }
+}
+
+TEST_CASE("Offset based tokens refer back into the source buffer") {
+    backend::lexer::TokenizedSource source =
+        backend::lexer::tokenize(backend::lexer::SourceBuffer::fromString("procedure main {\n  x = 10;\n}"));
+    REQUIRE(source.size() == 8);
+    REQUIRE(source[1].type == backend::lexer::NAME);
+    REQUIRE(source.text(source[1]) == "main");
+    REQUIRE(source.textEquals(source[1], "main"));
+    REQUIRE_FALSE(source.textEquals(source[1], "mai"));
+    REQUIRE(source[3].line == 2);
+    REQUIRE(source.text(source[5]) == "10");
+
+    std::stringstream stream("procedure main {\n  x = 10;\n}");
+    REQUIRE(isSameTokenStream(source.toTokens(), backend::lexer::tokenizeWithRegex(stream, false)));
+}
+
+TEST_CASE("Lexed token stream rejects tokens that were released") {
+    backend::lexer::TokenStream stream(backend::lexer::SourceBuffer::fromString("procedure main {\n  x = 10;\n}"));
+    REQUIRE(stream.text(*stream.peek(4)) == "=");
+    stream.release(3);
+    REQUIRE(stream.text(*stream.peek(3)) == "x");
+    REQUIRE(stream.peek(8) == nullptr);
+    REQUIRE_THROWS_AS(stream.peek(2), std::runtime_error);
+}
+
+TEST_CASE("Memory mapped file lexes the same as the string") {
+    std::string program = generateSimpleProgram(20);
+    std::string filename = "lexer_source_buffer_test.txt";
+    {
+        std::ofstream file(filename, std::ios::binary);
+        file << program;
+    }
+    std::shared_ptr<const backend::lexer::SourceBuffer> mapped =
+        backend::lexer::SourceBuffer::fromFile(filename);
+    REQUIRE(std::string(mapped->data(), mapped->size()) == program);
+
+    std::stringstream stream(program);
+    REQUIRE(isSameTokenStream(backend::lexer::tokenizeWithWhitespace(mapped).toTokens(),
+                              backend::lexer::tokenizeWithWhitespace(stream)));
+    std::remove(filename.c_str());
+
+    REQUIRE_THROWS_AS(backend::lexer::SourceBuffer::fromFile("lexer_missing_file.txt"), std::runtime_error);
+}
+
+bool isSameSourceTokens(const backend::lexer::TokenizedSource& actual,
+                        const backend::lexer::TokenizedSource& expected) {
+    if (actual.size() != expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < actual.size(); i++) {
+        if (actual[i].type != expected[i].type || actual[i].line != expected[i].line ||
+            actual[i].offset != expected[i].offset || actual[i].length != expected[i].length) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string getParallelLexerError(const std::string& input) {
+    try {
+        backend::lexer::tokenizeInParallel(backend::lexer::SourceBuffer::fromString(input), false, 8);
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+    return "";
+}
+
+TEST_CASE("Parallel lexer produces the same tokens as the lexer") {
+    // Blank and whitespace only lines make some chunks start or end with whitespace.
+    std::string program = "\n  \n";
+    for (int i = 0; i < 40; i++) {
+        program += generateSimpleProgram(50) + (i % 2 == 0 ? "\n \t\n\n" : "  ");
+    }
+    std::shared_ptr<const backend::lexer::SourceBuffer> buffer = backend::lexer::SourceBuffer::fromString(program);
+
+    for (bool willLexWithWhitespace : { false, true }) {
+        backend::lexer::TokenizedSource expected = willLexWithWhitespace ?
+                                                   backend::lexer::tokenizeWithWhitespace(buffer) :
+                                                   backend::lexer::tokenize(buffer);
+        for (unsigned int threadCount : { 1u, 2u, 3u, 8u }) {
+            REQUIRE(isSameSourceTokens(backend::lexer::tokenizeInParallel(buffer, willLexWithWhitespace, threadCount),
+                                       expected));
+        }
+    }
+}
+
+TEST_CASE("Parallel lexer throws the first error of the source") {
+    std::string program = generateSimpleProgram(1000);
+    std::vector<std::string> invalidInputs = {
+        program + "x = 01;\n" + program + "y = $z;",
+        program.substr(0, program.size() / 2) + "@\n" + program,
+        program + program + "a & b",
+    };
+    for (const auto& input : invalidInputs) {
+        std::string expectedError = getLexerError(input, false);
+        REQUIRE_FALSE(expectedError.empty());
+        REQUIRE(getParallelLexerError(input) == expectedError);
+    }
+}
+
+TEST_CASE("Lexer throughput against the regex lexer", "[.benchmark]") {
+    std::string program = generateSimpleProgram(500);
+    double megabytes = program.size() / (1024.0 * 1024.0);
+
+    std::stringstream regexStream(program);
+    auto regexStart = std::chrono::steady_clock::now();
+    std::vector<backend::lexer::Token> expected = backend::lexer::tokenizeWithRegex(regexStream, false);
+    std::chrono::duration<double> regexSeconds = std::chrono::steady_clock::now() - regexStart;
+
+    std::stringstream scannerStream(program);
+    auto scannerStart = std::chrono::steady_clock::now();
+    std::vector<backend::lexer::Token> actual = backend::lexer::tokenize(scannerStream);
+    std::chrono::duration<double> scannerSeconds = std::chrono::steady_clock::now() - scannerStart;
+
+    std::cout << "Lexing " << megabytes << " MB (" << actual.size() << " tokens)\n"
+              << "  regex lexer:   " << megabytes / regexSeconds.count() << " MB/s\n"
+              << "  scanner lexer: " << megabytes / scannerSeconds.count() << " MB/s\n";
+    REQUIRE(isSameTokenStream(actual, expected));
+}
+
+TEST_CASE("Parallel lexer throughput", "[.benchmark]") {
+    std::string program = generateSimpleProgram(100000);
+    double megabytes = program.size() / (1024.0 * 1024.0);
+    std::shared_ptr<const backend::lexer::SourceBuffer> buffer = backend::lexer::SourceBuffer::fromString(program);
+
+    std::cout << "Lexing " << megabytes << " MB\n";
+    for (unsigned int threadCount : { 1u, 2u, 4u, 8u }) {
+        auto start = std::chrono::steady_clock::now();
+        backend::lexer::TokenizedSource tokens = backend::lexer::tokenizeInParallel(buffer, false, threadCount);
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        std::cout << "  " << threadCount << " threads: " << megabytes / seconds.count() << " MB/s ("
+                  << tokens.size() << " tokens)\n";
+    }
+}
@@ -5,7 +5,12 @@
 #include "catch.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace backend {
 namespace testpkb {
@@ -275,6 +280,74 @@ TEST_CASE("Test getStatementsThatHaveDescendants") {
     REQUIRE(expected == actual);
 }
 
+TEST_CASE("Test Follows* and Parent* in nested statement lists") {
+    const char program[] = "procedure a {"
+                           "x = 1;" // 1
+                           "while (x < 2) {" // 2
+                           "  if (x == 1) then {" // 3
+                           "    x = 2;" // 4
+                           "    y = 3;" // 5
+                           "  } else {"
+                           "    y = 4;" // 6
+                           "  }"
+                           "  z = 5;" // 7
+                           "}"
+                           "print z;" // 8
+                           "}"
+                           "procedure b {"
+                           "read y;" // 9
+                           "print y;" // 10
+                           "}";
+    TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+    PKBImplementation pkb(ast);
+
+    STATEMENT_NUMBER_SET expected = { 2, 8 };
+    REQUIRE(pkb.getStatementsThatFollows(1) == expected);
+    expected = { 1, 2 };
+    REQUIRE(pkb.getStatementsFollowedBy(8) == expected);
+    expected = { 7 };
+    REQUIRE(pkb.getStatementsThatFollows(3) == expected);
+    expected = {};
+    REQUIRE(pkb.getStatementsThatFollows(5) == expected);
+    REQUIRE(pkb.getStatementsFollowedBy(6) == expected);
+    REQUIRE(pkb.getStatementsThatFollows(11) == expected);
+
+    REQUIRE(pkb.isFollowsTransitive(1, 8));
+    REQUIRE(pkb.isFollowsTransitive(4, 5));
+    REQUIRE(pkb.isFollowsTransitive(9, 10));
+    REQUIRE_FALSE(pkb.isFollowsTransitive(8, 1));
+    REQUIRE_FALSE(pkb.isFollowsTransitive(5, 6));
+    REQUIRE_FALSE(pkb.isFollowsTransitive(8, 9));
+    REQUIRE_FALSE(pkb.isFollowsTransitive(1, 1));
+    REQUIRE(pkb.getStatementsThatFollowAsList(1) == STATEMENT_NUMBER_LIST{ 2, 8 });
+    REQUIRE(pkb.getStatementsFollowedByAsList(8) == STATEMENT_NUMBER_LIST{ 1, 2 });
+    REQUIRE(pkb.getStatementsThatFollowAsList(3) == STATEMENT_NUMBER_LIST{ 7 });
+    REQUIRE(pkb.getStatementsThatFollowAsList(5).empty());
+    REQUIRE(pkb.getStatementsFollowedByAsList(11).empty());
+
+    expected = { 3, 4, 5, 6, 7 };
+    REQUIRE(pkb.getDescendants(2) == expected);
+    expected = { 4, 5, 6 };
+    REQUIRE(pkb.getDescendants(3) == expected);
+    expected = { 2, 3 };
+    REQUIRE(pkb.getAncestors(6) == expected);
+    expected = {};
+    REQUIRE(pkb.getAncestors(9) == expected);
+    REQUIRE(pkb.getDescendants(0) == expected);
+
+    REQUIRE(pkb.isParentTransitive(2, 6));
+    REQUIRE(pkb.isParentTransitive(2, 7));
+    REQUIRE(pkb.isParentTransitive(3, 6));
+    REQUIRE_FALSE(pkb.isParentTransitive(3, 7));
+    REQUIRE_FALSE(pkb.isParentTransitive(2, 8));
+    REQUIRE_FALSE(pkb.isParentTransitive(6, 3));
+    REQUIRE_FALSE(pkb.isParentTransitive(2, 2));
+    REQUIRE(pkb.getDescendantsAsList(2) == STATEMENT_NUMBER_LIST{ 3, 4, 5, 6, 7 });
+    REQUIRE(pkb.getDescendantsAsList(3) == STATEMENT_NUMBER_LIST{ 4, 5, 6 });
+    REQUIRE(pkb.getDescendantsAsList(8).empty());
+    REQUIRE(pkb.getDescendantsAsList(0).empty());
+}
+
 // We use cars and modify jewellery
 const char USES_AND_MODIFIES_PROGRAM[] = "procedure main {"
                                          "while (2 == nike) {" // 1
@@ -711,6 +784,31 @@ TEST_CASE("Test invalid getAllAssignmentStatementsThatMatch patterns") {
     REQUIRE(actual8_f == expected8_f);
 }
 
+TEST_CASE("Test getAllAssignmentStatementsThatMatchCanonical") {
+    const char STRUCTURED_STATEMENT[] = "procedure MySpecialProc {"
+                                        "x = p + q * r;"
+                                        "z = y + q * r;"
+                                        "}";
+
+    Parser parser = testhelpers::GenerateParserFromTokens(STRUCTURED_STATEMENT);
+    TNode ast(parser.parse());
+    PKBImplementation pkb(ast);
+
+    REQUIRE(pkb.getAllAssignmentStatementsThatMatchCanonical("_", "(q*r)", true) == STATEMENT_NUMBER_SET{ 1, 2 });
+    REQUIRE(pkb.getAllAssignmentStatementsThatMatchCanonical("z", "(y+(q*r))", false) == STATEMENT_NUMBER_SET{ 2 });
+    REQUIRE(pkb.getAllAssignmentStatementsThatMatchCanonical("x", "", true) == STATEMENT_NUMBER_SET{ 1 });
+    REQUIRE(pkb.getAllAssignmentStatementsThatMatchCanonical("_", "", false).empty());
+    // The pattern is not parsed, so a pattern that is not in canonical form does not match.
+    REQUIRE(pkb.getAllAssignmentStatementsThatMatchCanonical("_", "q*r", true).empty());
+
+    for (const char* pattern : { "q*r", "y + q*r", "p", "" }) {
+        for (bool isSubExpr : { true, false }) {
+            REQUIRE(pkb.getAllAssignmentStatementsThatMatchCanonical("_", Parser::parseExpr(pattern), isSubExpr) ==
+                    pkb.getAllAssignmentStatementsThatMatch("_", pattern, isSubExpr));
+        }
+    }
+}
+
 TEST_CASE("Test isEntity") {
     const char STRUCTURED_STATEMENT[] = "procedure aoeu {"
 
@@ -919,6 +1017,24 @@ TEST_CASE("Test getProceduresCalledBy") {
     REQUIRE(actualE_transitive == expectedE_transitive);
 }
 
+TEST_CASE("Test getTransitiveCallPairs") {
+    const char program[] = "procedure a { call b; call d; }"
+                           "procedure b { call c; }"
+                           "procedure c { y = 1; }"
+                           "procedure d { call c; }";
+    TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+    PKBImplementation pkb(ast);
+
+    PROCEDURE_NAME_PAIR_LIST pairs = pkb.getTransitiveCallPairs({ "a", "b", "c", "d" }, { "a", "b", "c", "d" });
+    std::sort(pairs.begin(), pairs.end());
+    PROCEDURE_NAME_PAIR_LIST expected = { { "a", "b" }, { "a", "c" }, { "a", "d" }, { "b", "c" }, { "d", "c" } };
+    REQUIRE(pairs == expected);
+
+    pairs = pkb.getTransitiveCallPairs({ "a", "e" }, { "c", "e" });
+    REQUIRE(pairs == PROCEDURE_NAME_PAIR_LIST{ { "a", "c" } });
+    REQUIRE(pkb.getTransitiveCallPairs({ "c" }, { "a", "b", "c", "d" }).empty());
+}
+
 TEST_CASE("Test getNextStatementOf") {
     const char STRUCTURED_STATEMENT[] = "procedure a {         "
                                         "  while (1 == 1) {    " // 1
@@ -1024,6 +1140,103 @@ TEST_CASE("Test getNextStatementOf") {
     STATEMENT_NUMBER_SET actual_non_transitive_10 = pkb.getNextStatementOf(10, false);
     STATEMENT_NUMBER_SET expected_non_transitive_10 = {};
     REQUIRE(actual_non_transitive_10 == expected_non_transitive_10);
+
+    // TEST POINT CHECKS
+    REQUIRE(pkb.isNextTransitive(1, 1));
+    REQUIRE(pkb.isNextTransitive(6, 3));
+    REQUIRE(pkb.isNextTransitive(7, 8));
+    REQUIRE(pkb.isNextTransitive(9, 10));
+    REQUIRE_FALSE(pkb.isNextTransitive(8, 8));
+    REQUIRE_FALSE(pkb.isNextTransitive(8, 9));
+    REQUIRE_FALSE(pkb.isNextTransitive(10, 9));
+    REQUIRE_FALSE(pkb.isNextTransitive(0, 1));
+}
+
+TEST_CASE("Test Next* through basic blocks agrees with a traversal") {
+    const char program[] = "procedure a {"
+                           "x = 1;" // 1
+                           "y = 2;" // 2
+                           "while (x < y) {" // 3
+                           "  x = x + 1;" // 4
+                           "  z = 2;" // 5
+                           "  if (x == 2) then {" // 6
+                           "    y = 1;" // 7
+                           "  } else {"
+                           "    y = 2;" // 8
+                           "    z = 3;" // 9
+                           "  }"
+                           "}"
+                           "print y;" // 10
+                           "z = 1;" // 11
+                           "}"
+                           "procedure b {"
+                           "while (z > 0) {" // 12
+                           "  z = z - 1;" // 13
+                           "  read z;" // 14
+                           "}"
+                           "}";
+    TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+    PKBImplementation pkb(ast);
+    const CompressedRelation& next = pkb.getNextRelation();
+    const CompressedRelation previous = next.reversed();
+
+    // Statements 4, 5 and 6 are one block on the loop, so each reaches the others and itself.
+    REQUIRE(pkb.getControlFlowGraph().getBlock(5) == pkb.getControlFlowGraph().getBlock(4));
+    REQUIRE(pkb.getControlFlowGraph().getOffset(6) == 2);
+    REQUIRE(pkb.isNextTransitive(6, 4));
+    REQUIRE(pkb.isNextTransitive(5, 5));
+    REQUIRE(pkb.isNextTransitive(1, 2));
+    REQUIRE_FALSE(pkb.isNextTransitive(2, 1));
+    REQUIRE_FALSE(pkb.isNextTransitive(11, 11));
+    REQUIRE_FALSE(pkb.isNextTransitive(0, 1));
+
+    for (STATEMENT_NUMBER s = 0; s <= 15; ++s) {
+        INFO("statement " << s);
+        std::vector<int> reachable = next.getReachable(s);
+        REQUIRE(pkb.getNextStatementOf(s, true) == STATEMENT_NUMBER_SET(reachable.begin(), reachable.end()));
+        std::vector<int> reaching = previous.getReachable(s);
+        REQUIRE(pkb.getPreviousStatementOf(s, true) == STATEMENT_NUMBER_SET(reaching.begin(), reaching.end()));
+        for (STATEMENT_NUMBER t = 0; t <= 15; ++t) {
+            bool isReachable = std::find(reachable.begin(), reachable.end(), t) != reachable.end();
+            REQUIRE(pkb.isNextTransitive(s, t) == isReachable);
+        }
+    }
+}
+
+TEST_CASE("Test the statements of each procedure") {
+    const char program[] = "procedure a {"
+                           "x = 1;" // 1
+                           "call b;" // 2
+                           "}"
+                           "procedure b {"
+                           "while (z > 0) {" // 3
+                           "  z = z - 1;" // 4
+                           "}"
+                           "}"
+                           "procedure c {"
+                           "print z;" // 5
+                           "}";
+    TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+    PKBImplementation pkb(ast);
+
+    REQUIRE(pkb.getProcedureOfStatement(1) == "a");
+    REQUIRE(pkb.getProcedureOfStatement(4) == "b");
+    REQUIRE(pkb.getProcedureOfStatement(5) == "c");
+    REQUIRE(pkb.getProcedureOfStatement(0) == "");
+    REQUIRE(pkb.getProcedureOfStatement(6) == "");
+
+    REQUIRE(pkb.getStatementRange("a") == std::pair<STATEMENT_NUMBER, STATEMENT_NUMBER>(1, 2));
+    REQUIRE(pkb.getStatementRange("b") == std::pair<STATEMENT_NUMBER, STATEMENT_NUMBER>(3, 4));
+    REQUIRE(pkb.getStatementRange("c") == std::pair<STATEMENT_NUMBER, STATEMENT_NUMBER>(5, 5));
+    REQUIRE(pkb.getStatementRange("d") == std::pair<STATEMENT_NUMBER, STATEMENT_NUMBER>(0, 0));
+
+    REQUIRE(pkb.isInSameProcedure(1, 2));
+    REQUIRE(pkb.isInSameProcedure(4, 3));
+    REQUIRE(pkb.isInSameProcedure(5, 5));
+    REQUIRE_FALSE(pkb.isInSameProcedure(2, 3));
+    REQUIRE_FALSE(pkb.isInSameProcedure(1, 5));
+    REQUIRE_FALSE(pkb.isInSameProcedure(5, 6));
+    REQUIRE_FALSE(pkb.isInSameProcedure(0, 0));
 }
 
 TEST_CASE("Test getPreviousStatementOf") {
@@ -1611,6 +1824,13 @@ TEST_CASE("Test getStatementsAffectedBy/getStatementsAffectedBy") {
     REQUIRE(pkb.getStatementsThatAffect(7, true) == expected);
     expected = { 2, 3, 5, 7 };
     REQUIRE(pkb.getStatementsThatAffect(8, true) == expected);
+
+    REQUIRE(pkb.isAffectsTransitive(2, 2));
+    REQUIRE(pkb.isAffectsTransitive(5, 8));
+    REQUIRE(pkb.isAffectsTransitive(7, 7));
+    REQUIRE_FALSE(pkb.isAffectsTransitive(7, 2));
+    REQUIRE_FALSE(pkb.isAffectsTransitive(8, 8));
+    REQUIRE_FALSE(pkb.isAffectsTransitive(1, 2));
 }
 
 TEST_CASE("Test getAllStatementsThatAffect/getAllStatementsThatAreAffected") {
@@ -1638,6 +1858,100 @@ TEST_CASE("Test getAllStatementsThatAffect/getAllStatementsThatAreAffected") {
     REQUIRE(pkb.getAllStatementsThatAreAffected() == expected);
 }
 
+TEST_CASE("Test Affects is computed after the AST is freed") {
+    const char program[] = "procedure Proc { "
+                           "x = 1;" // 1
+                           "read y;" // 2
+                           "while (x < 10) {" // 3
+                           "  y = x + y;" // 4
+                           "  x = y;" // 5
+                           "}"
+                           "}";
+
+    PKBImplementation pkb;
+    {
+        TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+        pkb = PKBImplementation(ast);
+    }
+
+    PROGRAM_LINE_SET expected = { 4 };
+    REQUIRE(pkb.getStatementsAffectedBy(1, false) == expected);
+    expected = { 4, 5 };
+    REQUIRE(pkb.getStatementsAffectedBy(4, false) == expected);
+    expected = { 1, 4, 5 };
+    REQUIRE(pkb.getStatementsThatAffect(4, true) == expected);
+    REQUIRE(pkb.isAssign(5));
+    REQUIRE_FALSE(pkb.isAssign(6));
+}
+
+TEST_CASE("Test Affects of a single statement is the same on demand") {
+    const char program[] = "procedure Proc { "
+                           "x = 1;" // 1
+                           "y = 2;" // 2
+                           "while (x < 10) {" // 3
+                           "  if (y > x) then {" // 4
+                           "    x = x + y;" // 5
+                           "    read y;" // 6
+                           "  } else {"
+                           "    y = x * 2;" // 7
+                           "    call Other;" // 8
+                           "  }"
+                           "  z = x + y + z;" // 9
+                           "}"
+                           "print z;" // 10
+                           "z = z + x;" // 11
+                           "}"
+                           "procedure Other {"
+                           "x = 0;" // 12
+                           "}";
+    TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+    PKBImplementation onDemandForward(ast);
+    PKBImplementation onDemandBackward(ast);
+    PKBImplementation precomputed(ast);
+    precomputed.getAllStatementsThatAffect();
+
+    for (STATEMENT_NUMBER s = 0; s <= 13; ++s) {
+        INFO("statement " << s);
+        REQUIRE(onDemandForward.getStatementsAffectedBy(s, false) == precomputed.getStatementsAffectedBy(s, false));
+        REQUIRE(onDemandBackward.getStatementsThatAffect(s, false) == precomputed.getStatementsThatAffect(s, false));
+    }
+    // Statement 5, and the call to Other at 8, modify x before 9 uses it.
+    PROGRAM_LINE_SET expected = { 5, 7, 11 };
+    REQUIRE(onDemandForward.getStatementsAffectedBy(1, false) == expected);
+    expected = { 5, 7, 9 };
+    REQUIRE(onDemandBackward.getStatementsThatAffect(9, false) == expected);
+}
+
+TEST_CASE("Test Affects is computed once for concurrent callers") {
+    const char program[] = "procedure Proc { "
+                           "x = 1;" // 1
+                           "while (x < 10) {" // 2
+                           "  y = x + 1;" // 3
+                           "  x = y * 2;" // 4
+                           "}"
+                           "print x;" // 5
+                           "}";
+    TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+    PKBImplementation pkb(ast);
+
+    std::vector<PROGRAM_LINE_SET> affected(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < affected.size(); ++i) {
+        threads.emplace_back([&pkb, &affected, i]() {
+            affected[i] = i % 2 == 0 ? pkb.getStatementsAffectedBy(1, false) : pkb.getAllStatementsThatAffect();
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (size_t i = 0; i < affected.size(); ++i) {
+        PROGRAM_LINE_SET expected = i % 2 == 0 ? PROGRAM_LINE_SET{ 3 } : PROGRAM_LINE_SET{ 1, 3, 4 };
+        REQUIRE(affected[i] == expected);
+    }
+    REQUIRE(&pkb.getAllStatementsThatAffect() == &pkb.getAllStatementsThatAffect());
+    REQUIRE(pkb.getAllStatementsThatAreAffected() == PROGRAM_LINE_SET{ 3, 4 });
+}
+
 TEST_CASE("Test getNextBipStatementOf basic") {
     const char STRUCTURED_STATEMENT[] = "procedure a {         "
                                         "  while (1 == 1) {    " // 1
@@ -2137,5 +2451,102 @@ TEST_CASE("Test getStatementsAffectedBipBy the case in the wiki") {
     REQUIRE(pkb.getStatementsAffectedBipBy(4, true) == expected);
 }
 
+std::string generateLongExpression(int terms) {
+    // x = v0 + v1 + ... parses as a left-leaning tree, `terms` levels deep.
+    std::string program = "procedure p { x = v0";
+    for (int i = 1; i < terms; i++) {
+        program += " + v" + std::to_string(i % 100);
+    }
+    return program + "; }";
+}
+
+std::string generateNestedWhiles(int depth) {
+    std::string program = "procedure p {";
+    for (int i = 0; i < depth; i++) {
+        program += "while (x < 1) {";
+    }
+    program += "x = y;";
+    for (int i = 0; i < depth; i++) {
+        program += "}";
+    }
+    return program + "}";
+}
+
+TEST_CASE("Test PKB on 100k-deep expressions and 10k-deep nesting") {
+    SECTION("Long expression") {
+        TNode ast = testhelpers::GenerateParserFromTokens(generateLongExpression(100000)).parse();
+        PKBImplementation pkb(ast);
+        REQUIRE(pkb.getVariablesUsedIn(1).size() == 100);
+        REQUIRE(pkb.getAllAssignmentStatementsThatMatch("x", "v0 + v1 + v2", true) == STATEMENT_NUMBER_SET{ 1 });
+        REQUIRE_FALSE(getExprString(ast.children[0].children[0].children[0].children[1]).empty());
+
+        TNode copy(ast);
+        REQUIRE(copy == ast);
+    }
+
+    SECTION("Nested whiles") {
+        int depth = 10000;
+        TNode ast = testhelpers::GenerateParserFromTokens(generateNestedWhiles(depth)).parse();
+        PKBImplementation pkb(ast);
+        REQUIRE(pkb.getStatementsThatModify("x").size() == depth + 1);
+        REQUIRE(pkb.getStatementsThatUse("y").size() == depth + 1);
+
+        TNode copy(ast);
+        REQUIRE(copy == ast);
+    }
+}
+
+std::string generateAssignmentLoops(int loops) {
+    std::string program = "procedure p { x = 0; y = 0;";
+    for (int i = 0; i < loops; i++) {
+        program += "while (x < 10) { y = x + y; x = y * 2; if (y > x) then { x = 1; } else { y = x; } }";
+    }
+    return program + "print y; }";
+}
+
+TEST_CASE("Affects is computed once per PKB", "[.benchmark]") {
+    TNode ast = testhelpers::GenerateParserFromTokens(generateAssignmentLoops(100)).parse();
+    PKBImplementation pkb(ast);
+    const STATEMENT_NUMBER_SET& statements = pkb.getAllStatements();
+
+    auto start = std::chrono::steady_clock::now();
+    pkb.getAllStatementsThatAffect();
+    std::chrono::duration<double, std::micro> firstCall = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (STATEMENT_NUMBER s : statements) {
+        pkb.getStatementsAffectedBy(s, false);
+    }
+    std::chrono::duration<double, std::micro> laterCalls = std::chrono::steady_clock::now() - start;
+    std::cout << statements.size() << " statements: first call " << firstCall.count() << " us, later calls "
+              << laterCalls.count() / statements.size() << " us each\n";
+
+    PKBImplementation onDemand(ast);
+    start = std::chrono::steady_clock::now();
+    onDemand.getStatementsAffectedBy(4, false);
+    onDemand.getStatementsThatAffect(4, false);
+    std::chrono::duration<double, std::micro> onDemandCalls = std::chrono::steady_clock::now() - start;
+    std::cout << "Affects(4, _) and Affects(_, 4) on demand: " << onDemandCalls.count() << " us\n";
+
+    start = std::chrono::steady_clock::now();
+    for (STATEMENT_NUMBER s : statements) {
+        pkb.getStatementsAffectedBy(s, true);
+    }
+    std::chrono::duration<double, std::micro> transitiveCalls = std::chrono::steady_clock::now() - start;
+    std::cout << "Affects*(s, _): " << transitiveCalls.count() / statements.size() << " us each\n";
+}
+
+TEST_CASE("PKB construction scales linearly with nesting depth", "[.benchmark]") {
+    for (int size = 12500; size <= 100000; size *= 2) {
+        for (const std::string& program : { generateLongExpression(size), generateNestedWhiles(size / 10) }) {
+            TNode ast = testhelpers::GenerateParserFromTokens(program).parse();
+            auto start = std::chrono::steady_clock::now();
+            PKBImplementation pkb(ast);
+            std::chrono::duration<double, std::milli> millis = std::chrono::steady_clock::now() - start;
+            std::cout << program.size() << " characters: " << millis.count() << " ms\n";
+        }
+    }
+}
+
 } // namespace testpkb
 } // namespace backend
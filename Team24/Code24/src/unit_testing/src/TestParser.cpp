@@ -1,9 +1,14 @@
+#include "DesignExtractor.h"
 #include "Logger.h"
 #include "Parser.h"
 #include "TestParserHelpers.h"
 #include "catch.hpp"
 
+#include <chrono>
+#include <iostream>
 #include <sstream>
+#include <string>
+#include <unordered_set>
 
 namespace backend {
 namespace testparser {
@@ -700,6 +705,9 @@ TEST_CASE("Test Parser::parseExpr") {
     REQUIRE(Parser::parseExpr("1+y*z+4*3") == "((1+(y*z))+(4*3))");
     REQUIRE(Parser::parseExpr("1+2+3-4") == "(((1+2)+3)-4)");
     REQUIRE(Parser::parseExpr("1*2%3/4") == "(((1*2)%3)/4)");
+    REQUIRE(Parser::parseExpr(" ( 1 ) + y ") == "(1+y)");
+    REQUIRE(Parser::parseExpr("1+2 3").empty());
+    REQUIRE(Parser::parseExpr("1+").empty());
 }
 
 TEST_CASE("Test statement requires at least 2 tokens to parse") {
@@ -720,5 +728,179 @@ TEST_CASE("Test assignment statements with keywords as assignee") {
                                                           "}");
     REQUIRE_NOTHROW(parser.parse());
 }
+TEST_CASE("Test condition starting with bracketed expr") {
+    std::vector<std::string> validConditions = {
+        "(x + y) < 1",
+        "((x)) == (((1)))",
+        "(x) * (y) >= (1 + 2) % z",
+        "((x + y) < 1) && ((y) > (x))",
+        "(!((x) != 1)) || ((x < 1) && (1 < (x)))",
+    };
+    for (const auto& condition : validConditions) {
+        Parser parser = testhelpers::GenerateParserFromTokens("procedure p{while (" + condition +
+                                                              "){y = y + 1;}}");
+        REQUIRE_NOTHROW(parser.parse());
+    }
+
+    std::vector<std::string> invalidConditions = {
+        "(x + y)", "(x < 1) &&", "(x < 1) && y < 1", "!x < 1", "(x < 1) < 1", "((x < 1)) && (y < 1)", "(x < 1",
+    };
+    for (const auto& condition : invalidConditions) {
+        Parser parser = testhelpers::GenerateParserFromTokens("procedure p{while (" + condition +
+                                                              "){y = y + 1;}}");
+        REQUIRE_THROWS(parser.parse());
+    }
+}
+
+// Nests conditions `depth` times on both sides of the boolean operators, inside `!` and inside
+// bracketed expressions.
+std::string generateNestedCondition(int depth) {
+    std::string condition = "((x + 1)) < (y)";
+    for (int i = 0; i < depth; i++) {
+        std::string index = std::to_string(i);
+        if (i % 3 == 0) {
+            condition = "(" + condition + ") && ((((v" + index + "))) > 0)";
+        } else if (i % 3 == 1) {
+            condition = "((v" + index + ") == 1) || (" + condition + ")";
+        } else {
+            condition = "!(" + condition + ")";
+        }
+    }
+    return "procedure p{while (" + condition + "){y = y + 1;}}";
+}
+
+TEST_CASE("Test deeply nested condition") {
+    Parser parser = testhelpers::GenerateParserFromTokens(generateNestedCondition(300));
+    REQUIRE_NOTHROW(parser.parse());
+}
+
+TEST_CASE("Condition parsing scales linearly with nesting depth", "[.benchmark]") {
+    for (int depth = 250; depth <= 4000; depth *= 2) {
+        Parser parser = testhelpers::GenerateParserFromTokens(generateNestedCondition(depth));
+        auto start = std::chrono::steady_clock::now();
+        parser.parse();
+        std::chrono::duration<double, std::micro> micros = std::chrono::steady_clock::now() - start;
+        std::cout << "depth " << depth << ": " << micros.count() << " us, "
+                  << micros.count() * 1000 / parser.tokens.getPeakWindowSize() << " ns per token\n";
+    }
+}
+std::string generateProcedures(int numberOfProcedures) {
+    std::string program;
+    for (int i = 0; i < numberOfProcedures; i++) {
+        std::string index = std::to_string(i);
+        program += "procedure p" + index + " {\n";
+        // Procedures of different sizes.
+        for (int j = 0; j <= i % 4; j++) {
+            program += "  while ((x < " + index + ") && (y > 0)) {\n"
+                       "    if (x == y) then { read x; call p" + std::to_string(i + 1) + "; }\n"
+                       "    else { x = (x + 1) * y; }\n"
+                       "  }\n"
+                       "  print y;\n";
+        }
+        program += "}\n";
+    }
+    return program;
+}
+
+void collectHashIntegers(const TNode& node, std::unordered_set<int>& hashIntegers) {
+    hashIntegers.insert(node.hashInteger);
+    for (const TNode& child : node.children) {
+        collectHashIntegers(child, hashIntegers);
+    }
+}
+
+TEST_CASE("Test parseInParallel produces the same AST as parse") {
+    std::string program = generateProcedures(50);
+    TNode expected = testhelpers::GenerateParserFromTokens(program).parse();
+    for (unsigned int threadCount : { 1u, 2u, 8u }) {
+        TNode result = testhelpers::GenerateParserFromTokens(program).parseInParallel(threadCount);
+        REQUIRE(result == expected);
+
+        // Statements are numbered across procedures in source order.
+        std::unordered_map<const TNode*, int> expectedNumbers = extractor::getTNodeToStatementNumber(expected);
+        std::unordered_map<int, const TNode*> numberToTNode =
+        extractor::getStatementNumberToTNode(extractor::getTNodeToStatementNumber(result));
+        REQUIRE(numberToTNode.size() == expectedNumbers.size());
+        for (const auto& p : expectedNumbers) {
+            REQUIRE(numberToTNode[p.second]->line == p.first->line);
+            REQUIRE(numberToTNode[p.second]->type == p.first->type);
+        }
+
+        // Nodes created on different threads still get unique identifiers.
+        std::unordered_set<int> hashIntegers;
+        collectHashIntegers(result, hashIntegers);
+        std::unordered_set<int> expectedHashIntegers;
+        collectHashIntegers(expected, expectedHashIntegers);
+        REQUIRE(hashIntegers.size() == expectedHashIntegers.size());
+    }
+}
+
+TEST_CASE("Test parseInParallel throws the same errors as parse") {
+    std::string program = generateProcedures(10);
+    std::vector<std::string> invalidPrograms = {
+        program + "procedure q { x = ; }" + program,
+        program + "procedure q { while (x < 1) { read x; }" + program,
+        program + "procedure q { x = 1; }}",
+        program + "x = 1;",
+        "procedure q { if (x < 1) then { read x; } }" + program,
+    };
+    for (const auto& invalidProgram : invalidPrograms) {
+        std::string expectedError;
+        try {
+            testhelpers::GenerateParserFromTokens(invalidProgram).parse();
+        } catch (const std::runtime_error& e) {
+            expectedError = e.what();
+        }
+        REQUIRE_FALSE(expectedError.empty());
+        REQUIRE_THROWS_WITH(testhelpers::GenerateParserFromTokens(invalidProgram).parseInParallel(4),
+                            expectedError);
+    }
+}
+TEST_CASE("Test streaming parser produces the same AST as parse") {
+    std::string program = generateProcedures(50);
+    TNode expected = testhelpers::GenerateParserFromTokens(program).parse();
+
+    Parser parser(lexer::SourceBuffer::fromString(program));
+    REQUIRE(parser.parse() == expected);
+    // Only the tokens of about one statement are held at a time.
+    REQUIRE(parser.tokens.getPeakWindowSize() < 50);
+
+    // Not tokenized up front, so this falls back to parse.
+    REQUIRE(Parser(lexer::SourceBuffer::fromString(program)).parseInParallel(4) == expected);
+}
+
+TEST_CASE("Test streaming parser throws lexer errors") {
+    Parser parser(lexer::SourceBuffer::fromString("procedure p {\n x = 1;\n y = 01; }"));
+    REQUIRE_THROWS_WITH(parser.parse(), "Trailing zeroes not allowed: 01");
+
+    // The condition is unbalanced, so looking for its closing paren reaches the end of the stream.
+    parser = Parser(lexer::SourceBuffer::fromString("procedure p { while ((x < 1) { x = 1; } }"));
+    REQUIRE_THROWS(parser.parse());
+}
+
+TEST_CASE("Streaming parser memory against tokenizing up front", "[.benchmark]") {
+    std::string program = generateProcedures(40000);
+    std::shared_ptr<const lexer::SourceBuffer> buffer = lexer::SourceBuffer::fromString(program);
+    std::cout << "Parsing " << program.size() / (1024.0 * 1024.0) << " MB\n";
+
+    auto start = std::chrono::steady_clock::now();
+    Parser tokenizedParser(lexer::tokenize(buffer));
+    tokenizedParser.parse();
+    std::chrono::duration<double> tokenizedSeconds = std::chrono::steady_clock::now() - start;
+    size_t tokenizedCount = tokenizedParser.tokens.getPeakWindowSize();
+
+    start = std::chrono::steady_clock::now();
+    Parser streamingParser(buffer);
+    streamingParser.parse();
+    std::chrono::duration<double> streamingSeconds = std::chrono::steady_clock::now() - start;
+    size_t streamingCount = streamingParser.tokens.getPeakWindowSize();
+
+    std::cout << "  tokenized up front: " << tokenizedCount << " tokens ("
+              << tokenizedCount * sizeof(lexer::SourceToken) / 1024 << " KB) held, " << tokenizedSeconds.count()
+              << " s\n"
+              << "  streaming:          " << streamingCount << " tokens ("
+              << streamingCount * sizeof(lexer::SourceToken) << " B) held, " << streamingSeconds.count() << " s\n";
+    REQUIRE(streamingCount < tokenizedCount);
+}
 } // namespace testparser
 } // namespace backend
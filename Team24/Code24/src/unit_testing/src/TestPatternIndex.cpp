@@ -0,0 +1,55 @@
+#include "DesignExtractor.h"
+#include "PatternIndex.h"
+#include "TestParserHelpers.h"
+#include "catch.hpp"
+
+#include <string>
+
+namespace backend {
+namespace testpatternindex {
+
+TEST_CASE("Test ExpressionDAG shares structurally equal expressions") {
+    ExpressionDAG dag;
+    ExprId x = dag.internLeaf(Variable, "x");
+    ExprId one = dag.internLeaf(Constant, "1");
+    ExprId xPlusOne = dag.internOperator(Plus, x, one);
+
+    REQUIRE(dag.internLeaf(Variable, "x") == x);
+    REQUIRE(dag.internOperator(Plus, x, one) == xPlusOne);
+    REQUIRE(dag.internOperator(Plus, one, x) != xPlusOne);
+    REQUIRE(dag.internOperator(Minus, x, one) != xPlusOne);
+    REQUIRE(dag.size() == 5);
+
+    REQUIRE(dag.findCanonical("(x+1)") == xPlusOne);
+    REQUIRE(dag.findCanonical("x") == x);
+    REQUIRE(dag.findCanonical("(x*1)") == NO_EXPR);
+    REQUIRE(dag.findCanonical("y") == NO_EXPR);
+    // Not in canonical form.
+    REQUIRE(dag.findCanonical("x+1") == NO_EXPR);
+    REQUIRE(dag.findCanonical("(x+1") == NO_EXPR);
+    REQUIRE(dag.findCanonical("(x+1))") == NO_EXPR);
+    REQUIRE(dag.findCanonical("") == NO_EXPR);
+}
+
+TEST_CASE("Test PatternIndex grows linearly with repeated expressions") {
+    std::string program = "procedure p {";
+    int assignCount = 1000;
+    for (int i = 0; i < assignCount; i++) {
+        program += "x = (a + b) * (a + b) + c;";
+    }
+    program += "}";
+    Parser parser = testhelpers::GenerateParserFromTokens(program);
+    TNode ast(parser.parse());
+    PatternIndex index = extractor::getPatternIndex(extractor::getTNodeTypeToTNodes(ast)[Assign],
+                                                   extractor::getTNodeToStatementNumber(ast));
+
+    // a, b, c, (a+b), ((a+b)*(a+b)) and the whole expression.
+    REQUIRE(index.getExpressions().size() == 6);
+    // (a+b) occurs twice in every assignment.
+    REQUIRE(index.getPostings("(a+b)").size() == 2 * assignCount);
+    REQUIRE(index.match("x", "(((a+b)*(a+b))+c)", false).size() == assignCount);
+    REQUIRE(index.match("_", "((a+b)*(a+b))", false).empty());
+    REQUIRE(index.match("y", "c", true).empty());
+}
+} // namespace testpatternindex
+} // namespace backend
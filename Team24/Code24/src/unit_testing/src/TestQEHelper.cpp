@@ -1,6 +1,9 @@
 #include "TestQEHelper.h"
 
 #include "PKB.h"
+#include "Parser.h"
+
+#include <algorithm>
 
 namespace qpbackend {
 namespace qetest {
@@ -454,6 +457,26 @@ STATEMENT_NUMBER_SET PKBMock::getAllStatementsThatFollows() const {
     return stmts;
 }
 
+// The statement lists of the mock are only known as sets, so the lists are in increasing order,
+// which is also the order of a statement list.
+STATEMENT_NUMBER_LIST PKBMock::getStatementsThatFollowAsList(STATEMENT_NUMBER s) const {
+    STATEMENT_NUMBER_SET stmts = getStatementsThatFollows(s);
+    STATEMENT_NUMBER_LIST list(stmts.begin(), stmts.end());
+    std::sort(list.begin(), list.end());
+    return list;
+}
+
+STATEMENT_NUMBER_LIST PKBMock::getStatementsFollowedByAsList(STATEMENT_NUMBER s) const {
+    STATEMENT_NUMBER_SET stmts = getStatementsFollowedBy(s);
+    STATEMENT_NUMBER_LIST list(stmts.begin(), stmts.end());
+    std::sort(list.begin(), list.end());
+    return list;
+}
+
+bool PKBMock::isFollowsTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const {
+    return getStatementsThatFollows(a).count(b) > 0;
+}
+
 STATEMENT_NUMBER_SET PKBMock::getParent(STATEMENT_NUMBER statementNumber) const {
     STATEMENT_NUMBER_SET stmts;
     if (test_idx == 0) {
@@ -690,6 +713,17 @@ STATEMENT_NUMBER_SET PKBMock::getStatementsThatHaveDescendants() const {
     return stmts;
 }
 
+STATEMENT_NUMBER_LIST PKBMock::getDescendantsAsList(STATEMENT_NUMBER statementNumber) const {
+    STATEMENT_NUMBER_SET stmts = getDescendants(statementNumber);
+    STATEMENT_NUMBER_LIST list(stmts.begin(), stmts.end());
+    std::sort(list.begin(), list.end());
+    return list;
+}
+
+bool PKBMock::isParentTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const {
+    return getDescendants(a).count(b) > 0;
+}
+
 STATEMENT_NUMBER_SET PKBMock::getStatementsThatUse(VARIABLE_NAME v) const {
     STATEMENT_NUMBER_SET stmts;
     if (test_idx == 2) {
@@ -883,6 +917,12 @@ VARIABLE_NAME_LIST PKBMock::getVariablesModifiedBySomeStatement() const {
 
 STATEMENT_NUMBER_SET
 PKBMock::getAllAssignmentStatementsThatMatch(const std::string& assignee, const std::string& pattern, bool isSubExpr) const {
+    return getAllAssignmentStatementsThatMatchCanonical(assignee, backend::Parser::parseExpr(pattern), isSubExpr);
+}
+
+STATEMENT_NUMBER_SET PKBMock::getAllAssignmentStatementsThatMatchCanonical(const std::string& assignee,
+                                                                           const std::string& pattern,
+                                                                           bool isSubExpr) const {
     if (test_idx == 0) {
         if (!isSubExpr) {
             if (assignee == "_") {
@@ -893,25 +933,25 @@ PKBMock::getAllAssignmentStatementsThatMatch(const std::string& assignee, const
                 if (pattern == "0") {
                     return { 1, 2, 3 };
                 }
-                if (assignee == "count" && pattern == "count+1") {
+                if (assignee == "count" && pattern == "(count+1)") {
                     return { 6 };
                 }
-                if (assignee == "cenX" && pattern == "cenX+x") {
+                if (assignee == "cenX" && pattern == "(cenX+x)") {
                     return { 7 };
                 }
-                if (assignee == "cenY" && pattern == "cenY+y") {
+                if (assignee == "cenY" && pattern == "(cenY+y)") {
                     return { 8 };
                 }
                 if (assignee == "flag" && pattern == "1") {
                     return { 11 };
                 }
-                if (assignee == "cenX" && pattern == "cenX/count") {
+                if (assignee == "cenX" && pattern == "(cenX/count)") {
                     return { 12 };
                 }
-                if (assignee == "cenY" && pattern == "cenY/count") {
+                if (assignee == "cenY" && pattern == "(cenY/count)") {
                     return { 13 };
                 }
-                if (assignee == "normSq" && pattern == "cenX*cenX+cenY*cenY") {
+                if (assignee == "normSq" && pattern == "((cenX*cenX)+(cenY*cenY))") {
                     return { 14 };
                 }
                 return {};
@@ -925,25 +965,25 @@ PKBMock::getAllAssignmentStatementsThatMatch(const std::string& assignee, const
             if (assignee == "cenY" && pattern == "0") {
                 return { 3 };
             }
-            if (assignee == "count" && pattern == "count+1") {
+            if (assignee == "count" && pattern == "(count+1)") {
                 return { 6 };
             }
-            if (assignee == "cenX" && pattern == "cenX+x") {
+            if (assignee == "cenX" && pattern == "(cenX+x)") {
                 return { 7 };
             }
-            if (assignee == "cenY" && pattern == "cenY+y") {
+            if (assignee == "cenY" && pattern == "(cenY+y)") {
                 return { 8 };
             }
             if (assignee == "flag" && pattern == "1") {
                 return { 11 };
             }
-            if (assignee == "cenX" && pattern == "cenX/count") {
+            if (assignee == "cenX" && pattern == "(cenX/count)") {
                 return { 12 };
             }
-            if (assignee == "cenY" && pattern == "cenY/count") {
+            if (assignee == "cenY" && pattern == "(cenY/count)") {
                 return { 13 };
             }
-            if (assignee == "normSq" && pattern == "cenX*cenX+cenY*cenY") {
+            if (assignee == "normSq" && pattern == "((cenX*cenX)+(cenY*cenY))") {
                 return { 14 };
             }
             return {};
@@ -1003,7 +1043,7 @@ PKBMock::getAllAssignmentStatementsThatMatch(const std::string& assignee, const
         if (assignee == "cenY" && pattern == "0") {
             return { 3 };
         }
-        if (assignee == "count" && pattern == "count+1") {
+        if (assignee == "count" && pattern == "(count+1)") {
             return { 6 };
         }
         if (assignee == "count" && pattern == "count") {
@@ -1012,7 +1052,7 @@ PKBMock::getAllAssignmentStatementsThatMatch(const std::string& assignee, const
         if (assignee == "count" && pattern == "1") {
             return { 6 };
         }
-        if (assignee == "cenX" && pattern == "cenX+x") {
+        if (assignee == "cenX" && pattern == "(cenX+x)") {
             return { 7 };
         }
         if (assignee == "cenX" && pattern == "cenX") {
@@ -1021,7 +1061,7 @@ PKBMock::getAllAssignmentStatementsThatMatch(const std::string& assignee, const
         if (assignee == "cenX" && pattern == "x") {
             return { 7 };
         }
-        if (assignee == "cenY" && pattern == "cenY+y") {
+        if (assignee == "cenY" && pattern == "(cenY+y)") {
             return { 8 };
         }
         if (assignee == "cenY" && pattern == "cenY") {
@@ -1033,25 +1073,25 @@ PKBMock::getAllAssignmentStatementsThatMatch(const std::string& assignee, const
         if (assignee == "flag" && pattern == "1") {
             return { 11 };
         }
-        if (assignee == "cenX" && pattern == "cenX/count") {
+        if (assignee == "cenX" && pattern == "(cenX/count)") {
             return { 12 };
         }
-        if (assignee == "cenX" && pattern == "cenX/count") {
+        if (assignee == "cenX" && pattern == "(cenX/count)") {
             return { 12 };
         }
-        if (assignee == "cenY" && pattern == "cenY/count") {
+        if (assignee == "cenY" && pattern == "(cenY/count)") {
             return { 13 };
         }
         if (assignee == "cenY" && pattern == "count") {
             return { 13 };
         }
-        if (assignee == "normSq" && pattern == "cenX*cenX+cenY*cenY") {
+        if (assignee == "normSq" && pattern == "((cenX*cenX)+(cenY*cenY))") {
             return { 14 };
         }
-        if (assignee == "normSq" && pattern == "cenX*cenX") {
+        if (assignee == "normSq" && pattern == "(cenX*cenX)") {
             return { 14 };
         }
-        if (assignee == "normSq" && pattern == "cenY*cenY") {
+        if (assignee == "normSq" && pattern == "(cenY*cenY)") {
             return { 14 };
         }
         if (assignee == "normSq" && pattern == "cenX") {
@@ -1097,7 +1137,7 @@ PKBMock::getAllAssignmentStatementsThatMatch(const std::string& assignee, const
                 }
             }
         } else {
-            if (pattern == "n+1") {
+            if (pattern == "(n+1)") {
                 if (assignee == "n" || assignee == "_") {
                     return { 5 };
                 } else if (assignee == "y" || assignee == "_") {
@@ -1625,6 +1665,10 @@ STATEMENT_NUMBER_SET PKBMock::getAllIfElseStatementsThatMatch(const VARIABLE_NAM
     return result;
 }
 
+bool PKBMock::isNextTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const {
+    return getNextStatementOf(a, true).count(b) > 0;
+}
+
 const STATEMENT_NUMBER_SET& PKBMock::getAllStatementsWithNext() const {
     static STATEMENT_NUMBER_SET lines;
     if (test_idx == 2) {
@@ -1897,6 +1941,10 @@ PROGRAM_LINE_SET PKBMock::getStatementsThatAffectBip(PROGRAM_LINE statementNumbe
     return lines;
 }
 
+bool PKBMock::isAffectsTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const {
+    return getStatementsAffectedBy(a, true).count(b) > 0;
+}
+
 const PROGRAM_LINE_SET& PKBMock::getAllStatementsThatAffect() const {
     static PROGRAM_LINE_SET lines = { 10, 11, 12, 15, 16, 17, 21, 22 };
     return lines;
@@ -1917,5 +1965,74 @@ const PROGRAM_LINE_SET& PKBMock::getAllStatementsThatAreAffectedBip() const {
     return lines;
 }
 
+// The mock does not model procedures, so it puts every statement in one procedure, and no pair
+// of statements is pruned.
+PROCEDURE_NAME PKBMock::getProcedureOfStatement(STATEMENT_NUMBER s) const {
+    // Code 2 is split into foo (1-2) and bar (3-9); the other codes are kept in their first procedure.
+    if (test_idx == 2) {
+        return s < 3 ? "foo" : "bar";
+    }
+    return getAllProcedures().front();
+}
+
+std::pair<STATEMENT_NUMBER, STATEMENT_NUMBER> PKBMock::getStatementRange(const PROCEDURE_NAME& p) const {
+    if (test_idx == 2 && p == "foo") {
+        return { 1, 2 };
+    }
+    if (test_idx == 2 && p == "bar") {
+        return { 3, 9 };
+    }
+    if (test_idx == 2 || p != getAllProcedures().front()) {
+        return { 0, 0 };
+    }
+    return { *std::min_element(getAllStatements().begin(), getAllStatements().end()),
+             *std::max_element(getAllStatements().begin(), getAllStatements().end()) };
+}
+
+bool PKBMock::isInSameProcedure(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const {
+    return getProcedureOfStatement(a) == getProcedureOfStatement(b);
+}
+
+STATEMENT_NUMBER_PAIR_LIST PKBMock::getTransitivePairs(backend::TransitiveStatementRelation relation,
+                                                       const std::vector<STATEMENT_NUMBER>& sources,
+                                                       const std::vector<STATEMENT_NUMBER>& targets) const {
+    // Answered from the single-source methods of the mock, one source at a time.
+    STATEMENT_NUMBER_PAIR_LIST pairs;
+    for (STATEMENT_NUMBER source : sources) {
+        STATEMENT_NUMBER_SET reachable;
+        switch (relation) {
+        case backend::NextTransitive:
+            reachable = getNextStatementOf(source, true);
+            break;
+        case backend::AffectsTransitive:
+            reachable = getStatementsAffectedBy(source, true);
+            break;
+        case backend::ParentTransitive:
+            reachable = getDescendants(source);
+            break;
+        }
+        for (STATEMENT_NUMBER target : targets) {
+            if (reachable.count(target)) {
+                pairs.emplace_back(source, target);
+            }
+        }
+    }
+    return pairs;
+}
+
+PROCEDURE_NAME_PAIR_LIST PKBMock::getTransitiveCallPairs(const PROCEDURE_NAME_LIST& callers,
+                                                         const PROCEDURE_NAME_LIST& callees) const {
+    PROCEDURE_NAME_PAIR_LIST pairs;
+    for (const PROCEDURE_NAME& caller : callers) {
+        PROCEDURE_NAME_SET called = getProceduresCalledBy(caller, true);
+        for (const PROCEDURE_NAME& callee : callees) {
+            if (called.count(callee)) {
+                pairs.emplace_back(caller, callee);
+            }
+        }
+    }
+    return pairs;
+}
+
 } // namespace qetest
 } // namespace qpbackend
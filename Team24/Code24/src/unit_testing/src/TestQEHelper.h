@@ -53,6 +53,9 @@ class PKBMock : public backend::PKB {
     STATEMENT_NUMBER_SET getAllStatementsThatAreFollowed() const override;
     STATEMENT_NUMBER_SET getStatementsThatFollows(STATEMENT_NUMBER s) const override;
     STATEMENT_NUMBER_SET getAllStatementsThatFollows() const override;
+    STATEMENT_NUMBER_LIST getStatementsThatFollowAsList(STATEMENT_NUMBER s) const override;
+    STATEMENT_NUMBER_LIST getStatementsFollowedByAsList(STATEMENT_NUMBER s) const override;
+    bool isFollowsTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const override;
 
     // PARENT
     STATEMENT_NUMBER_SET getParent(STATEMENT_NUMBER statementNumber) const override;
@@ -61,6 +64,8 @@ class PKBMock : public backend::PKB {
     STATEMENT_NUMBER_SET getStatementsThatHaveAncestors() const override;
     STATEMENT_NUMBER_SET getDescendants(STATEMENT_NUMBER statementNumber) const override;
     STATEMENT_NUMBER_SET getStatementsThatHaveDescendants() const override;
+    STATEMENT_NUMBER_LIST getDescendantsAsList(STATEMENT_NUMBER statementNumber) const override;
+    bool isParentTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const override;
 
     STATEMENT_NUMBER_SET getStatementsThatUse(VARIABLE_NAME v) const override;
     STATEMENT_NUMBER_SET getStatementsThatUseSomeVariable() const override;
@@ -87,6 +92,7 @@ class PKBMock : public backend::PKB {
 
     STATEMENT_NUMBER_SET getNextStatementOf(STATEMENT_NUMBER statementNumber, bool isTransitive) const override;
     STATEMENT_NUMBER_SET getPreviousStatementOf(STATEMENT_NUMBER statementNumber, bool isTransitive) const override;
+    bool isNextTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const override;
     const STATEMENT_NUMBER_SET& getAllStatementsWithNext() const override;
     const STATEMENT_NUMBER_SET& getAllStatementsWithPrev() const override;
 
@@ -98,6 +104,9 @@ class PKBMock : public backend::PKB {
 
     STATEMENT_NUMBER_SET
     getAllAssignmentStatementsThatMatch(const std::string& assignee, const std::string& pattern, bool isSubExpr) const override;
+    STATEMENT_NUMBER_SET getAllAssignmentStatementsThatMatchCanonical(const std::string& assignee,
+                                                                      const std::string& pattern,
+                                                                      bool isSubExpr) const override;
     STATEMENT_NUMBER_SET getAllWhileStatementsThatMatch(const VARIABLE_NAME& variable,
                                                         const std::string& pattern,
                                                         bool isSubExpr) const override;
@@ -109,6 +118,7 @@ class PKBMock : public backend::PKB {
 
     PROGRAM_LINE_SET getStatementsAffectedBy(PROGRAM_LINE statementNumber, bool isTransitive) const override;
     PROGRAM_LINE_SET getStatementsThatAffect(PROGRAM_LINE statementNumber, bool isTransitive) const override;
+    bool isAffectsTransitive(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const override;
     const PROGRAM_LINE_SET& getAllStatementsThatAffect() const override;
     const PROGRAM_LINE_SET& getAllStatementsThatAreAffected() const override;
 
@@ -116,6 +126,16 @@ class PKBMock : public backend::PKB {
     PROGRAM_LINE_SET getStatementsThatAffectBip(PROGRAM_LINE statementNumber, bool isTransitive) const override;
     const PROGRAM_LINE_SET& getAllStatementsThatAffectBip() const override;
     const PROGRAM_LINE_SET& getAllStatementsThatAreAffectedBip() const override;
+
+    PROCEDURE_NAME getProcedureOfStatement(STATEMENT_NUMBER s) const override;
+    std::pair<STATEMENT_NUMBER, STATEMENT_NUMBER> getStatementRange(const PROCEDURE_NAME& p) const override;
+    bool isInSameProcedure(STATEMENT_NUMBER a, STATEMENT_NUMBER b) const override;
+
+    STATEMENT_NUMBER_PAIR_LIST getTransitivePairs(backend::TransitiveStatementRelation relation,
+                                                  const std::vector<STATEMENT_NUMBER>& sources,
+                                                  const std::vector<STATEMENT_NUMBER>& targets) const override;
+    PROCEDURE_NAME_PAIR_LIST getTransitiveCallPairs(const PROCEDURE_NAME_LIST& callers,
+                                                    const PROCEDURE_NAME_LIST& callees) const override;
 };
 
 // For string representing two vectors
@@ -444,6 +444,14 @@ TEST_CASE("Test evaluation of Parent* between synonyms") {
                         {} };
     REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(queryPost), { "2", "3", "4", "5", "6" }));
 
+    // all pairs are answered by one getTransitivePairs call
+    Query queryPairs = { { { "s1", STMT }, { "s2", STMT } },
+                         { { DEFAULT_VAL, "s1" }, { DEFAULT_VAL, "s2" } },
+                         { { PARENTT, { STMT_SYNONYM, "s1" }, { STMT_SYNONYM, "s2" } } },
+                         {} };
+    REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(queryPairs),
+                                       { "1 2", "1 3", "1 4", "1 5", "1 6", "2 3", "4 5", "4 6" }));
+
     Query querySelf = {
         { { "s", STMT } }, { "s" }, { { PARENTT, { STMT_SYNONYM, "s" }, { STMT_SYNONYM, "s" } } }, {}
     };
@@ -907,13 +915,13 @@ TEST_CASE("Test pattern of exact match") {
     Query query2 = { { { "a", ASSIGN }, { "cl", CALL } },
                      { "cl" },
                      {},
-                     { { ASSIGN_PATTERN_EXACT, { STMT_SYNONYM, "a" }, { NAME_ENTITY, "cenX" }, "cenX+x" } } };
+                     { { ASSIGN_PATTERN_EXACT, { STMT_SYNONYM, "a" }, { NAME_ENTITY, "cenX" }, "(cenX+x)" } } };
     REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(query2), { "4", "9" }));
 
     Query query3 = { { { "a", ASSIGN }, { "v", VARIABLE } },
                      { "v" },
                      {},
-                     { { ASSIGN_PATTERN_EXACT, { STMT_SYNONYM, "a" }, { VAR_SYNONYM, "v" }, "cenX+x" } } };
+                     { { ASSIGN_PATTERN_EXACT, { STMT_SYNONYM, "a" }, { VAR_SYNONYM, "v" }, "(cenX+x)" } } };
     REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(query3), { "cenX" }));
 }
 
@@ -1201,6 +1209,20 @@ TEST_CASE("Test evaluation of Next or Next* between synonyms") {
                            { { NEXTT, { STMT_SYNONYM, "rd" }, { STMT_SYNONYM, "w" } } },
                            {} };
     REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(queryNonStmt), { "7", "8" }));
+
+    // all pairs are answered by one getTransitivePairs call, from the while or the assign statements
+    Query queryPairs = { { { "w", WHILE }, { "a", ASSIGN } },
+                         { { DEFAULT_VAL, "w" }, { DEFAULT_VAL, "a" } },
+                         { { NEXTT, { STMT_SYNONYM, "w" }, { STMT_SYNONYM, "a" } } },
+                         {} };
+    REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(queryPairs), { "7 9", "8 9" }));
+
+    Query queryPairsReversed = { { { "w", WHILE }, { "a", ASSIGN } },
+                                 { { DEFAULT_VAL, "w" }, { DEFAULT_VAL, "a" } },
+                                 { { NEXTT, { STMT_SYNONYM, "a" }, { STMT_SYNONYM, "w" } } },
+                                 {} };
+    REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(queryPairsReversed),
+                                       { "7 5", "7 6", "7 9", "8 5", "8 6", "8 9" }));
 }
 
 TEST_CASE("Test evaluation of Next or Next* between entity and synonym") {
@@ -1285,6 +1307,57 @@ TEST_CASE("Test evaluation of Next or Next* with invalid arguments") {
     REQUIRE(qe.evaluateQuery(query).empty());
 }
 
+/**
+ * Code 2 where every statement is Next or Next* of every other, so that pairs are only ruled out by
+ * the split of code 2 into foo (1-2) and bar (3-9).
+ */
+class NextEverywherePKBMock : public PKBMock {
+  public:
+    NextEverywherePKBMock() : PKBMock(2) {
+    }
+
+    STATEMENT_NUMBER_SET getNextStatementOf(STATEMENT_NUMBER /*s*/, bool /*isTransitive*/) const override {
+        return getAllStatements();
+    }
+    STATEMENT_NUMBER_SET getPreviousStatementOf(STATEMENT_NUMBER /*s*/, bool /*isTransitive*/) const override {
+        return getAllStatements();
+    }
+    bool isNextTransitive(STATEMENT_NUMBER /*a*/, STATEMENT_NUMBER /*b*/) const override {
+        return true;
+    }
+    const STATEMENT_NUMBER_SET& getAllStatementsWithNext() const override {
+        return getAllStatements();
+    }
+    const STATEMENT_NUMBER_SET& getAllStatementsWithPrev() const override {
+        return getAllStatements();
+    }
+};
+
+TEST_CASE("Test evaluation of Next or Next* within one procedure") {
+    NextEverywherePKBMock pkb;
+    queryevaluator::QueryEvaluator qe(&pkb);
+
+    Query queryAcross = { { { "s", STMT } }, { "s" }, { { NEXTT, { NUM_ENTITY, "2" }, { NUM_ENTITY, "3" } } }, {} };
+    REQUIRE(qe.evaluateQuery(queryAcross).empty());
+
+    Query queryWithin = { { { "s", STMT } }, { "s" }, { { NEXTT, { NUM_ENTITY, "9" }, { NUM_ENTITY, "3" } } }, {} };
+    REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(queryWithin),
+                                       { "1", "2", "3", "4", "5", "6", "7", "8", "9" }));
+
+    // the call statement 2 is the only candidate of c, so s is only paired with statements of foo
+    Query queryPre = { { { "c", CALL }, { "s", STMT } },
+                       { "s" },
+                       { { NEXT, { STMT_SYNONYM, "c" }, { STMT_SYNONYM, "s" } } },
+                       {} };
+    REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(queryPre), { "1", "2" }));
+
+    Query queryPostTransitive = { { { "c", CALL }, { "s", STMT } },
+                                  { "s" },
+                                  { { NEXTT, { STMT_SYNONYM, "s" }, { STMT_SYNONYM, "c" } } },
+                                  {} };
+    REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(queryPostTransitive), { "1", "2" }));
+}
+
 TEST_CASE("Test evaluation of Calls or Calls* between synonyms") {
     PKBMock pkb(4);
     queryevaluator::QueryEvaluator qe(&pkb);
@@ -1301,6 +1374,13 @@ TEST_CASE("Test evaluation of Calls or Calls* between synonyms") {
                         {} };
     REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(queryPost), { "second", "third" }));
 
+    Query queryPairs = { { { "p1", PROCEDURE }, { "p2", PROCEDURE } },
+                         { { DEFAULT_VAL, "p1" }, { DEFAULT_VAL, "p2" } },
+                         { { CALLST, { PROC_SYNONYM, "p1" }, { PROC_SYNONYM, "p2" } } },
+                         {} };
+    REQUIRE(checkIfVectorOfStringMatch(qe.evaluateQuery(queryPairs),
+                                       { "first second", "first third", "second third" }));
+
     Query querySelf = {
         { { "p", PROCEDURE } }, { "p" }, { { CALLST, { PROC_SYNONYM, "p" }, { PROC_SYNONYM, "p" } } }, {}
     };
@@ -0,0 +1,118 @@
+#include "CompressedRelation.h"
+#include "ReachabilityIndex.h"
+#include "catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace backend {
+namespace testreachabilityindex {
+
+TEST_CASE("Test ReachabilityIndex condenses loops") {
+    // Region [1, 6]: 1 -> 2 -> 3 -> 4 -> 2, 2 -> 5, 3 -> 3 is not a pair, 5 -> 6.
+    // Region [7, 8]: 7 -> 8, 8 -> 8.
+    CompressedRelation relation =
+    CompressedRelation::fromEdges({ { 1, 2 }, { 2, 3 }, { 3, 4 }, { 4, 2 }, { 2, 5 }, { 5, 6 }, { 7, 8 }, { 8, 8 } });
+    ReachabilityIndex index(relation, { { 1, 6 }, { 7, 8 } });
+
+    REQUIRE(index.getReachable(1) == std::vector<int>{ 2, 3, 4, 5, 6 });
+    REQUIRE(index.getReachable(3) == std::vector<int>{ 2, 3, 4, 5, 6 });
+    REQUIRE(index.getReachable(5) == std::vector<int>{ 6 });
+    REQUIRE(index.getReachable(6).empty());
+    REQUIRE(index.getReachable(7) == std::vector<int>{ 8 });
+    REQUIRE(index.getReachable(8) == std::vector<int>{ 8 });
+
+    REQUIRE(index.getReaching(6) == std::vector<int>{ 1, 2, 3, 4, 5 });
+    REQUIRE(index.getReaching(2) == std::vector<int>{ 1, 2, 3, 4 });
+    REQUIRE(index.getReaching(1).empty());
+    REQUIRE(index.getReaching(8) == std::vector<int>{ 7, 8 });
+
+    REQUIRE(index.reaches(4, 4));
+    REQUIRE(index.reaches(4, 6));
+    REQUIRE_FALSE(index.reaches(1, 1));
+    REQUIRE_FALSE(index.reaches(6, 5));
+    REQUIRE_FALSE(index.reaches(1, 8));
+    REQUIRE_FALSE(index.reaches(0, 1));
+    REQUIRE_FALSE(index.reaches(9, 1));
+    REQUIRE(index.getReachable(100).empty());
+}
+
+TEST_CASE("Test ReachabilityIndex agrees with a traversal") {
+    // Nested loops that span more than one word of bits: 1 -> 2 -> ... -> 150, with 100 -> 20 and
+    // 140 -> 10.
+    std::vector<std::pair<int, int>> edges;
+    for (int s = 1; s < 150; ++s) {
+        edges.emplace_back(s, s + 1);
+    }
+    edges.emplace_back(100, 20);
+    edges.emplace_back(140, 10);
+    CompressedRelation relation = CompressedRelation::fromEdges(edges);
+    CompressedRelation reversed = relation.reversed();
+    ReachabilityIndex index(relation, { { 1, 150 } });
+
+    for (int s = 1; s <= 150; ++s) {
+        std::vector<int> expected = relation.getReachable(s);
+        std::sort(expected.begin(), expected.end());
+        REQUIRE(index.getReachable(s) == expected);
+
+        expected = reversed.getReachable(s);
+        std::sort(expected.begin(), expected.end());
+        REQUIRE(index.getReaching(s) == expected);
+    }
+}
+
+TEST_CASE("Test ReachabilityIndex is the same when regions are indexed in parallel") {
+    // 20 regions of 100 nodes, each a chain with a loop back to its middle.
+    std::vector<std::pair<int, int>> edges;
+    std::vector<std::pair<int, int>> regions;
+    for (int first = 1; first <= 2000; first += 100) {
+        for (int node = first; node < first + 99; ++node) {
+            edges.emplace_back(node, node + 1);
+        }
+        edges.emplace_back(first + 80, first + 50);
+        regions.emplace_back(first, first + 99);
+    }
+    CompressedRelation relation = CompressedRelation::fromEdges(edges);
+    ReachabilityIndex sequential(relation, regions);
+    ReachabilityIndex parallel(relation, regions, 4);
+    ReachabilityIndex hardware(relation, regions, 0);
+
+    for (int node = 0; node <= 2001; ++node) {
+        REQUIRE(parallel.getReachable(node) == sequential.getReachable(node));
+        REQUIRE(parallel.getReaching(node) == sequential.getReaching(node));
+        REQUIRE(hardware.getReachable(node) == sequential.getReachable(node));
+    }
+    REQUIRE(parallel.reaches(181, 151));
+    REQUIRE_FALSE(parallel.reaches(100, 101));
+}
+
+TEST_CASE("ReachabilityIndex indexes regions in parallel", "[.benchmark]") {
+    // 64 regions of 2000 nodes, each a chain with nested loops.
+    const int regionSize = 2000;
+    std::vector<std::pair<int, int>> edges;
+    std::vector<std::pair<int, int>> regions;
+    for (int first = 1; first <= 64 * regionSize; first += regionSize) {
+        int last = first + regionSize - 1;
+        for (int node = first; node < last; ++node) {
+            edges.emplace_back(node, node + 1);
+        }
+        for (int loop = 0; loop < regionSize / 2; loop += 10) {
+            edges.emplace_back(last - loop, first + loop);
+        }
+        regions.emplace_back(first, last);
+    }
+    CompressedRelation relation = CompressedRelation::fromEdges(edges);
+
+    for (unsigned int threadCount : { 1u, 2u, 4u, 8u }) {
+        auto start = std::chrono::steady_clock::now();
+        ReachabilityIndex index(relation, regions, threadCount);
+        std::chrono::duration<double, std::milli> millis = std::chrono::steady_clock::now() - start;
+        std::cout << threadCount << " threads: " << millis.count() << " ms\n";
+    }
+}
+
+} // namespace testreachabilityindex
+} // namespace backend
@@ -115,4 +115,49 @@ TEST_CASE("merge table with subsets") {
 
     REQUIRE(rt1 == rtExpected);
 }
+
+TEST_CASE("build table from distinct rows") {
+    std::vector<std::string> header = { "A", "B" };
+    std::vector<std::vector<std::string>> rows = { { "11", "12" }, { "21", "22" }, { "11", "22" } };
+    std::unordered_set<std::vector<std::string>, StringVectorHash> content(rows.begin(), rows.end());
+
+    ResultTable rt(header, std::move(rows));
+    ResultTable rtExpected(header, content);
+    rt.sortTable();
+    rtExpected.sortTable();
+    REQUIRE(rt == rtExpected);
+
+    // all columns, in another order
+    std::vector<std::vector<std::string>> v, v_expected;
+    REQUIRE(rt.updateSynonymValueTupleVector({ "B", "A" }, v));
+    v_expected = { { "12", "11" }, { "22", "11" }, { "22", "21" } };
+    std::sort(v.begin(), v.end(), CompareStrVec());
+    REQUIRE(v == v_expected);
+}
+
+TEST_CASE("flush table after deleting a column") {
+    std::vector<std::string> header = { "A", "B" };
+    std::unordered_set<std::vector<std::string>, StringVectorHash> content = { { "11", "12" },
+                                                                               { "11", "22" },
+                                                                               { "21", "22" } };
+    ResultTable rt(header, content);
+    rt.DeleteColumn("B");
+
+    // the rows repeat until the table is flushed
+    std::vector<std::vector<std::string>> v, v_expected;
+    REQUIRE(rt.updateSynonymValueTupleVector({ "A" }, v));
+    v_expected = { { "11" }, { "21" } };
+    std::sort(v.begin(), v.end(), CompareStrVec());
+    REQUIRE(v == v_expected);
+
+    rt.FlushTable();
+    ResultTable rtExpected("A", { "11", "21" });
+    rt.sortTable();
+    rtExpected.sortTable();
+    REQUIRE(rt == rtExpected);
+
+    // flushing again keeps the table
+    rt.FlushTable();
+    REQUIRE(rt == rtExpected);
+}
 } // namespace qpbackend
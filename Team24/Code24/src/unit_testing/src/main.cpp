@@ -1,2 +1,3 @@
+#define CATCH_CONFIG_NO_POSIX_SIGNALS // MINSIGSTKSZ is no longer a constant in newer glibc
 #define CATCH_CONFIG_MAIN // ThiATCH_CONFIG_MAIN
 #include "catch.hpp"